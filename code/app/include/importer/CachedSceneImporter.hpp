@@ -0,0 +1,52 @@
+#pragma once
+#ifndef __NR_CACHED_SCENE_IMPORTER_HPP__
+#define __NR_CACHED_SCENE_IMPORTER_HPP__
+
+#include "Importer.hpp"
+
+#include <cstdint>
+
+namespace NRenderer
+{
+    using namespace std;
+    // 二进制场景缓存, 包装一个文本场景导入器
+    // 缓存文件与源文件放在一起 (<源文件>.nrcache), 以内容的哈希判断是否失效:
+    //  - 除源文件外还记录导入器读取的其他文件 (材质库、纹理) 的路径、长度与哈希, 任一变化都重新导入
+    //  - 命中时直接映射缓存文件, 按块拷贝各数组, 不再解析文本和解码纹理;
+    //    纹理尽量按 8 位保存, 浮点纹理直接引用映射的内存
+    //  - 未命中时调用被包装的导入器, 成功后写出新缓存
+    class CachedSceneImporter: public Importer
+    {
+    public:
+        static constexpr uint32_t version = 3;
+        // 导入前 asset 中各数组的长度, 缓存中的下标都相对于它保存
+        struct Base
+        {
+            size_t model;
+            size_t node;
+            size_t material;
+            size_t texture;
+            size_t light;
+            size_t sphere;
+            size_t triangle;
+            size_t plane;
+            size_t mesh;
+            size_t pointLight;
+            size_t areaLight;
+            size_t directionalLight;
+            size_t spotLight;
+        };
+    private:
+        SharedImporter importer;
+
+        bool load(Asset& asset, const string& cachePath, uint64_t hash, uint64_t size);
+        void save(const Asset& asset, const Base& base, const string& cachePath, uint64_t hash, uint64_t size);
+    public:
+        CachedSceneImporter(SharedImporter importer)
+            : importer              (importer)
+        {}
+        virtual bool import(Asset& asset, const string& path) override;
+    };
+}
+
+#endif
@@ -3,6 +3,7 @@
 #define __NR_IMPORTER_HPP__
 
 #include <string>
+#include <vector>
 #include "asset/Asset.hpp"
 
 namespace NRenderer
@@ -12,14 +13,21 @@ namespace NRenderer
     {
     protected:
         string lastErrorInfo;
+        // 上一次导入时除主文件外读取的文件 (材质库、纹理等), 供缓存判断是否失效
+        vector<string> dependencies;
     public:
         virtual bool import(Asset& asset, const string& path) = 0;
         inline
         string getErrorInfo() const {
             return lastErrorInfo;
         }
+        inline
+        const vector<string>& getDependencies() const {
+            return dependencies;
+        }
         Importer()
             : lastErrorInfo         ()
+            , dependencies          ()
         {}
         virtual ~Importer() = default;
     };
@@ -8,6 +8,7 @@
 #include "Importer.hpp"
 #include "ScnImporter.hpp"
 #include "ObjImporter.hpp"
+#include "CachedSceneImporter.hpp"
 
 namespace NRenderer
 {
@@ -22,8 +23,8 @@ namespace NRenderer
             return f;
         }
         SceneImporterFactory() {
-            importerMap["scn"] = make_shared<ScnImporter>();
-            importerMap["obj"] = make_shared<ObjImporter>();
+            importerMap["scn"] = make_shared<CachedSceneImporter>(make_shared<ScnImporter>());
+            importerMap["obj"] = make_shared<CachedSceneImporter>(make_shared<ObjImporter>());
         }
         SharedImporter importer(const string& ext) {
             auto it = importerMap.find(ext);
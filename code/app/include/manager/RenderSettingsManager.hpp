@@ -8,17 +8,45 @@ namespace NRenderer
 {
     struct RenderSettings
     {
+        enum BVHBuilder
+        {
+            MEDIAN, LBVH, SBVH
+        };
         unsigned int width;
         unsigned int height;
         unsigned int depth;
         unsigned int samplesPerPixel;
         unsigned int photonsPerLight;
+        unsigned int causticPhotonsPerLight;
+        bool photonDiagnostics;
+        unsigned int vplPathsPerLight;
+        unsigned int radiosityResolution;
+        BVHBuilder bvhBuilder;
+        bool lazyBuild;
+        bool restirDI;
+        bool pathGuiding;
+        bool radianceCache;
+        unsigned int radianceCacheBounces;
+        unsigned int radianceCacheCellPixels;
+        bool denoise;
         RenderSettings()
             : width             (500)
             , height            (500)
             , depth             (4)
             , samplesPerPixel   (16)
-            , photonsPerLight   (10000)
+            , photonsPerLight   (50000)
+            , causticPhotonsPerLight (20000)
+            , photonDiagnostics (false)
+            , vplPathsPerLight  (1000)
+            , radiosityResolution (16)
+            , bvhBuilder        (BVHBuilder::MEDIAN)
+            , lazyBuild         (false)
+            , restirDI          (false)
+            , pathGuiding       (false)
+            , radianceCache     (false)
+            , radianceCacheBounces (1)
+            , radianceCacheCellPixels (8)
+            , denoise           (false)
         {}
     };
     struct AmbientSettings
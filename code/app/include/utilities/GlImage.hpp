@@ -22,6 +22,16 @@ namespace NRenderer
             glBindTexture(GL_TEXTURE_2D, 0);
             return id;
         }
+        static GlImageId loadImage(const RGBAi* pixels, const Vec2& size) {
+            GlImageId id  = 0u;
+            glGenTextures(1, &id);
+            glBindTexture(GL_TEXTURE_2D, id);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size.x, size.y, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            return id;
+        }
         static void deleteImage(GlImageId id) {
             glDeleteTextures(1, &id);
         }
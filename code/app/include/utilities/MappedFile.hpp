@@ -0,0 +1,39 @@
+#pragma once
+#ifndef __NR_MAPPED_FILE_HPP__
+#define __NR_MAPPED_FILE_HPP__
+
+#include <string>
+#include <cstddef>
+
+namespace NRenderer
+{
+    using namespace std;
+    // 只读内存映射文件, 析构时自动解除映射
+    class MappedFile
+    {
+    private:
+        const char* ptr;
+        size_t length;
+#ifdef _WIN32
+        void* fileHandle;
+        void* mappingHandle;
+#else
+        int fd;
+#endif
+    public:
+        MappedFile();
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        // 空文件也视为打开成功, 此时 data() 为 nullptr
+        bool open(const string& path);
+        void close();
+
+        const char* data() const { return ptr; }
+        size_t size() const { return length; }
+    };
+} // namespace NRenderer
+
+
+#endif
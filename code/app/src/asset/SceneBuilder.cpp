@@ -8,10 +8,38 @@ namespace NRenderer
         ro.samplesPerPixel = renderSettings.samplesPerPixel;
         ro.width = renderSettings.width;
         ro.height = renderSettings.height;
+        ro.photonsPerLight = renderSettings.photonsPerLight;
+        ro.causticPhotonsPerLight = renderSettings.causticPhotonsPerLight;
+        ro.photonDiagnostics = renderSettings.photonDiagnostics;
+        ro.vplPathsPerLight = renderSettings.vplPathsPerLight;
+        ro.radiosityResolution = renderSettings.radiosityResolution;
+        switch (renderSettings.bvhBuilder) {
+        case RenderSettings::BVHBuilder::LBVH:
+            ro.bvhBuilder = RenderOption::BVHBuilder::LBVH;
+            break;
+        case RenderSettings::BVHBuilder::SBVH:
+            ro.bvhBuilder = RenderOption::BVHBuilder::SBVH;
+            break;
+        default:
+            ro.bvhBuilder = RenderOption::BVHBuilder::MEDIAN;
+        }
+        ro.lazyBuild = renderSettings.lazyBuild;
+        ro.restirDI = renderSettings.restirDI;
+        ro.pathGuiding = renderSettings.pathGuiding;
+        ro.radianceCache = renderSettings.radianceCache;
+        ro.radianceCacheBounces = renderSettings.radianceCacheBounces;
+        ro.radianceCacheCellPixels = renderSettings.radianceCacheCellPixels;
+        ro.denoise = renderSettings.denoise;
         this->scene->renderOption = ro;
     }
 
+    // Mesh 的顶点数组和 Texture 的像素都是共享的, 这里只复制对象本身, 不复制数据
     void SceneBuilder::buildBuffer() {
+        this->scene->materials.reserve(asset.materialItems.size());
+        this->scene->textures.reserve(asset.textureItems.size());
+        this->scene->nodes.reserve(asset.nodeItems.size());
+        this->scene->meshBuffer.reserve(asset.meshes.size());
+        this->scene->triangleBuffer.reserve(asset.triangles.size());
         for (auto& mi : asset.materialItems) {
             this->scene->materials.push_back(*mi.material);
         }
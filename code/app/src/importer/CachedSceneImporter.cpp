@@ -0,0 +1,607 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "importer/CachedSceneImporter.hpp"
+#include "utilities/MappedFile.hpp"
+#include "utilities/GlImage.hpp"
+
+namespace NRenderer
+{
+    namespace
+    {
+        using Base = CachedSceneImporter::Base;
+
+        const char magic[4] = { 'N', 'R', 'S', 'C' };
+        const uint32_t endTag = 0x444E4524;
+        // 指向本次导入的条目的句柄保存为相对下标并置最高位, 其余句柄原样保存
+        const uint64_t relativeBit = 1ull << 63;
+
+        // 以 8 字节为单位的 FNV-1a, 源文件可能有几百 MB
+        uint64_t hashContent(const char* data, size_t size) {
+            uint64_t h = 1469598103934665603ull;
+            size_t i = 0;
+            for (; i + 8 <= size; i += 8) {
+                uint64_t w;
+                memcpy(&w, data + i, 8);
+                h ^= w;
+                h *= 1099511628211ull;
+            }
+            for (; i < size; i++) {
+                h ^= (unsigned char)data[i];
+                h *= 1099511628211ull;
+            }
+            return h ^ size;
+        }
+
+        // 文件的长度与内容哈希; 文件不存在时长度记为 missing, 之后出现了也能发现
+        const uint64_t missing = ~0ull;
+        void stamp(const string& path, uint64_t& hash, uint64_t& size) {
+            MappedFile file;
+            if (!file.open(path)) {
+                hash = 0;
+                size = missing;
+                return;
+            }
+            hash = hashContent(file.data(), file.size());
+            size = file.size();
+        }
+
+        // 纹理像素的存储格式
+        //  - RGBA8: 每个分量都能由 8 位值精确还原时 (目前的图片加载都是如此), 只存 4 字节
+        //  - RGBA32F: 其余情况原样保存浮点, 按 16 字节对齐, 读取时直接引用映射的内存
+        enum class TexelFormat : uint32_t { RGBA8 = 0, RGBA32F = 1 };
+        const size_t texelAlignment = 16;
+
+        bool exactRGBA8(const Texture& t) {
+            const float* v = reinterpret_cast<const float*>(t.rgba);
+            for (size_t i=0, n=size_t(t.width)*t.height*4; i<n; i++) {
+                if (!(v[i] >= 0.f && v[i] <= 1.f)) return false;
+                if (float(uint8_t(v[i]*255.f + 0.5f)) / 255.f != v[i]) return false;
+            }
+            return true;
+        }
+
+        Base getBase(const Asset& asset) {
+            return {
+                asset.modelItems.size(), asset.nodeItems.size(), asset.materialItems.size(),
+                asset.textureItems.size(), asset.lightItems.size(),
+                asset.spheres.size(), asset.triangles.size(), asset.planes.size(), asset.meshes.size(),
+                asset.pointLights.size(), asset.areaLights.size(),
+                asset.directionalLights.size(), asset.spotLights.size()
+            };
+        }
+
+        size_t entityBase(const Base& base, Node::Type type) {
+            switch (type) {
+            case Node::Type::SPHERE: return base.sphere;
+            case Node::Type::TRIANGLE: return base.triangle;
+            case Node::Type::PLANE: return base.plane;
+            default: return base.mesh;
+            }
+        }
+
+        size_t entityBase(const Base& base, Light::Type type) {
+            switch (type) {
+            case Light::Type::POINT: return base.pointLight;
+            case Light::Type::SPOT: return base.spotLight;
+            case Light::Type::DIRECTIONAL: return base.directionalLight;
+            default: return base.areaLight;
+            }
+        }
+
+        uint64_t encodeHandle(Handle h, size_t begin) {
+            if (h.valid() && h.index() >= begin) return (h.index() - begin + 1) | relativeBit;
+            return h.getValue();
+        }
+
+        Handle decodeHandle(uint64_t v, size_t begin) {
+            Handle h;
+            if (v & relativeBit) h.setValue(begin + (v & ~relativeBit));
+            else h.setValue(size_t(v));
+            return h;
+        }
+
+        // 无效句柄表示未设置, 有效句柄必须落在 asset 中已有与本次读入的条目内
+        bool handleInRange(const Handle& h, size_t end) {
+            return !h.valid() || h.index() < end;
+        }
+
+        class Writer
+        {
+        private:
+            ofstream& out;
+        public:
+            Writer(ofstream& out) : out(out) {}
+            template<typename T>
+            void pod(const T& v) {
+                out.write(reinterpret_cast<const char*>(&v), sizeof(T));
+            }
+            void str(const string& s) {
+                pod(uint32_t(s.size()));
+                out.write(s.data(), s.size());
+            }
+            template<typename T>
+            void array(const vector<T>& a) {
+                pod(uint64_t(a.size()));
+                if (!a.empty()) out.write(reinterpret_cast<const char*>(a.data()), a.size()*sizeof(T));
+            }
+            template<typename T>
+            void array(const CowVector<T>& a) {
+                array(a.get());
+            }
+            // 缓存按页映射, 文件偏移对齐即内存地址对齐
+            void align(size_t a) {
+                const char zeros[16] = {};
+                size_t pad = (a - size_t(out.tellp()) % a) % a;
+                out.write(zeros, pad);
+            }
+        };
+
+        // 所有读取都做越界检查, 缓存损坏时 ok 置为 false, 调用方回退到文本导入
+        class Reader
+        {
+        private:
+            const char* p;
+            const char* end;
+        public:
+            bool ok = true;
+            Reader(const char* data, size_t size) : p(data), end(data + size) {}
+            template<typename T>
+            T pod() {
+                T v{};
+                if (!ok || size_t(end - p) < sizeof(T)) {
+                    ok = false;
+                    return v;
+                }
+                memcpy(&v, p, sizeof(T));
+                p += sizeof(T);
+                return v;
+            }
+            string str() {
+                auto n = pod<uint32_t>();
+                if (!ok || size_t(end - p) < n) {
+                    ok = false;
+                    return {};
+                }
+                string s(p, n);
+                p += n;
+                return s;
+            }
+            template<typename T>
+            void array(vector<T>& a) {
+                auto n = pod<uint64_t>();
+                if (!ok || n > size_t(end - p) / sizeof(T)) {
+                    ok = false;
+                    return;
+                }
+                a.resize(size_t(n));
+                if (n != 0) memcpy(a.data(), p, size_t(n)*sizeof(T));
+                p += size_t(n)*sizeof(T);
+            }
+            template<typename T>
+            void array(CowVector<T>& a) {
+                vector<T> v;
+                array(v);
+                a = std::move(v);
+            }
+            // 条目数, 每个条目至少占一个字节, 超过剩余长度说明缓存已损坏
+            size_t count() {
+                auto n = pod<uint64_t>();
+                if (n > uint64_t(end - p)) ok = false;
+                return ok ? size_t(n) : 0;
+            }
+            void align(size_t a) {
+                size_t pad = (a - reinterpret_cast<uintptr_t>(p) % a) % a;
+                if (!ok || size_t(end - p) < pad) {
+                    ok = false;
+                    return;
+                }
+                p += pad;
+            }
+            // 不复制, 返回指向映射内存的指针
+            const char* view(size_t n) {
+                if (!ok || size_t(end - p) < n) {
+                    ok = false;
+                    return nullptr;
+                }
+                auto v = p;
+                p += n;
+                return v;
+            }
+            bool atEnd() const { return p == end; }
+        };
+
+        void writeEntity(Writer& w, const Entity& e, const Base& base) {
+            w.pod(encodeHandle(e.material, base.material));
+        }
+
+        void readEntity(Reader& r, Entity& e, const Base& base) {
+            e.material = decodeHandle(r.pod<uint64_t>(), base.material);
+        }
+
+    }
+
+    bool CachedSceneImporter::import(Asset& asset, const string& path) {
+        uint64_t hash, size;
+        stamp(path, hash, size);
+        if (size == missing) {
+            lastErrorInfo = "File does not exist!";
+            return false;
+        }
+
+        auto cachePath = path + ".nrcache";
+        if (load(asset, cachePath, hash, size)) return true;
+
+        Base base = getBase(asset);
+        bool success = importer->import(asset, path);
+        lastErrorInfo = importer->getErrorInfo();
+        if (success) save(asset, base, cachePath, hash, size);
+        return success;
+    }
+
+    void CachedSceneImporter::save(const Asset& asset, const Base& base, const string& cachePath, uint64_t hash, uint64_t size) {
+        // 先写临时文件再改名, 写到一半失败不会留下损坏的缓存
+        auto tmpPath = cachePath + ".tmp";
+        {
+            ofstream out(tmpPath, ios::binary | ios::trunc);
+            if (!out.is_open()) return;
+            Writer w{ out };
+            out.write(magic, sizeof(magic));
+            w.pod(version);
+            w.pod(hash);
+            w.pod(size);
+            // 被包装的导入器读取的其他文件, 加载时逐个比对
+            auto& deps = importer->getDependencies();
+            w.pod(uint64_t(deps.size()));
+            for (auto& dep : deps) {
+                uint64_t depHash, depSize;
+                stamp(dep, depHash, depSize);
+                w.str(dep);
+                w.pod(depSize);
+                w.pod(depHash);
+            }
+
+            w.pod(uint64_t(asset.modelItems.size() - base.model));
+            for (auto i = base.model; i < asset.modelItems.size(); i++) {
+                auto& mi = asset.modelItems[i];
+                w.str(mi.name);
+                w.pod(mi.model->translation);
+                w.pod(mi.model->rotation);
+                w.pod(mi.model->scale);
+                vector<Index> nodes;
+                for (auto n : mi.model->nodes) nodes.push_back(Index(n - base.node));
+                w.array(nodes);
+            }
+            w.pod(uint64_t(asset.nodeItems.size() - base.node));
+            for (auto i = base.node; i < asset.nodeItems.size(); i++) {
+                auto& ni = asset.nodeItems[i];
+                w.str(ni.name);
+                w.pod(uint32_t(ni.node->type));
+                w.pod(uint32_t(ni.node->entity - entityBase(base, ni.node->type)));
+                w.pod(uint32_t(ni.node->model - base.model));
+            }
+            w.pod(uint64_t(asset.materialItems.size() - base.material));
+            for (auto i = base.material; i < asset.materialItems.size(); i++) {
+                auto& mi = asset.materialItems[i];
+                w.str(mi.name);
+                w.pod(uint32_t(mi.material->type));
+                w.pod(uint64_t(mi.material->properties.size()));
+                for (auto& p : mi.material->properties) {
+                    w.str(p.key);
+                    w.pod(uint32_t(p.type));
+                    std::visit([&](const auto& v) {
+                        using T = std::decay_t<decltype(v.value)>;
+                        if constexpr (std::is_same_v<T, Handle>) w.pod(encodeHandle(v.value, base.texture));
+                        else w.pod(v.value);
+                    }, p.valueWrapper);
+                }
+            }
+            w.pod(uint64_t(asset.textureItems.size() - base.texture));
+            for (auto i = base.texture; i < asset.textureItems.size(); i++) {
+                auto& ti = asset.textureItems[i];
+                auto& t = *ti.texture;
+                w.str(ti.name);
+                w.pod(uint32_t(t.width));
+                w.pod(uint32_t(t.height));
+                const size_t n = size_t(t.width)*t.height;
+                if (exactRGBA8(t)) {
+                    w.pod(TexelFormat::RGBA8);
+                    vector<RGBAi> texels(n);
+                    for (size_t k=0; k<n; k++) texels[k] = RGBAi(t.rgba[k]*255.f + 0.5f);
+                    out.write(reinterpret_cast<const char*>(texels.data()), n*sizeof(RGBAi));
+                }
+                else {
+                    w.pod(TexelFormat::RGBA32F);
+                    w.align(texelAlignment);
+                    out.write(reinterpret_cast<const char*>(t.rgba), n*sizeof(RGBA));
+                }
+            }
+            w.pod(uint64_t(asset.lightItems.size() - base.light));
+            for (auto i = base.light; i < asset.lightItems.size(); i++) {
+                auto& li = asset.lightItems[i];
+                w.str(li.name);
+                w.pod(uint32_t(li.light->type));
+                w.pod(uint32_t(li.light->entity - entityBase(base, li.light->type)));
+            }
+
+            w.pod(uint64_t(asset.spheres.size() - base.sphere));
+            for (auto i = base.sphere; i < asset.spheres.size(); i++) {
+                auto& s = *asset.spheres[i];
+                writeEntity(w, s, base);
+                w.pod(s.direction);
+                w.pod(s.position);
+                w.pod(s.radius);
+            }
+            w.pod(uint64_t(asset.triangles.size() - base.triangle));
+            for (auto i = base.triangle; i < asset.triangles.size(); i++) {
+                auto& t = *asset.triangles[i];
+                writeEntity(w, t, base);
+                w.pod(t.v1); w.pod(t.v2); w.pod(t.v3);
+                w.pod(t.normal);
+                w.pod(t.n1); w.pod(t.n2); w.pod(t.n3);
+            }
+            w.pod(uint64_t(asset.planes.size() - base.plane));
+            for (auto i = base.plane; i < asset.planes.size(); i++) {
+                auto& p = *asset.planes[i];
+                writeEntity(w, p, base);
+                w.pod(p.normal);
+                w.pod(p.position);
+                w.pod(p.u);
+                w.pod(p.v);
+            }
+            w.pod(uint64_t(asset.meshes.size() - base.mesh));
+            for (auto i = base.mesh; i < asset.meshes.size(); i++) {
+                auto& m = *asset.meshes[i];
+                writeEntity(w, m, base);
+                w.array(m.positions);
+                w.array(m.normals);
+                w.array(m.uvs);
+                w.array(m.positionIndices);
+                w.array(m.normalIndices);
+                w.array(m.uvIndices);
+            }
+
+            w.pod(uint64_t(asset.pointLights.size() - base.pointLight));
+            for (auto i = base.pointLight; i < asset.pointLights.size(); i++) w.pod(*asset.pointLights[i]);
+            w.pod(uint64_t(asset.areaLights.size() - base.areaLight));
+            for (auto i = base.areaLight; i < asset.areaLights.size(); i++) w.pod(*asset.areaLights[i]);
+            w.pod(uint64_t(asset.directionalLights.size() - base.directionalLight));
+            for (auto i = base.directionalLight; i < asset.directionalLights.size(); i++) w.pod(*asset.directionalLights[i]);
+            w.pod(uint64_t(asset.spotLights.size() - base.spotLight));
+            for (auto i = base.spotLight; i < asset.spotLights.size(); i++) w.pod(*asset.spotLights[i]);
+
+            w.pod(endTag);
+            if (!out.good()) {
+                out.close();
+                remove(tmpPath.c_str());
+                return;
+            }
+        }
+        remove(cachePath.c_str());
+        rename(tmpPath.c_str(), cachePath.c_str());
+    }
+
+    bool CachedSceneImporter::load(Asset& asset, const string& cachePath, uint64_t hash, uint64_t size) {
+        // 浮点纹理直接引用映射的内存, 映射由这些纹理共同持有
+        auto mapping = make_shared<MappedFile>();
+        auto& file = *mapping;
+        if (!file.open(cachePath) || file.size() < sizeof(magic)) return false;
+        if (memcmp(file.data(), magic, sizeof(magic)) != 0) return false;
+        Reader r{ file.data() + sizeof(magic), file.size() - sizeof(magic) };
+        if (r.pod<uint32_t>() != version) return false;
+        if (r.pod<uint64_t>() != hash) return false;
+        if (r.pod<uint64_t>() != size) return false;
+        auto deps = r.count();
+        for (size_t i = 0; i < deps; i++) {
+            auto dep = r.str();
+            auto depSize = r.pod<uint64_t>();
+            auto depHash = r.pod<uint64_t>();
+            if (!r.ok) return false;
+            uint64_t currHash, currSize;
+            stamp(dep, currHash, currSize);
+            if (currSize != depSize || currHash != depHash) return false;
+        }
+
+        // 先读到临时容器, 全部校验通过后再追加进 asset, 失败时 asset 保持不变
+        Base base = getBase(asset);
+        vector<ModelItem> models(r.count());
+        for (auto& mi : models) {
+            mi.name = r.str();
+            mi.model = make_shared<Model>();
+            mi.model->translation = r.pod<Vec3>();
+            mi.model->rotation = r.pod<Vec3>();
+            mi.model->scale = r.pod<Vec3>();
+            r.array(mi.model->nodes);
+        }
+        vector<NodeItem> nodes(r.count());
+        for (auto& ni : nodes) {
+            ni.name = r.str();
+            ni.node = make_shared<Node>();
+            ni.node->type = Node::Type(r.pod<uint32_t>());
+            ni.node->entity = r.pod<uint32_t>();
+            ni.node->model = r.pod<uint32_t>();
+        }
+        vector<MaterialItem> materials(r.count());
+        for (auto& mi : materials) {
+            mi.name = r.str();
+            mi.material = make_shared<Material>();
+            mi.material->type = r.pod<uint32_t>();
+            auto n = r.count();
+            for (size_t i = 0; i < n && r.ok; i++) {
+                using PW = Property::Wrapper;
+                auto key = r.str();
+                auto type = Property::Type(r.pod<uint32_t>());
+                switch (type) {
+                case Property::Type::INT: mi.material->properties.push_back({ key, PW::IntType{ r.pod<int>() } }); break;
+                case Property::Type::FLOAT: mi.material->properties.push_back({ key, PW::FloatType{ r.pod<float>() } }); break;
+                case Property::Type::RGB: mi.material->properties.push_back({ key, PW::RGBType{ r.pod<RGB>() } }); break;
+                case Property::Type::RGBA: mi.material->properties.push_back({ key, PW::RGBAType{ r.pod<RGBA>() } }); break;
+                case Property::Type::VEC3: mi.material->properties.push_back({ key, PW::Vec3Type{ r.pod<Vec3>() } }); break;
+                case Property::Type::VEC4: mi.material->properties.push_back({ key, PW::Vec4Type{ r.pod<Vec4>() } }); break;
+                case Property::Type::TEXTURE_ID:
+                    mi.material->properties.push_back({ key, PW::TextureIdType{ decodeHandle(r.pod<uint64_t>(), base.texture) } });
+                    break;
+                default: r.ok = false;
+                }
+            }
+        }
+        vector<TextureItem> textures(r.count());
+        // 8 位纹理上传预览时直接使用映射中的数据
+        vector<const RGBAi*> texels(textures.size(), nullptr);
+        for (size_t i = 0; i < textures.size() && r.ok; i++) {
+            auto& ti = textures[i];
+            ti.name = r.str();
+            ti.texture = make_shared<Texture>();
+            auto& t = *ti.texture;
+            auto width = r.pod<uint32_t>();
+            auto height = r.pod<uint32_t>();
+            auto format = r.pod<TexelFormat>();
+            if (!r.ok || uint64_t(width)*height > file.size()) return false;
+            const size_t n = size_t(width)*height;
+            if (format == TexelFormat::RGBA8) {
+                auto src = reinterpret_cast<const RGBAi*>(r.view(n*sizeof(RGBAi)));
+                if (!r.ok) return false;
+                auto dst = t.allocate(width, height);
+                for (size_t k = 0; k < n; k++) dst[k] = RGBA{ src[k] } / 255.f;
+                texels[i] = src;
+            }
+            else if (format == TexelFormat::RGBA32F) {
+                r.align(texelAlignment);
+                auto src = reinterpret_cast<const RGBA*>(r.view(n*sizeof(RGBA)));
+                if (!r.ok) return false;
+                t.view(mapping, src, width, height);
+            }
+            else return false;
+        }
+        vector<LightItem> lights(r.count());
+        for (auto& li : lights) {
+            li.name = r.str();
+            li.light = make_shared<Light>(Light::Type(r.pod<uint32_t>()));
+            li.light->entity = r.pod<uint32_t>();
+        }
+
+        vector<SharedSphere> spheres(r.count());
+        for (auto& sp : spheres) {
+            sp = make_shared<Sphere>();
+            readEntity(r, *sp, base);
+            sp->direction = r.pod<Vec3>();
+            sp->position = r.pod<Vec3>();
+            sp->radius = r.pod<float>();
+        }
+        vector<SharedTriangle> triangles(r.count());
+        for (auto& tp : triangles) {
+            tp = make_shared<Triangle>();
+            readEntity(r, *tp, base);
+            tp->v1 = r.pod<Vec3>(); tp->v2 = r.pod<Vec3>(); tp->v3 = r.pod<Vec3>();
+            tp->normal = r.pod<Vec3>();
+            tp->n1 = r.pod<Vec3>(); tp->n2 = r.pod<Vec3>(); tp->n3 = r.pod<Vec3>();
+        }
+        vector<SharedPlane> planes(r.count());
+        for (auto& pp : planes) {
+            pp = make_shared<Plane>();
+            readEntity(r, *pp, base);
+            pp->normal = r.pod<Vec3>();
+            pp->position = r.pod<Vec3>();
+            pp->u = r.pod<Vec3>();
+            pp->v = r.pod<Vec3>();
+        }
+        vector<SharedMesh> meshes(r.count());
+        for (auto& mp : meshes) {
+            mp = make_shared<Mesh>();
+            readEntity(r, *mp, base);
+            r.array(mp->positions);
+            r.array(mp->normals);
+            r.array(mp->uvs);
+            r.array(mp->positionIndices);
+            r.array(mp->normalIndices);
+            r.array(mp->uvIndices);
+        }
+
+        vector<SharedPointLight> pointLights(r.count());
+        for (auto& l : pointLights) l = make_shared<PointLight>(r.pod<PointLight>());
+        vector<SharedAreaLight> areaLights(r.count());
+        for (auto& l : areaLights) l = make_shared<AreaLight>(r.pod<AreaLight>());
+        vector<SharedDirectionalLight> directionalLights(r.count());
+        for (auto& l : directionalLights) l = make_shared<DirectionalLight>(r.pod<DirectionalLight>());
+        vector<SharedSpotLight> spotLights(r.count());
+        for (auto& l : spotLights) l = make_shared<SpotLight>(r.pod<SpotLight>());
+
+        if (r.pod<uint32_t>() != endTag || !r.ok || !r.atEnd()) return false;
+
+        // 校验相对下标, 防止缓存与当前版本不匹配时越界
+        Base count{
+            models.size(), nodes.size(), materials.size(), textures.size(), lights.size(),
+            spheres.size(), triangles.size(), planes.size(), meshes.size(),
+            pointLights.size(), areaLights.size(), directionalLights.size(), spotLights.size()
+        };
+        for (auto& mi : models) {
+            for (auto n : mi.model->nodes) if (n >= count.node) return false;
+        }
+        for (auto& ni : nodes) {
+            auto type = ni.node->type;
+            if (type != Node::Type::SPHERE && type != Node::Type::TRIANGLE && type != Node::Type::PLANE && type != Node::Type::MESH) return false;
+            if (ni.node->entity >= entityBase(count, type) || ni.node->model >= count.model) return false;
+        }
+        for (auto& li : lights) {
+            auto type = li.light->type;
+            if (type != Light::Type::POINT && type != Light::Type::SPOT && type != Light::Type::DIRECTIONAL && type != Light::Type::AREA) return false;
+            if (li.light->entity >= entityBase(count, type)) return false;
+        }
+        for (auto& mi : materials) {
+            for (auto& p : mi.material->properties) {
+                auto tex = get_if<Property::Wrapper::TextureIdType>(&p.valueWrapper);
+                if (tex && !handleInRange(tex->value, base.texture + count.texture)) return false;
+            }
+        }
+        const size_t materialEnd = base.material + count.material;
+        for (auto& sp : spheres) if (!handleInRange(sp->material, materialEnd)) return false;
+        for (auto& tp : triangles) if (!handleInRange(tp->material, materialEnd)) return false;
+        for (auto& pp : planes) if (!handleInRange(pp->material, materialEnd)) return false;
+        for (auto& mp : meshes) if (!handleInRange(mp->material, materialEnd)) return false;
+        for (auto& mp : meshes) {
+            auto& m = *mp;
+            for (auto i : m.positionIndices) if (i >= m.positions.size()) return false;
+            for (auto i : m.normalIndices) if (i >= m.normals.size()) return false;
+            for (auto i : m.uvIndices) if (i >= m.uvs.size()) return false;
+        }
+
+        for (auto& mi : models) {
+            for (auto& n : mi.model->nodes) n += Index(base.node);
+            asset.modelItems.push_back(std::move(mi));
+        }
+        for (auto& ni : nodes) {
+            ni.node->entity += Index(entityBase(base, ni.node->type));
+            ni.node->model += Index(base.model);
+            asset.nodeItems.push_back(std::move(ni));
+        }
+        for (auto& mi : materials) asset.materialItems.push_back(std::move(mi));
+        for (size_t i = 0; i < textures.size(); i++) {
+            auto& ti = textures[i];
+            auto& t = *ti.texture;
+            Vec2 extent{ float(t.width), float(t.height) };
+            ti.glId = texels[i] ? GlImage::loadImage(texels[i], extent) : GlImage::loadImage(t.rgba, extent);
+            asset.textureItems.push_back(std::move(ti));
+        }
+        for (auto& li : lights) {
+            li.light->entity += Index(entityBase(base, li.light->type));
+            asset.lightItems.push_back(std::move(li));
+        }
+        asset.spheres.insert(asset.spheres.end(), spheres.begin(), spheres.end());
+        asset.triangles.insert(asset.triangles.end(), triangles.begin(), triangles.end());
+        asset.planes.insert(asset.planes.end(), planes.begin(), planes.end());
+        asset.meshes.insert(asset.meshes.end(), meshes.begin(), meshes.end());
+        asset.pointLights.insert(asset.pointLights.end(), pointLights.begin(), pointLights.end());
+        asset.areaLights.insert(asset.areaLights.end(), areaLights.begin(), areaLights.end());
+        asset.directionalLights.insert(asset.directionalLights.end(), directionalLights.begin(), directionalLights.end());
+        asset.spotLights.insert(asset.spotLights.end(), spotLights.begin(), spotLights.end());
+
+        for (auto i = base.node; i < asset.nodeItems.size(); i++) {
+            asset.genPreviewGlBuffersPerNode(asset.nodeItems[i]);
+        }
+        for (auto i = base.light; i < asset.lightItems.size(); i++) {
+            asset.genPreviewGlBuffersPerLight(asset.lightItems[i]);
+        }
+        return true;
+    }
+}
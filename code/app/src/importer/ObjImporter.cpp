@@ -1,14 +1,239 @@
 #include <fstream>
 #include <sstream>
+#include <charconv>
+#include <cstring>
+#include <string_view>
+#include <thread>
 
 #include "utilities/File.hpp"
 #include "utilities/ImageLoader.hpp"
 #include "utilities/GlImage.hpp"
+#include "utilities/MappedFile.hpp"
 
 #include "importer/ObjImporter.hpp"
 
 namespace NRenderer
 {
+    namespace
+    {
+        // Ѱַ + ̽ Index -> Index ӳ, ÿһ, ڰȫֶ±Ϊ±
+        class IndexMap
+        {
+        private:
+            //  key + 1, 0 ʾղ
+            vector<uint32_t> keys;
+            vector<Index> values;
+            size_t count;
+            unsigned bits;
+
+            size_t slot(uint32_t key) const {
+                return size_t((uint64_t(key) * 0x9E3779B97F4A7C15ull) >> (64 - bits));
+            }
+            void grow() {
+                auto oldKeys = std::move(keys);
+                auto oldValues = std::move(values);
+                bits++;
+                keys.assign(size_t(1) << bits, 0);
+                values.assign(size_t(1) << bits, 0);
+                size_t mask = keys.size() - 1;
+                for (size_t i = 0; i < oldKeys.size(); i++) {
+                    if (oldKeys[i] == 0) continue;
+                    size_t s = slot(oldKeys[i] - 1);
+                    while (keys[s] != 0) s = (s + 1) & mask;
+                    keys[s] = oldKeys[i];
+                    values[s] = oldValues[i];
+                }
+            }
+        public:
+            IndexMap() { reset(); }
+            void reset() {
+                bits = 6;
+                count = 0;
+                keys.assign(size_t(1) << bits, 0);
+                values.assign(size_t(1) << bits, 0);
+            }
+            // key ʱ (key, candidate)  true; д value
+            bool findOrInsert(uint32_t key, Index candidate, Index& value) {
+                size_t mask = keys.size() - 1;
+                size_t s = slot(key);
+                while (keys[s] != 0) {
+                    if (keys[s] == key + 1) {
+                        value = values[s];
+                        return false;
+                    }
+                    s = (s + 1) & mask;
+                }
+                keys[s] = key + 1;
+                values[s] = candidate;
+                value = candidate;
+                if (++count * 2 > keys.size()) grow();
+                return true;
+            }
+        };
+
+        // һǵ, index Ϊ v/t/n
+        struct Corner
+        {
+            int index[3];
+            //  3 λ: Ӧ±Ƿ; 4~6 λ: ǷΪ± (Ը±)
+            uint8_t flags;
+        };
+
+        struct Directive
+        {
+            enum class Type { GROUP, USEMTL, MTLLIB };
+            Type type;
+            // ڿڵڼ֮ǰ
+            size_t face;
+            // ָӳڴ, 
+            string_view arg;
+        };
+
+        // һ߳̽һļ, ǿڵ, ϲʱǰ׺ƴ
+        struct ObjChunk
+        {
+            vector<Vec3> positions;
+            vector<Vec2> uvs;
+            vector<Vec3> normals;
+            vector<Corner> corners;
+            vector<Directive> directives;
+            string error;
+        };
+
+        inline const char* skipSpace(const char* p, const char* end) {
+            while (p < end && (*p == ' ' || *p == '\t')) p++;
+            return p;
+        }
+
+        inline const char* tokenEnd(const char* p, const char* end) {
+            while (p < end && *p != ' ' && *p != '\t' && *p != '\r') p++;
+            return p;
+        }
+
+        inline float parseFloat(const char*& p, const char* end) {
+            p = skipSpace(p, end);
+            if (p < end && *p == '+') p++;
+            float f = 0.f;
+            auto res = from_chars(p, end, f);
+            p = res.ptr;
+            return f;
+        }
+
+        inline bool parseInt(const char*& p, const char* end, int& v) {
+            if (p < end && *p == '+') p++;
+            auto res = from_chars(p, end, v);
+            if (res.ec != errc{}) return false;
+            p = res.ptr;
+            return true;
+        }
+
+        // ±ֱתΪ 0 ʼȫ±, ±ȼΪλ, ϲʱټϿƫ
+        inline bool setIndex(Corner& corner, int k, int value, size_t poolSize) {
+            if (value == 0) return false;
+            corner.flags |= uint8_t(1 << k);
+            if (value > 0) {
+                corner.index[k] = value - 1;
+            }
+            else {
+                corner.index[k] = int(poolSize) + value;
+                corner.flags |= uint8_t(1 << (k + 3));
+            }
+            return true;
+        }
+
+        // f v v v / f v/t v/t v/t / f v//n v//n v//n / f v/t/n v/t/n v/t/n
+        bool parseFace(const char* p, const char* end, ObjChunk& chunk) {
+            size_t begin = chunk.corners.size();
+            int count = 0;
+            while (true) {
+                p = skipSpace(p, end);
+                if (p >= end || *p == '\r' || *p == '#') break;
+                if (count == 3) {
+                    chunk.error = "Only Triangulated mesh is supported!";
+                    return false;
+                }
+                Corner corner{ {0, 0, 0}, 0 };
+                int value;
+                bool ok = parseInt(p, end, value) && setIndex(corner, 0, value, chunk.positions.size());
+                if (ok && p < end && *p == '/') {
+                    p++;
+                    if (p < end && *p != '/') {
+                        ok = parseInt(p, end, value) && setIndex(corner, 1, value, chunk.uvs.size());
+                    }
+                    if (ok && p < end && *p == '/') {
+                        p++;
+                        ok = parseInt(p, end, value) && setIndex(corner, 2, value, chunk.normals.size());
+                    }
+                }
+                if (!ok) {
+                    chunk.error = "Invalid face index!";
+                    return false;
+                }
+                chunk.corners.push_back(corner);
+                count++;
+            }
+            if (count < 3) {
+                chunk.corners.resize(begin);
+                chunk.error = ".obj file must be triangulated.";
+                return false;
+            }
+            return true;
+        }
+
+        void parseChunk(const char* begin, const char* end, ObjChunk& chunk) {
+            const char* p = begin;
+            while (p < end) {
+                const char* lineEnd = static_cast<const char*>(memchr(p, '\n', size_t(end - p)));
+                if (lineEnd == nullptr) lineEnd = end;
+                const char* q = skipSpace(p, lineEnd);
+                const char* kEnd = tokenEnd(q, lineEnd);
+                string_view key{ q, size_t(kEnd - q) };
+                auto argument = [&]() {
+                    const char* a = skipSpace(kEnd, lineEnd);
+                    return string_view{ a, size_t(tokenEnd(a, lineEnd) - a) };
+                };
+                // v 
+                if (key == "v") {
+                    Vec3 v;
+                    v.x = parseFloat(kEnd, lineEnd);
+                    v.y = parseFloat(kEnd, lineEnd);
+                    v.z = parseFloat(kEnd, lineEnd);
+                    chunk.positions.push_back(v);
+                }
+                // vt
+                else if (key == "vt") {
+                    Vec2 uv;
+                    uv.x = parseFloat(kEnd, lineEnd);
+                    uv.y = parseFloat(kEnd, lineEnd);
+                    chunk.uvs.push_back(uv);
+                }
+                // vn㷨
+                else if (key == "vn") {
+                    Vec3 n;
+                    n.x = parseFloat(kEnd, lineEnd);
+                    n.y = parseFloat(kEnd, lineEnd);
+                    n.z = parseFloat(kEnd, lineEnd);
+                    chunk.normals.push_back(n);
+                }
+                // f: , ǻ
+                else if (key == "f") {
+                    if (!parseFace(kEnd, lineEnd, chunk)) return;
+                }
+                // o
+                else if (key == "o" || key == "g") {
+                    chunk.directives.push_back({ Directive::Type::GROUP, chunk.corners.size() / 3, argument() });
+                }
+                else if (key == "usemtl") {
+                    chunk.directives.push_back({ Directive::Type::USEMTL, chunk.corners.size() / 3, argument() });
+                }
+                else if (key == "mtllib") {
+                    chunk.directives.push_back({ Directive::Type::MTLLIB, chunk.corners.size() / 3, argument() });
+                }
+                p = lineEnd + 1;
+            }
+        }
+    }
+
     inline
     TextureItem loadTexture(const string& filePath, const string& fileName) {
         ImageLoader imageLoader{};
@@ -19,14 +244,12 @@ namespace NRenderer
         auto ti = TextureItem{};
         ti.texture = SharedTexture{new Texture{}};
         ti.name = fileName;
-        ti.texture->width = image.width;
-        ti.texture->height = image.height;
-        ti.texture->rgba = new RGBA[image.width*image.height];
+        auto rgba = ti.texture->allocate(image.width, image.height);
         for (int i = 0; i < image.width * image.height; i++) {
-            ti.texture->rgba[i].r = image.data[i*4];
-            ti.texture->rgba[i].g = image.data[i*4 + 1];
-            ti.texture->rgba[i].b = image.data[i*4 + 2];
-            ti.texture->rgba[i].a = image.data[i*4 + 3];
+            rgba[i].r = image.data[i*4];
+            rgba[i].g = image.data[i*4 + 1];
+            rgba[i].b = image.data[i*4 + 2];
+            rgba[i].a = image.data[i*4 + 3];
         }
         ti.glId = GlImage::loadImage(ti.texture->rgba, {image.width, image.height});
         return ti;
@@ -113,6 +336,7 @@ namespace NRenderer
             }
             else if (token == "map_kd") {
                 ss>>token;
+                dependencies.push_back(path + token);
                 auto ti = loadTexture(path, token);
                 if (ti.texture != nullptr) {
                     Handle t{ (unsigned int)asset.textureItems.size() };
@@ -123,6 +347,7 @@ namespace NRenderer
             }
             else if (token == "map_ks") {
                 ss>>token;
+                dependencies.push_back(path + token);
                 auto ti = loadTexture(path, token);
                 if (ti.texture != nullptr) {
                     Handle t{ (unsigned int)asset.textureItems.size() };
@@ -133,6 +358,7 @@ namespace NRenderer
             }
             else if (token == "map_bump" || token == "bump") {
                 ss>>token;
+                dependencies.push_back(path + token);
                 auto ti = loadTexture(path, token);
                 if (ti.texture != nullptr) {
                     Handle t{ (unsigned int)asset.textureItems.size() };
@@ -148,8 +374,9 @@ namespace NRenderer
     }
 
     bool ObjImporter::import(Asset& asset, const string& path) {
-        ifstream file(path);
-        if (!file.is_open()) {
+        dependencies.clear();
+        MappedFile file;
+        if (!file.open(path)) {
             lastErrorInfo = "File does not exist!";
             return false;
         }
@@ -177,217 +404,143 @@ namespace NRenderer
         modelItem.name = modelName;
         modelItem.model = make_shared<Model>();
 
-        string currLine;
-        bool hasMtl = false;
-        
-        string token;
-        stringstream ss{};
+        // п, ÿһ߳̽; Сļֻһ߳
+        const char* data = file.data();
+        const size_t size = file.size();
+        const size_t minChunkSize = size_t(1) << 20;
+        size_t taskNums = std::min<size_t>(std::max(1u, thread::hardware_concurrency()), size / minChunkSize + 1);
+        vector<const char*> bounds(taskNums + 1, data + size);
+        bounds[0] = data;
+        for (size_t i = 1; i < taskNums; i++) {
+            const char* p = std::max(bounds[i - 1], data + size * i / taskNums);
+            while (p < data + size && *(p - 1) != '\n') p++;
+            bounds[i] = p;
+        }
+        vector<ObjChunk> chunks(taskNums);
+        {
+            vector<thread> t;
+            for (size_t i = 0; i < taskNums; i++) {
+                t.emplace_back(parseChunk, bounds[i], bounds[i + 1], std::ref(chunks[i]));
+            }
+            for (auto& th : t) th.join();
+        }
+        for (auto& chunk : chunks) {
+            if (!chunk.error.empty()) {
+                successFlag = false;
+                lastErrorInfo = chunk.error;
+                break;
+            }
+        }
 
-        unordered_map<string, size_t> mtlMap;
-        
+        // ϲ, offset[i] ǵ i ĵһȫֳе±
         vector<Vec3> positions;
-        vector<Vec3> normals;
         vector<Vec2> uvs;
+        vector<Vec3> normals;
+        vector<size_t> offset[3];
+        for (auto& o : offset) o.assign(taskNums, 0);
+        for (size_t i = 0; i < taskNums; i++) {
+            offset[0][i] = positions.size();
+            offset[1][i] = uvs.size();
+            offset[2][i] = normals.size();
+            positions.insert(positions.end(), chunks[i].positions.begin(), chunks[i].positions.end());
+            uvs.insert(uvs.end(), chunks[i].uvs.begin(), chunks[i].uvs.end());
+            normals.insert(normals.end(), chunks[i].normals.begin(), chunks[i].normals.end());
+            chunks[i].positions = {};
+            chunks[i].uvs = {};
+            chunks[i].normals = {};
+        }
+        const size_t poolSize[3] = { positions.size(), uvs.size(), normals.size() };
 
-        using _mp = shared_ptr<unordered_map<Index, Index>>;
-        _mp pMap{nullptr};
-        _mp tMap{nullptr};
-        _mp nMap{nullptr};
-
-        NodeItem* currNodePtr = nullptr;
-
-        Handle currUsedMtl{};
-
-        while (getline(file, currLine)) {
-            ss<<currLine;
-            ss>>token;
-
-            if (token == "mtllib") {
-                string mtlFileName;
-                ss>>mtlFileName;
+        unordered_map<string, size_t> mtlMap;
+        IndexMap maps[3];
+        Mesh* currMesh = nullptr;
+
+        auto newNode = [&](const string& name) {
+            modelItem.model->nodes.push_back(asset.nodeItems.size());
+            asset.nodeItems.push_back({});
+            auto& nodeItem = asset.nodeItems.back();
+            nodeItem.name = name;
+            nodeItem.node = make_shared<Node>();
+            nodeItem.node->type = Node::Type::MESH;
+            nodeItem.node->model = asset.modelItems.size();
+            nodeItem.node->entity = asset.meshes.size();
+            asset.meshes.push_back(make_shared<Mesh>());
+            currMesh = asset.meshes.back().get();
+            for (auto& m : maps) m.reset();
+        };
+
+        auto apply = [&](const Directive& d) {
+            string arg{ d.arg };
+            if (d.type == Directive::Type::GROUP) {
+                newNode(arg.empty() ? "undefined" : arg);
+            }
+            else if (d.type == Directive::Type::USEMTL) {
+                auto mtlItr = mtlMap.find(arg);
+                if (mtlItr == mtlMap.end()) {
+                    lastErrorInfo = "Cannot find material: " + arg;
+                    return false;
+                }
+                if (currMesh == nullptr) newNode("Undefined");
+                Handle currUsedMtl{};
+                currUsedMtl.setIndex(mtlItr->second);
+                currMesh->material = currUsedMtl;
+            }
+            else {
                 auto npos = path.find_last_of("\\/");
-                string mtlPath;
-                mtlPath = path.substr(0, npos + 1);
-                auto mtlFilePath = mtlPath + mtlFileName;
-                ifstream mtlFile(mtlFilePath);
+                string mtlPath = path.substr(0, npos + 1);
+                dependencies.push_back(mtlPath + arg);
+                ifstream mtlFile(mtlPath + arg);
                 if (!mtlFile.is_open()) {
-                    successFlag = false;
                     lastErrorInfo = "Cannot file .mtl file";
-                    break;
-                }
-                successFlag = parseMtl(asset, mtlPath, mtlFile, mtlMap);
-                if (successFlag) {
-                    hasMtl = true;
-                }
-                else {
-                    break;
-                }
-            }
-            else if (token == "usemtl") {
-                string mtlName;
-                ss>>mtlName;
-                auto mtlItr = mtlMap.find(mtlName);
-                if (mtlItr != mtlMap.end()) {
-                    currUsedMtl.setIndex(mtlItr->second);
-                    asset.meshes[currNodePtr->node->entity]->material = currUsedMtl;
-                }
-                else {
-                    successFlag = false;
-                    lastErrorInfo = "Cannot find material: " + mtlName;
-                    break;
+                    return false;
                 }
+                if (!parseMtl(asset, mtlPath, mtlFile, mtlMap)) return false;
             }
-            // v 
-            else if (token == "v") {
-                float f1, f2, f3;
-                ss>>f1>>f2>>f3;
-                positions.push_back({ f1, f2, f3 });
-            }
-            // vt
-            else if (token == "vt") {
-                float f1, f2;
-                ss>>f1>>f2;
-                uvs.push_back({ f1, f2 });
+            return true;
+        };
+
+        // ȫ± -> ±, һγʱѶ׷ӽ
+        auto remap = [](IndexMap& map, size_t key, auto& pool, const auto& source, auto& indices) {
+            Index local;
+            if (map.findOrInsert(uint32_t(key), Index(pool.size()), local)) {
+                pool.push_back(source[key]);
             }
-            // vn㷨
-            else if (token == "vn") {
-                float f1, f2, f3;
-                ss>>f1>>f2>>f3;
-                normals.push_back({ f1, f2, f3 });
-            }
-            // o
-            else if (token == "o" || token == "g") {
-                string name;
-                if (ss.eof()) {
-                    name = "undefined";
-                }
-                else {
-                    ss>>name;
-                }
-                modelItem.model->nodes.push_back(asset.nodeItems.size());
-                asset.nodeItems.push_back({});
-                pMap = make_shared<unordered_map<Index, Index> >();
-                tMap = make_shared<unordered_map<Index, Index> >();
-                nMap = make_shared<unordered_map<Index, Index> >();
-                currNodePtr = &(*(asset.nodeItems.end() - 1));
-                currNodePtr->name = name;
-                currNodePtr->node = make_shared<Node>();
-                currNodePtr->node->type = Node::Type::MESH;
-                currNodePtr->node->model = asset.modelItems.size();
-                currNodePtr->node->entity = asset.meshes.size();
-                asset.meshes.push_back(make_shared<Mesh>());
-
-                // cout<<"new object"<<endl;
-            }
-            // f: , ǻ
-            else if (token == "f") {
-                if (currNodePtr == nullptr) {
-                    modelItem.model->nodes.push_back(asset.nodeItems.size());
-                    asset.nodeItems.push_back({});
-                    pMap = make_shared<unordered_map<Index, Index> >();
-                    tMap = make_shared<unordered_map<Index, Index> >();
-                    nMap = make_shared<unordered_map<Index, Index> >();
-                    currNodePtr = &(*(asset.nodeItems.end() - 1));
-                    currNodePtr->name = "Undefined";
-                    currNodePtr->node = make_shared<Node>();
-                    currNodePtr->node->type = Node::Type::MESH;
-                    currNodePtr->node->model = asset.modelItems.size();
-                    currNodePtr->node->entity = asset.meshes.size();
-                    asset.meshes.push_back(make_shared<Mesh>());
-                }
-
-                long v{0}, t{0}, n{0};
-                char c = '\0';
-
-                exception e(".obj file must be triangulated.");
-
-                Index vpi[3];
-                Index vti[3];
-                Index vni[3];
-                for (int i=0; i<3; i++) {
-                    // example: f v/t/n v/t/n v/t/n
-
-                    vpi[i] = -1;
-                    vti[i] = -1;
-                    vni[i] = -1;
-
-                    if(ss.eof()) throw e;
-
-                    string vertexToken;
-                    ss>>vertexToken;
-                    stringstream vertexStream{vertexToken};
-                    auto begin = vertexToken.find_first_of('/');
-                    auto end = vertexToken.find_last_of('/');
-                    // f v v v
-                    if (begin == vertexToken.npos) {
-                        vertexStream>>v;
-                        t = -1;
-                        n = -1;
-                    }
-                    // f v/t v/t v/t
-                    else if (begin == end) {
-                        vertexStream>>v>>c>>t;
-                        n = -1;
-                    }
-                    // f v//n v//n v//n
-                    else if (begin + 1 == end) {
-                        vertexStream>>v>>c>>c>>n;
-                        t = -1;
+            indices.push_back(local);
+        };
+
+        for (size_t c = 0; c < taskNums && successFlag; c++) {
+            auto& chunk = chunks[c];
+            size_t faces = chunk.corners.size() / 3;
+            size_t d = 0;
+            for (size_t f = 0; f <= faces && successFlag; f++) {
+                while (d < chunk.directives.size() && chunk.directives[d].face == f) {
+                    if (!apply(chunk.directives[d++])) {
+                        successFlag = false;
+                        break;
                     }
-                    else {
-                        vertexStream>>v>>c>>t>>c>>n;
-                    }
-
-                    if (v != -1) {
-                       // ҵ
-                        auto finded = pMap->find(v);
-                        if (finded != pMap->end()) {
-                            vpi[i] = finded->second;
-                        }
-                        else {
-                            auto idx = asset.meshes[currNodePtr->node->entity]->positions.size();
-                            vpi[i] = idx;
-                            pMap->insert({v, idx});
-                            asset.meshes[currNodePtr->node->entity]->positions.push_back(positions[v - 1]);
-                        }
-                        asset.meshes[currNodePtr->node->entity]->positionIndices.push_back(vpi[i]);
-                    }
-                    if (t != -1) {
-                        auto finded = tMap->find(t);
-                        if (finded != tMap->end()) {
-                            vti[i] = finded->second;
-                        }
-                        else {
-                            auto idx = asset.meshes[currNodePtr->node->entity]->uvs.size();
-                            vti[i] = idx;
-                            tMap->insert({t, idx});
-                            asset.meshes[currNodePtr->node->entity]->uvs.push_back(uvs[t - 1]);
-                        }
-                        asset.meshes[currNodePtr->node->entity]->uvIndices.push_back(vti[i]);
-
-                    }
-                    if (n != -1) {
-                        auto finded = nMap->find(n);
-                        if (finded != nMap->end()) {
-                            vni[i] = finded->second;
-                        }
-                        else {
-                            auto idx = asset.meshes[currNodePtr->node->entity]->normals.size();
-                            vni[i] = idx;
-                            nMap->insert({n, idx});
-                            asset.meshes[currNodePtr->node->entity]->normals.push_back(normals[n - 1]);
+                }
+                if (!successFlag || f == faces) break;
+                if (currMesh == nullptr) newNode("Undefined");
+                for (int i = 0; i < 3; i++) {
+                    auto& corner = chunk.corners[f*3 + i];
+                    size_t key[3];
+                    for (int k = 0; k < 3; k++) {
+                        if (!(corner.flags & (1 << k))) continue;
+                        long long idx = corner.index[k];
+                        if (corner.flags & (1 << (k + 3))) idx += (long long)offset[k][c];
+                        if (idx < 0 || idx >= (long long)poolSize[k]) {
+                            successFlag = false;
+                            lastErrorInfo = "Index out of range!";
+                            break;
                         }
-                        asset.meshes[currNodePtr->node->entity]->normalIndices.push_back(vni[i]);
+                        key[k] = size_t(idx);
                     }
-                }
-                if (!ss.eof()) {
-                    successFlag = false;
-                    lastErrorInfo = "Only Triangulated mesh is supported!";
-                    break;
+                    if (!successFlag) break;
+                    if (corner.flags & 1) remap(maps[0], key[0], currMesh->positions, positions, currMesh->positionIndices);
+                    if (corner.flags & 2) remap(maps[1], key[1], currMesh->uvs, uvs, currMesh->uvIndices);
+                    if (corner.flags & 4) remap(maps[2], key[2], currMesh->normals, normals, currMesh->normalIndices);
                 }
             }
-            ss.clear();
-            ss.str("");
         }
 
         asset.modelItems.push_back(modelItem);
@@ -130,6 +130,11 @@ namespace NRenderer
                 ss>>f1>>f2>>f3;
                 (asset.modelItems.end() - 1)->model->translation = {f1, f2, f3};
             }
+            else if (token == "Rotation") {
+                float f1, f2, f3;
+                ss>>f1>>f2>>f3;
+                (asset.modelItems.end() - 1)->model->rotation = {f1, f2, f3};
+            }
             else if (token == "Scale") {
                 float f1, f2, f3;
                 ss>>f1>>f2>>f3;
@@ -493,6 +498,8 @@ namespace NRenderer
     }
 
     bool ScnImporter::import(Asset& asset, const string& path) {
+        // .scn 不引用其他文件
+        dependencies.clear();
         ifstream file(path);
         if (!file.is_open()) {
             lastErrorInfo = "File does not exist!";
@@ -8,9 +8,11 @@ namespace NRenderer
         ImageLoader imgLoader;
         auto img = imgLoader.load(path);
         SharedTexture spTexture{new Texture()};
-        spTexture->width = img->width;
-        spTexture->height = img->height;
-        spTexture->rgba = (RGBA*)img->data;
+        // 直接接管 Image 的像素, 不再复制
+        shared_ptr<RGBA[]> pixels{ (RGBA*)img->data, [](RGBA* p) { delete[] (float*)p; } };
+        spTexture->adopt(pixels, img->width, img->height);
+        img->data = nullptr;
+        delete img;
         auto id = GlImage::loadImage(spTexture->rgba, {spTexture->width, spTexture->height});
         TextureItem ti;
         ti.glId = id;
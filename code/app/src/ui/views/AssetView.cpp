@@ -308,6 +308,7 @@ namespace NRenderer
                 ImGui::TextUnformatted(to_string(uiContext.previewModel).c_str());
                 ImGui::Separator();
                 ImGui::DragFloat3(("Translation##ModelSelected"+to_string(uiContext.previewModel)).c_str(), &mi.model->translation.x, 0.5, 0, 0);
+                ImGui::DragFloat3(("Rotation##ModelSelected"+to_string(uiContext.previewModel)).c_str(), &mi.model->rotation.x, 1, 0, 0);
                 ImGui::DragFloat3(("Scale##ModelSelected"+to_string(uiContext.previewModel)).c_str(), &mi.model->scale.x, 0.05, 0, 0);
 
             }
@@ -42,6 +42,27 @@ namespace NRenderer
         ImGui::InputScalar("Depth", ImGuiDataType_U32, &rs.depth, &intStep, NULL, "%u");
         ImGui::InputScalar("Sample Nums", ImGuiDataType_U32, &rs.samplesPerPixel, &intStep, NULL, "%u");
         ImGui::InputScalar("Photons Nums", ImGuiDataType_U32, &rs.photonsPerLight, &intStep, NULL, "%u");
+        ImGui::InputScalar("Caustic Photons", ImGuiDataType_U32, &rs.causticPhotonsPerLight, &intStep, NULL, "%u");
+        ImGui::Checkbox("Photon Diagnostics", &rs.photonDiagnostics);
+        ImGui::InputScalar("VPL Paths", ImGuiDataType_U32, &rs.vplPathsPerLight, &intStep, NULL, "%u");
+        ImGui::InputScalar("Radiosity Resolution", ImGuiDataType_U32, &rs.radiosityResolution, &intStep, NULL, "%u");
+        const string builderStr[3] = {"Median", "LBVH", "SBVH"};
+        if (ImGui::BeginCombo("BVH Builder", builderStr[rs.bvhBuilder].c_str())) {
+            for (int i=0; i<3; i++) {
+                bool selected = rs.bvhBuilder == i;
+                if (ImGui::Selectable((builderStr[i]+"##BVHBuilderItem").c_str(), &selected)) {
+                    rs.bvhBuilder = RenderSettings::BVHBuilder(i);
+                }
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::Checkbox("Lazy Build", &rs.lazyBuild);
+        ImGui::Checkbox("ReSTIR DI", &rs.restirDI);
+        ImGui::Checkbox("Path Guiding", &rs.pathGuiding);
+        ImGui::Checkbox("Radiance Cache", &rs.radianceCache);
+        ImGui::InputScalar("Cache Bounces", ImGuiDataType_U32, &rs.radianceCacheBounces, &intStep, NULL, "%u");
+        ImGui::InputScalar("Cache Cell Pixels", ImGuiDataType_U32, &rs.radianceCacheCellPixels, &intStep, NULL, "%u");
+        ImGui::Checkbox("Denoise", &rs.denoise);
     }
     void SceneView::ambientSetting() {
         auto& as = manager.renderSettingsManager.ambientSettings;
@@ -3,6 +3,7 @@
 
 #include "glm/ext/matrix_transform.hpp"
 #include "glm/gtc/matrix_transform.hpp"
+#include "scene/WorldTransform.hpp"
 
 namespace NRenderer
 {
@@ -132,6 +133,59 @@ namespace NRenderer
             }
             ImGui::EndCombo();
         }
+        if (viewType == ViewType::RESULT) {
+            // 组件通过 FrameBuffer 提交了多个通道时, 可以切换显示的通道
+            auto channels = getServer().screen.getChannels();
+            if (!channels.empty()) {
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(120);
+                auto shown = getServer().screen.getShownChannel();
+                if (ImGui::BeginCombo("##Channel", shown.c_str())) {
+                    for (auto& c : channels) {
+                        bool selected = c.name == shown;
+                        if (ImGui::Selectable(c.name.c_str(), &selected)) {
+                            getServer().screen.showChannel(c.name);
+                        }
+                    }
+                    ImGui::EndCombo();
+                }
+            }
+            // 色调映射只作用于线性颜色通道, 调整后立即重新生成显示图像
+            if (FrameBuffer::isColor(getServer().screen.getShownChannel())) {
+                auto options = getServer().screen.getToneMapOptions();
+                bool changed = false;
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(90);
+                changed |= ImGui::DragFloat("##Exposure", &options.exposure, 0.05f, -10.f, 10.f, "EV %+.2f");
+                const char* curveLabels[3] = { "Clamp", "Reinhard", "ACES" };
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(90);
+                if (ImGui::BeginCombo("##ToneCurve", curveLabels[int(options.curve)])) {
+                    for (int i=0; i < 3; i++) {
+                        bool selected = i == int(options.curve);
+                        if (ImGui::Selectable(curveLabels[i], &selected)) {
+                            options.curve = ToneMapOptions::Curve(i);
+                            changed = true;
+                        }
+                    }
+                    ImGui::EndCombo();
+                }
+                const char* transferLabels[2] = { "sRGB", "Gamma 2.0" };
+                ImGui::SameLine();
+                ImGui::SetNextItemWidth(90);
+                if (ImGui::BeginCombo("##Transfer", transferLabels[int(options.transfer)])) {
+                    for (int i=0; i < 2; i++) {
+                        bool selected = i == int(options.transfer);
+                        if (ImGui::Selectable(transferLabels[i], &selected)) {
+                            options.transfer = ToneMapOptions::Transfer(i);
+                            changed = true;
+                        }
+                    }
+                    ImGui::EndCombo();
+                }
+                if (changed) getServer().screen.setToneMapOptions(options);
+            }
+        }
         if (viewType == ViewType::PREVIEW) {
             ImGui::SameLine();
             if (previewCoordinateType == CoordinateType::LEFT_HANDED) {
@@ -314,20 +368,18 @@ namespace NRenderer
         Mat4x4 modelMat{1};
         auto& model = *asset.modelItems[n.node->model].model;
         if (n.node->type == Node::Type::TRIANGLE) {
-            modelMat = glm::translate(modelMat, model.translation);
-            modelMat = glm::scale(modelMat, model.scale);
+            modelMat = modelMatrix(model);
             nodeShader.setMat4x4("model", modelMat);
             glDrawArrays(GL_TRIANGLES, 0, 3);
         }
         else if (n.node->type == Node::Type::PLANE) {
-            modelMat = glm::translate(modelMat, model.translation);
-            modelMat = glm::scale(modelMat, model.scale);
+            modelMat = modelMatrix(model);
             nodeShader.setMat4x4("model", modelMat);
             glDrawArrays(GL_LINE_LOOP, 0, 4);
         }
         else if (n.node->type == Node::Type::SPHERE) {
             const Vec3 norm{0, 0, -1};
-            Vec3 pos = asset.spheres[n.node->entity]->position + model.translation;
+            Vec3 pos = modelMatrix(model)*Vec4{asset.spheres[n.node->entity]->position, 1};
             Vec3 dir = camera.position - camera.lookAt;
             dir = -glm::normalize(dir);
             float cos_theta = glm::dot(dir, norm);
@@ -342,8 +394,7 @@ namespace NRenderer
             glDrawArrays(GL_LINE_STRIP, 0, n.externalDrawData->positions.size());
         }
         else if (n.node->type == Node::Type::MESH) {
-            modelMat = glm::translate(modelMat, model.translation);
-            modelMat = glm::scale(modelMat, model.scale);
+            modelMat = modelMatrix(model);
             nodeShader.setMat4x4("model", modelMat);
             auto& m = *asset.meshes[n.node->entity];
             glDrawElements(GL_TRIANGLES, m.positionIndices.size(), GL_UNSIGNED_INT, 0);
@@ -0,0 +1,96 @@
+#include "utilities/MappedFile.hpp"
+
+#ifdef _WIN32
+#include "Windows.h"
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace NRenderer
+{
+    MappedFile::MappedFile()
+        : ptr                   (nullptr)
+        , length                (0)
+#ifdef _WIN32
+        , fileHandle            (nullptr)
+        , mappingHandle         (nullptr)
+#else
+        , fd                    (-1)
+#endif
+    {}
+
+    MappedFile::~MappedFile() {
+        close();
+    }
+
+#ifdef _WIN32
+    bool MappedFile::open(const string& path) {
+        close();
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+            OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE) return false;
+        fileHandle = file;
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            close();
+            return false;
+        }
+        length = size_t(fileSize.QuadPart);
+        if (length == 0) return true;
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping == NULL) {
+            close();
+            return false;
+        }
+        mappingHandle = mapping;
+        ptr = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        if (ptr == nullptr) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (ptr) UnmapViewOfFile(ptr);
+        if (mappingHandle) CloseHandle(mappingHandle);
+        if (fileHandle) CloseHandle(fileHandle);
+        ptr = nullptr;
+        length = 0;
+        mappingHandle = nullptr;
+        fileHandle = nullptr;
+    }
+#else
+    bool MappedFile::open(const string& path) {
+        close();
+        fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            close();
+            return false;
+        }
+        length = size_t(st.st_size);
+        if (length == 0) return true;
+        void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close();
+            return false;
+        }
+        madvise(p, length, MADV_SEQUENTIAL);
+        ptr = static_cast<const char*>(p);
+        return true;
+    }
+
+    void MappedFile::close() {
+        if (ptr) munmap(const_cast<char*>(ptr), length);
+        if (fd >= 0) ::close(fd);
+        ptr = nullptr;
+        length = 0;
+        fd = -1;
+    }
+#endif
+}
@@ -9,6 +9,8 @@
 #include "shaders/ShaderCreator.hpp"
 #include "EnvironmentMap.hpp"
 #include "accelerator/BVH.hpp"
+#include "accelerator/InstanceBVH.hpp"
+#include "guiding/SDTree.hpp"
 
 #include <tuple>
 
@@ -34,6 +36,15 @@ namespace EnvMapPathTracer
         vector<SharedShader> shaderPrograms;
         EnvironmentMap envMap;
         BVH bvh;
+        // 网格实例的两层 BVH
+        InstanceBVH instances;
+
+        // 路径引导: 非 delta 材质以该概率按 BSDF 采样, 否则按 SD-tree 学到的入射光分布采样
+        static constexpr float bsdfSamplingFraction = 0.5f;
+        bool guiding;
+        // 本轮是否把样本记录到 SD-tree, 最后一轮只采样不记录
+        bool training = false;
+        SDTree guide;
 
     public:
         EnvMapPathTracerRenderer(SharedScene spScene)
@@ -45,6 +56,7 @@ namespace EnvMapPathTracer
             height = scene.renderOption.height;
             depth = scene.renderOption.depth;
             samples = scene.renderOption.samplesPerPixel;
+            guiding = scene.renderOption.pathGuiding;
 
             // 初始化环境贴图
             if (scene.ambient.type == Ambient::Type::ENVIROMENT_MAP &&
@@ -60,8 +72,10 @@ namespace EnvMapPathTracer
         void release(const RenderResult& r);
 
     private:
-        void renderTask(RGBA* pixels, int width, int height, int off, int step);
-        RGB gamma(const RGB& rgb);
+        // 每个像素追加 passSamples 个样本到 accum
+        void renderTask(RGB* accum, int width, int height, int off, int step, int passSamples);
+        void renderPass(RGB* accum, int passSamples);
+        AABB sceneBounds() const;
         RGB trace(const Ray& ray, int currDepth);
         HitRecord closestHitObject(const Ray& r);
         tuple<float, Vec3> closestHitLight(const Ray& r);
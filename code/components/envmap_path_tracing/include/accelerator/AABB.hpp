@@ -26,7 +26,8 @@ namespace EnvMapPathTracer
                 if (invD < 0.0f) std::swap(t0, t1);
                 tMin = t0 > tMin ? t0 : tMin;
                 tMax = t1 < tMax ? t1 : tMax;
-                if (tMax <= tMin) return false;
+                // 允许区间退化为一点: 平面网格的包围盒在法线方向上没有厚度
+                if (tMax < tMin) return false;
             }
             return true;
         }
@@ -45,6 +46,16 @@ namespace EnvMapPathTracer
             return (min + max) * 0.5f;
         }
 
+        float surfaceArea() const {
+            Vec3 d = max - min;
+            if (d.x < 0 || d.y < 0 || d.z < 0) return 0;
+            return 2.f*(d.x*d.y + d.y*d.z + d.z*d.x);
+        }
+
+        bool operator==(const AABB& box) const {
+            return min == box.min && max == box.max;
+        }
+
         int longestAxis() const {
             Vec3 d = max - min;
             if (d.x > d.y && d.x > d.z) return 0;
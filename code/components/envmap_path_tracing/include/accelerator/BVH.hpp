@@ -2,43 +2,45 @@
 #ifndef __ENVMAP_BVH_HPP__
 #define __ENVMAP_BVH_HPP__
 
-#include "AABB.hpp"
+#include "BVHTree.hpp"
 #include "intersections/HitRecord.hpp"
-#include "scene/Scene.hpp"
-#include <vector>
-#include <memory>
 
 namespace EnvMapPathTracer
 {
     using namespace NRenderer;
     using namespace std;
 
-    // 图元类型
-    enum class PrimitiveType { TRIANGLE, SPHERE };
-
-    // 图元引用
-    struct Primitive {
-        PrimitiveType type;
-        size_t index;
-        AABB bounds;
+    // refit 需要而压缩节点中没有保存的信息, 与缓存的树放在一起
+    struct RefitState {
+        // 上一次看到的图元包围盒, 三角形在前、球在后, 用于找出移动过的图元
+        vector<AABB> primBounds;
+        // 每个节点未量化的包围盒, 以及遍历时解码得到的包围盒
+        vector<AABB> exact;
+        vector<AABB> decoded;
+        vector<uint32_t> parent;
+        // primRefs 中每个引用所在的叶子
+        vector<uint32_t> refLeaf;
+        // 各节点 表面积 x 权重 之和, 除以根节点表面积即为 SAH 代价; 逐次增量更新, 用双精度避免累积误差
+        double weightedArea = 0;
+        // 处理过程中标记已入队的节点, 用完后清零
+        vector<uint8_t> queued;
     };
 
-    // BVH 节点
-    struct BVHNode {
-        AABB bounds;
-        int left = -1;   // 左子节点索引，-1 表示叶子
-        int right = -1;  // 右子节点索引
-        int primStart = 0;
-        int primCount = 0;
-
-        bool isLeaf() const { return left == -1; }
-    };
+    // 场景中松散的三角形与球的 BVH; 由 BVHTree 构建, 完成后压缩为 CompactBVH 并释放构建用的数组
+    // 组件每次渲染都会重建场景, 上一次的树保存在静态缓存中
+    // 图元数量不变时 (如只移动了模型) 保留拓扑: 与上次的图元包围盒比较找出移动过的图元,
+    // 只沿它们所在的叶子向上更新包围盒, 再只重新量化包围盒或参照盒变化了的节点; 没有图元移动时不处理任何节点
+    // 更新后的 SAH 代价超过完整构建时的 refitThreshold 倍才重新构建
+    // lazyBuild 时只建根节点, 内部节点在第一次被访问时由访问它的线程划分, 其余线程等待; 这种模式不压缩
+    class BVH : public BVHTree {
+    public:
+        static constexpr float refitThreshold = 1.3f;
 
-    class BVH {
     private:
-        vector<BVHNode> nodes;
-        vector<Primitive> primitives;
         const Scene* scene = nullptr;
+        bool refitted = false;
+        float cost = 0;
+        size_t updated = 0;
 
     public:
         BVH() = default;
@@ -46,11 +48,23 @@ namespace EnvMapPathTracer
         void build(const Scene& scn);
         HitRecord intersect(const Ray& ray, float tMin, float tMax) const;
 
+        // 本次 build 是否只做了 refit
+        bool wasRefitted() const { return refitted; }
+        // refit 时包围盒或量化结果有变化的节点数
+        size_t refittedNodes() const { return updated; }
+        float sahCost() const { return cost; }
+
     private:
-        int buildRecursive(int start, int end);
+        void collectPrimitives(const Scene& scn);
+        // 完整构建后记录 refit 所需的信息
+        void initRefitState(const Scene& scn, const CompactBVH& c, RefitState& state) const;
+        // 返回 false 表示质量退化, 需要完整构建
+        bool refit(const Scene& scn, CompactBVH& c, RefitState& state, float builtCost);
+        AABB primitiveBounds(const Scene& scn, size_t key) const;
         AABB computeBounds(const Triangle& t) const;
         AABB computeBounds(const Sphere& s) const;
-        HitRecord intersectPrimitive(const Primitive& prim, const Ray& ray, float tMin, float tMax) const;
+        HitRecord intersectRef(uint32_t ref, const Ray& ray, float tMin, float tMax) const;
+        bool triangleOf(const Primitive& prim, Vec3 v[3]) const override;
     };
 }
 
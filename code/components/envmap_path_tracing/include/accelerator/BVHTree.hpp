@@ -0,0 +1,229 @@
+#pragma once
+#ifndef __ENVMAP_BVH_TREE_HPP__
+#define __ENVMAP_BVH_TREE_HPP__
+
+#include "AABB.hpp"
+#include "scene/Scene.hpp"
+#include <vector>
+#include <memory>
+#include <atomic>
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+
+namespace EnvMapPathTracer
+{
+    using namespace NRenderer;
+    using namespace std;
+
+    // 图元类型
+    enum class PrimitiveType { TRIANGLE, SPHERE };
+
+    // 图元引用
+    struct Primitive {
+        PrimitiveType type;
+        size_t index;
+        AABB bounds;
+    };
+
+    // BVH 节点
+    struct BVHNode {
+        AABB bounds;
+        int left = -1;   // 左子节点索引，-1 表示叶子
+        int right = -1;  // 右子节点索引
+        int primStart = 0;
+        int primCount = 0;
+
+        bool isLeaf() const { return left == -1; }
+    };
+
+    // 压缩后的遍历节点 (16 字节), 按深度优先排列, 左孩子紧跟在父节点之后
+    struct CompactNode {
+        // 左右孩子的包围盒, 以本节点解码后的包围盒为参照量化到 8 位, 解码结果总是包含真实包围盒
+        uint8_t childMin[2][3];
+        uint8_t childMax[2][3];
+        // 内部节点: 右孩子下标; 叶子: 最高位为 1, 28~30 位为图元数, 低 28 位为 primRefs 中的起始下标
+        uint32_t data;
+
+        static constexpr uint32_t leafFlag = 1u << 31;
+        bool isLeaf() const { return data & leafFlag; }
+        uint32_t right() const { return data; }
+        uint32_t primStart() const { return data & 0x0FFFFFFFu; }
+        uint32_t primCount() const { return (data >> 28) & 0x7u; }
+    };
+
+    // 完整构建后的遍历结构, 由静态缓存与各次渲染共享
+    struct CompactBVH {
+        static constexpr uint32_t sphereFlag = 1u << 31;
+        AABB rootBounds;
+        vector<CompactNode> nodes;
+        // 按叶子顺序排列的图元, 最高位为 1 表示球, 其余位为图元下标; 不再保存每个图元的包围盒
+        vector<uint32_t> primRefs;
+    };
+
+    // 量化值的解码: 0 与 255 分别精确对应参照盒的两端
+    inline float dequantize(float lo, float hi, uint8_t q) {
+        if (q == 0) return lo;
+        if (q == 255) return hi;
+        return lo + float(q) * ((hi - lo) * (1.f / 255.f));
+    }
+
+    inline AABB decodeChild(const AABB& parent, const CompactNode& node, int c) {
+        AABB box;
+        for (int a = 0; a < 3; a++) {
+            box.min[a] = dequantize(parent.min[a], parent.max[a], node.childMin[c][a]);
+            box.max[a] = dequantize(parent.min[a], parent.max[a], node.childMax[c][a]);
+        }
+        return box;
+    }
+
+    // 下界向下、上界向上取整, 并用与解码相同的计算校正, 保证解码后的盒子包含 child
+    inline void encodeChild(const AABB& parent, const AABB& child, CompactNode& node, int c) {
+        for (int a = 0; a < 3; a++) {
+            float lo = parent.min[a], hi = parent.max[a];
+            float extent = hi - lo;
+            int qMin = 0, qMax = 255;
+            if (extent > 0) {
+                qMin = std::clamp(int(std::floor((child.min[a] - lo) / extent * 255.f)), 0, 255);
+                qMax = std::clamp(int(std::ceil((child.max[a] - lo) / extent * 255.f)), 0, 255);
+                while (qMin > 0 && dequantize(lo, hi, qMin) > child.min[a]) qMin--;
+                while (qMax < 255 && dequantize(lo, hi, qMax) < child.max[a]) qMax++;
+            }
+            node.childMin[c][a] = uint8_t(qMin);
+            node.childMax[c][a] = uint8_t(qMax);
+        }
+    }
+
+    // 与图元来源无关的层次结构构建: 场景中的松散图元 (BVH) 与网格的面 (MeshBVH) 共用
+    // 派生类填好 primitives 后调用 buildNodes, 按 builder 生成 BVHNode, 再压缩为 CompactBVH 用于遍历
+    class BVHTree {
+    public:
+        // LBVH 构建后做几轮子树旋转, 以较小的代价找回部分 SAH 质量; 0 表示不做
+        static constexpr int lbvhRestructurePasses = 2;
+        // SBVH: 对象划分的两个孩子重叠部分的表面积超过根节点的 sbvhAlpha 倍时才尝试空间划分
+        static constexpr float sbvhAlpha = 1e-5f;
+        // 空间划分复制出的引用数不超过图元数的该倍数, 用完后跨越平面的引用整体放到一侧
+        static constexpr float sbvhDuplicationBudget = 1.f;
+
+        virtual ~BVHTree() = default;
+
+        bool isLazy() const { return lazy; }
+        // 已经生成的节点数, 按需构建时随渲染增长
+        size_t builtNodes() const;
+        // 遍历结构占用的字节数
+        size_t footprint() const;
+
+    protected:
+        // 构建用的节点与图元, 按需构建时也用于遍历
+        vector<BVHNode> nodes;
+        vector<Primitive> primitives;
+        shared_ptr<CompactBVH> compact;
+
+        // 按需构建的状态; 节点数组预先分配好, 划分时只领取下标, 不会扩容
+        enum NodeState : int { UNBUILT, BUILDING, BUILT };
+        bool lazy = false;
+        RenderOption::BVHBuilder builder = RenderOption::BVHBuilder::MEDIAN;
+        vector<uint32_t> mortonCodes;
+        unique_ptr<atomic<int>[]> nodeState;
+        atomic<int> nodeCount{0};
+
+        // primitives 已经填好, 按 builder 与 lazy 生成节点
+        void buildNodes();
+        float nodeCost() const;
+        // 生成 compact 并释放构建用的数组; 叶子中的图元引用由 refOf 得到
+        void compress();
+        void expand(int idx) const;
+        AABB rootBounds() const { return compact ? compact->rootBounds : nodes.empty() ? AABB{} : nodes[0].bounds; }
+
+        static uint32_t refOf(const Primitive& prim) {
+            return prim.type == PrimitiveType::SPHERE ? uint32_t(prim.index) | CompactBVH::sphereFlag : uint32_t(prim.index);
+        }
+
+        // 栈式遍历, 按需构建时遍历 nodes 并在经过时划分未构建的节点, 否则遍历压缩后的树
+        // 对经过的叶子中的每个图元引用调用 leaf(ref); tMax 是调用方最近命中的距离, 由 leaf 在命中时缩小
+        template<typename Leaf>
+        void traverse(const Ray& ray, float tMin, const float& tMax, Leaf&& leaf) const {
+            if (lazy) {
+                traverseLazy(ray, tMin, tMax, leaf);
+                return;
+            }
+            if (!compact || compact->nodes.empty()) return;
+            auto& c = *compact;
+            struct Entry {
+                uint32_t node;
+                AABB box;
+            };
+            Entry stack[64];
+            int stackPtr = 0;
+            stack[stackPtr++] = {0, c.rootBounds};
+
+            while (stackPtr > 0) {
+                Entry e = stack[--stackPtr];
+                if (!e.box.hit(ray, tMin, tMax)) continue;
+
+                const CompactNode& node = c.nodes[e.node];
+                if (node.isLeaf()) {
+                    for (uint32_t i = 0; i < node.primCount(); i++) {
+                        leaf(c.primRefs[node.primStart() + i]);
+                    }
+                } else {
+                    stack[stackPtr++] = {node.right(), decodeChild(e.box, node, 1)};
+                    stack[stackPtr++] = {e.node + 1, decodeChild(e.box, node, 0)};
+                }
+            }
+        }
+
+        template<typename Leaf>
+        void traverseLazy(const Ray& ray, float tMin, const float& tMax, Leaf& leaf) const {
+            if (nodes.empty()) return;
+            int stack[64];
+            int stackPtr = 0;
+            stack[stackPtr++] = 0;
+
+            while (stackPtr > 0) {
+                int idx = stack[--stackPtr];
+                const BVHNode& node = nodes[idx];
+                if (!node.bounds.hit(ray, tMin, tMax)) continue;
+                if (nodeState[idx].load(memory_order_acquire) != BUILT) expand(idx);
+
+                if (node.isLeaf()) {
+                    for (int i = 0; i < node.primCount; i++) {
+                        leaf(refOf(primitives[node.primStart + i]));
+                    }
+                } else {
+                    stack[stackPtr++] = node.left;
+                    stack[stackPtr++] = node.right;
+                }
+            }
+        }
+        // 三角形图元的顶点, SBVH 按它裁剪跨越划分平面的引用; 返回 false 时只裁剪包围盒
+        virtual bool triangleOf(const Primitive& prim, Vec3 v[3]) const { return false; }
+
+    private:
+        // SBVH 构建时的引用计数与上限
+        size_t sbvhRefs = 0;
+        size_t sbvhRefLimit = 0;
+        float sbvhMinOverlap = 0;
+
+        int buildRecursive(int start, int end);
+        // 按 Morton 码排序图元, 编码保存在 mortonCodes 中
+        void sortByMorton();
+        // 沿编码的最高不同位自顶向下划分, 顶层以下的子树并行构建
+        void buildLBVH();
+        // 对每个内部节点尝试交换孩子与孙子, 使孩子的表面积最小; 完成后按先序重排节点
+        void restructure();
+        // 同时评估对象划分与空间划分的 SAH 构建, 跨越空间划分平面的图元被裁剪后复制到两侧
+        void buildSBVH();
+        // refs 的包围盒已裁剪到本节点范围; 叶子的引用追加到 primitives
+        int buildSBVHNode(vector<Primitive>& refs, int depth);
+        // 把引用沿 axis 轴上的 pos 平面切成两部分; 三角形按边与平面的交点裁剪, 其他图元只裁剪包围盒
+        void splitReference(const Primitive& ref, int axis, float pos, AABB& left, AABB& right) const;
+        void buildLazy();
+        int compressRecursive(int buildIdx, const AABB& box);
+        void initLazyNode(int idx, int start, int end);
+        // 划分未构建的节点; 只由赢得 UNBUILT -> BUILDING 的线程调用
+        void splitLazyNode(int idx);
+    };
+}
+
+#endif
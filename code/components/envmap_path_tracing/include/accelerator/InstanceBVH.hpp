@@ -0,0 +1,49 @@
+#pragma once
+#ifndef __ENVMAP_INSTANCE_BVH_HPP__
+#define __ENVMAP_INSTANCE_BVH_HPP__
+
+#include "MeshBVH.hpp"
+#include "intersections/HitRecord.hpp"
+
+namespace EnvMapPathTracer
+{
+    using namespace NRenderer;
+    using namespace std;
+
+    // 网格实例: 指向共享的底层 BVH, 并带有该实例的模型矩阵
+    struct Instance {
+        shared_ptr<const MeshBVH> blas;
+        const Mesh* mesh = nullptr;
+        Mat4x4 toWorld{1};
+        Mat4x4 toLocal{1};
+        Mat3x3 normalMatrix{1};
+        // 世界坐标下的包围盒
+        AABB bounds;
+    };
+
+    // 两层加速结构的顶层: 每次渲染只在实例包围盒上重建, 底层 BVH 跨渲染缓存
+    // 移动模型只影响顶层, 底层按网格数据复用
+    class InstanceBVH {
+    private:
+        vector<BVHNode> nodes;
+        vector<Instance> instances;
+        size_t uniqueMeshes = 0;
+        size_t blasBytes = 0;
+
+        int buildRecursive(int start, int end);
+
+    public:
+        // 场景中的网格仍在局部坐标下, 实例矩阵由 scene.models 得到
+        void build(const Scene& scene);
+        HitRecord intersect(const Ray& ray, float tMin, float tMax) const;
+
+        size_t instanceCount() const { return instances.size(); }
+        size_t uniqueMeshCount() const { return uniqueMeshes; }
+        // 本场景用到的底层 BVH 占用的字节数
+        size_t blasFootprint() const { return blasBytes; }
+        // 所有实例在世界坐标下的包围盒
+        AABB bounds() const { return nodes.empty() ? AABB{} : nodes[0].bounds; }
+    };
+}
+
+#endif
@@ -0,0 +1,44 @@
+#pragma once
+#ifndef __ENVMAP_MESH_BVH_HPP__
+#define __ENVMAP_MESH_BVH_HPP__
+
+#include "BVHTree.hpp"
+#include <cstdint>
+
+namespace EnvMapPathTracer
+{
+    using namespace NRenderer;
+    using namespace std;
+
+    // 底层 BVH: 单个网格在局部坐标下的三角形层次结构
+    // 同一份网格数据只构建一次, 由所有引用它的实例共享
+    // 图元为网格的面, 与场景 BVH 使用同样的构建方式与压缩节点, 叶子的图元引用即面的起始下标
+    // lazyBuild 时与场景 BVH 一样只建根节点, 其余节点在光线第一次经过时划分
+    class MeshBVH : public BVHTree {
+    public:
+        // 持有构建所用的数组, 缓存用它们的身份判断是否为同一份数据
+        CowVector<Vec3> positions;
+        CowVector<Index> indices;
+        // 网格内容的哈希, 身份不同但内容相同的网格 (如同一模型导入多次) 也能复用
+        uint64_t hash = 0;
+
+        // 登记网格数据与构建方式, 之后缓存就能按它们查找; 登记后再调用 build
+        void bind(const Mesh& mesh, uint64_t hash, const RenderOption& option);
+        void build();
+        // face 是面在 indices 中的起始下标, b1/b2 为 v2/v3 的重心坐标
+        bool intersect(const Ray& ray, float tMin, float tMax, float& t, unsigned int& face, float& b1, float& b2) const;
+        AABB bounds() const { return rootBounds(); }
+
+        static uint64_t hashMesh(const Mesh& mesh);
+        // 与 mesh 是同一份数据或内容相同
+        bool matches(const Mesh& mesh, uint64_t meshHash) const;
+        // 与 option 要求的构建方式相同, 缓存中构建方式不同的 BVH 不复用
+        bool builtWith(const RenderOption& option) const;
+
+    private:
+        // SBVH 按面的顶点裁剪跨越划分平面的引用
+        bool triangleOf(const Primitive& prim, Vec3 v[3]) const override;
+    };
+}
+
+#endif
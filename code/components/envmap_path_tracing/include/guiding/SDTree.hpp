@@ -0,0 +1,102 @@
+#pragma once
+#ifndef __ENVMAP_SD_TREE_HPP__
+#define __ENVMAP_SD_TREE_HPP__
+
+#include "geometry/vec.hpp"
+#include "accelerator/AABB.hpp"
+
+#include <vector>
+#include <atomic>
+
+namespace EnvMapPathTracer
+{
+    using namespace NRenderer;
+    using namespace std;
+
+    // 方向四叉树: 单位球按 (cosθ, φ) 等面积地展开到 [0, 1]^2 后逐层四分
+    // 每个节点记录四个象限收到的入射辐射度估计之和, 能量集中的象限划分得更细
+    class DTree
+    {
+    public:
+        static constexpr int maxDepth = 20;
+
+        DTree();
+        DTree(const DTree& t);
+        DTree& operator=(const DTree& t);
+
+        // 记录从方向 d 到达的辐射度估计, 可以多个线程同时调用
+        void record(const Vec3& d, float value);
+        // 记录到能量后才能用于采样
+        bool valid() const { return total() > 0; }
+        float total() const { return nodes[0].total(); }
+        // 立体角上的概率密度
+        float pdf(const Vec3& d) const;
+        // u 为 [0, 1)^2 上的随机数
+        Vec3 sample(Vec2 u) const;
+        // 按已有的统计重建结构: 能量占比超过 threshold 的象限继续四分, 其余合并, 统计清零
+        void refine(float threshold);
+        size_t nodeCount() const { return nodes.size(); }
+
+    private:
+        struct Node {
+            atomic<float> sum[4];
+            // 孩子在 nodes 中的下标, 0 表示该象限是叶子
+            int child[4] = {0, 0, 0, 0};
+            Node();
+            Node(const Node& n);
+            Node& operator=(const Node& n);
+            float total() const;
+        };
+        vector<Node> nodes;
+
+        static Vec2 toSquare(const Vec3& d);
+        static Vec3 toSphere(const Vec2& p);
+        // 旧的象限 oldNode 已经是叶子时传 -1, 此时认为能量在子象限中均匀分布
+        void refineNode(const vector<Node>& old, int oldNode, const float sums[4],
+            int node, int depth, float total, float threshold);
+    };
+
+    // 空间-方向树 (SD-tree), 用于路径引导:
+    //  - 空间上在场景包围盒内轮流沿 x/y/z 对半划分, 每个叶子带一对方向四叉树
+    //  - 渲染分若干轮, 每轮用上一轮学到的分布 (sampling) 采样, 同时记录到 building
+    //  - 一轮结束后记录数多的叶子继续划分, building 的统计成为下一轮的采样分布
+    class SDTree
+    {
+    public:
+        // 叶子的记录数超过 spatialThreshold * sqrt(2^iteration) 时划分
+        static constexpr float spatialThreshold = 4000.f;
+        // 方向四叉树中能量占比超过该值的象限继续四分
+        static constexpr float directionalThreshold = 0.01f;
+
+        // 重新开始学习; 包围盒外的点归到最近的叶子
+        void build(const AABB& box);
+        // 点 p 所在的空间叶子, 同一个着色点的采样与记录共用一次查找
+        int lookup(const Vec3& p) const;
+        // 本轮用于采样的方向分布
+        const DTree& samplingTree(int leaf) const { return leaves[leaf].sampling; }
+        void record(int leaf, const Vec3& d, float value);
+        // 每轮结束后调用, iteration 从 0 开始
+        void refine(int iteration);
+        size_t leafCount() const { return leaves.size(); }
+
+    private:
+        struct Leaf {
+            DTree sampling;
+            DTree building;
+            atomic<uint32_t> samples{0};
+            Leaf() = default;
+            Leaf(const Leaf& l);
+        };
+        struct Node {
+            int axis = 0;
+            // 两个孩子相邻存放, 0 表示叶子
+            int child = 0;
+            int leaf = 0;
+        };
+        vector<Node> nodes;
+        vector<Leaf> leaves;
+        AABB box;
+    };
+}
+
+#endif
@@ -14,6 +14,7 @@ namespace EnvMapPathTracer
     public:
         Conductor(Material& material, vector<Texture>& textures);
         Scattered shade(const Ray& ray, const Vec3& hitPoint, const Vec3& normal) const;
+        float pdf(const Vec3& normal, const Vec3& wi) const override;
     };
 }
 
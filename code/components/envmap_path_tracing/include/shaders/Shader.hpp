@@ -25,6 +25,9 @@ namespace EnvMapPathTracer
             , textureBuffer(textures)
         {}
         virtual Scattered shade(const Ray& ray, const Vec3& hitPoint, const Vec3& normal) const = 0;
+        // 按 shade 采样到方向 wi 的概率密度, 路径引导做 MIS 时使用
+        // delta 材质 (shade 返回的 pdf 为 1) 不会走到这里, 实现为 0 即可
+        virtual float pdf(const Vec3& normal, const Vec3& wi) const = 0;
     };
     SHARE(Shader);
 }
@@ -15,7 +15,7 @@ namespace EnvMapPathTracer
             EnvMapPathTracerRenderer renderer{spScene};
             auto renderResult = renderer.render();
             auto [pixels, width, height] = renderResult;
-            getServer().screen.set(pixels, width, height);
+            getServer().screen.setLinear(pixels, width, height);
             renderer.release(renderResult);
         }
     };
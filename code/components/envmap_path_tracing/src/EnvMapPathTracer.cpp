@@ -4,17 +4,15 @@
 #include "intersections/intersections.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
+#include <chrono>
+
 namespace EnvMapPathTracer
 {
-    RGB EnvMapPathTracerRenderer::gamma(const RGB& rgb) {
-        return glm::sqrt(rgb);
-    }
-
-    void EnvMapPathTracerRenderer::renderTask(RGBA* pixels, int width, int height, int off, int step) {
+    void EnvMapPathTracerRenderer::renderTask(RGB* accum, int width, int height, int off, int step, int passSamples) {
         for (int i = off; i < height; i += step) {
             for (int j = 0; j < width; j++) {
                 Vec3 color{0, 0, 0};
-                for (int k = 0; k < samples; k++) {
+                for (int k = 0; k < passSamples; k++) {
                     auto r = defaultSamplerInstance<UniformInSquare>().sample2d();
                     float rx = r.x;
                     float ry = r.y;
@@ -23,13 +21,41 @@ namespace EnvMapPathTracer
                     auto ray = camera.shoot(x, y);
                     color += trace(ray, 0);
                 }
-                color /= samples;
-                color = gamma(color);
-                pixels[(height - i - 1) * width + j] = {color, 1};
+                accum[i * width + j] += color;
             }
         }
     }
 
+    void EnvMapPathTracerRenderer::renderPass(RGB* accum, int passSamples) {
+        const auto taskNums = 8;
+        thread t[taskNums];
+        for (int i = 0; i < taskNums; i++) {
+            t[i] = thread(&EnvMapPathTracerRenderer::renderTask,
+                this, accum, width, height, i, taskNums, passSamples);
+        }
+        for (int i = 0; i < taskNums; i++) {
+            t[i].join();
+        }
+    }
+
+    AABB EnvMapPathTracerRenderer::sceneBounds() const {
+        AABB box = instances.bounds();
+        for (auto& t : scene.triangleBuffer) {
+            box.expand(t.v1);
+            box.expand(t.v2);
+            box.expand(t.v3);
+        }
+        for (auto& s : scene.sphereBuffer) {
+            box.expand(s.position - Vec3{s.radius});
+            box.expand(s.position + Vec3{s.radius});
+        }
+        for (auto& a : scene.areaLightBuffer) {
+            box.expand(a.position);
+            box.expand(a.position + a.u + a.v);
+        }
+        return box;
+    }
+
     auto EnvMapPathTracerRenderer::render() -> RenderResult {
         shaderPrograms.clear();
         ShaderCreator shaderCreator{};
@@ -42,17 +68,59 @@ namespace EnvMapPathTracer
         VertexTransformer vertexTransformer{};
         vertexTransformer.exec(spScene);
 
-        // 构建 BVH
+        // 构建 BVH, 图元数量不变时只做 refit
+        auto buildStart = chrono::steady_clock::now();
         bvh.build(scene);
+        float buildMs = chrono::duration<float, milli>(chrono::steady_clock::now() - buildStart).count();
+        if (bvh.isLazy()) {
+            getServer().logger.log("BVH lazy build: " + to_string(buildMs) + " ms");
+        }
+        else {
+            getServer().logger.log(string(bvh.wasRefitted() ? "BVH refit" : "BVH build") + ": "
+                + to_string(buildMs) + " ms, SAH cost " + to_string(bvh.sahCost())
+                + ", " + to_string(bvh.builtNodes()) + " nodes"
+                + (bvh.wasRefitted() ? " (" + to_string(bvh.refittedNodes()) + " updated)" : string())
+                + ", " + to_string(bvh.footprint() / 1024) + " KB");
+        }
+        instances.build(scene);
+        getServer().logger.log("Mesh instances: " + to_string(instances.instanceCount())
+            + ", unique BLAS: " + to_string(instances.uniqueMeshCount())
+            + ", " + to_string(instances.blasFootprint() / 1024) + " KB");
 
-        const auto taskNums = 8;
-        thread t[taskNums];
-        for (int i = 0; i < taskNums; i++) {
-            t[i] = thread(&EnvMapPathTracerRenderer::renderTask,
-                this, pixels, width, height, i, taskNums);
+        vector<RGB> accum(width * height, RGB{0});
+        if (guiding) {
+            // 每轮样本数翻倍, 剩余样本不够再翻倍一轮时全部放进最后一轮
+            // 各轮都是无偏估计, 按样本数合并
+            guide.build(sceneBounds());
+            int done = 0;
+            int iteration = 0;
+            int passSamples = 1;
+            while (done < int(samples)) {
+                int remaining = int(samples) - done;
+                bool last = remaining < passSamples * 3;
+                if (last) passSamples = remaining;
+                training = !last;
+                renderPass(accum.data(), passSamples);
+                done += passSamples;
+                if (!last) {
+                    guide.refine(iteration++);
+                    passSamples *= 2;
+                }
+            }
+            getServer().logger.log("Path guiding: " + to_string(iteration + 1) + " passes, "
+                + to_string(guide.leafCount()) + " spatial leaves");
         }
-        for (int i = 0; i < taskNums; i++) {
-            t[i].join();
+        else {
+            renderPass(accum.data(), samples);
+        }
+        for (unsigned int i = 0; i < height; i++) {
+            for (unsigned int j = 0; j < width; j++) {
+                Vec3 color = accum[i * width + j] / float(samples);
+                pixels[(height - i - 1) * width + j] = {color, 1};
+            }
+        }
+        if (bvh.isLazy()) {
+            getServer().logger.log("BVH nodes built on demand: " + to_string(bvh.builtNodes()));
         }
         getServer().logger.log("Done...");
         return {pixels, width, height};
@@ -68,6 +136,12 @@ namespace EnvMapPathTracer
         HitRecord closestHit = bvh.intersect(r, 0.000001f, FLOAT_INF);
         float closest = closestHit ? closestHit->t : FLOAT_INF;
 
+        auto meshHit = instances.intersect(r, 0.000001f, closest);
+        if (meshHit) {
+            closest = meshHit->t;
+            closestHit = meshHit;
+        }
+
         // Plane 不在 BVH 中，单独处理
         for (auto& p : scene.planeBuffer) {
             auto hitRecord = Intersection::xPlane(r, p, 0.000001, closest);
@@ -101,17 +175,40 @@ namespace EnvMapPathTracer
         // 击中物体
         if (hitObject && hitObject->t < t) {
             auto mtlHandle = hitObject->material;
-            auto scattered = shaderPrograms[mtlHandle.index()]->shade(r, hitObject->hitPoint, hitObject->normal);
+            auto& shader = shaderPrograms[mtlHandle.index()];
+            auto scattered = shader->shade(r, hitObject->hitPoint, hitObject->normal);
             auto scatteredRay = scattered.ray;
             auto attenuation = scattered.attenuation;
             auto emittedLight = scattered.emitted;
-            auto next = trace(scatteredRay, currDepth + 1);
             float pdf = scattered.pdf;
 
             // delta分布材质(镜面/玻璃)直接返回 attenuation * next
             if (pdf >= 1.0f) {
+                auto next = trace(scatteredRay, currDepth + 1);
                 return emittedLight + attenuation * next;
             }
+
+            // 路径引导: 单样本 MIS, 以 bsdfSamplingFraction 的概率保留 BSDF 采样的方向, 否则从 SD-tree 采样
+            // pdf 取两种策略的混合; SD-tree 还没有数据时只用 BSDF 采样
+            int leaf = guiding ? guide.lookup(hitObject->hitPoint) : 0;
+            if (guiding) {
+                auto& dtree = guide.samplingTree(leaf);
+                if (dtree.valid()) {
+                    auto& u = defaultSamplerInstance<UniformSampler>();
+                    if (u.sample1d() >= bsdfSamplingFraction) {
+                        scatteredRay.direction = dtree.sample({u.sample1d(), u.sample1d()});
+                    }
+                    float bsdfPdf = shader->pdf(hitObject->normal, scatteredRay.direction);
+                    if (bsdfPdf <= 0) return emittedLight;
+                    pdf = bsdfSamplingFraction * bsdfPdf
+                        + (1 - bsdfSamplingFraction) * dtree.pdf(scatteredRay.direction);
+                }
+            }
+
+            auto next = trace(scatteredRay, currDepth + 1);
+            if (training) {
+                guide.record(leaf, scatteredRay.direction, (next.x + next.y + next.z) / 3.f / pdf);
+            }
             // 漫反射材质需要乘以 cos(theta) / pdf
             float n_dot_in = glm::abs(glm::dot(hitObject->normal, scatteredRay.direction));
             return emittedLight + attenuation * next * n_dot_in / pdf;
@@ -1,34 +1,11 @@
 #include "VertexTransformer.hpp"
-#include "glm/gtc/matrix_transform.hpp"
+#include "scene/WorldTransform.hpp"
 
 namespace EnvMapPathTracer
 {
+    // 变换与缓存由 NRenderer::WorldTransform 统一完成, 不修改 Asset 中的几何
+    // 网格保持模型坐标, 由 InstanceBVH 按实例矩阵求交
     void VertexTransformer::exec(SharedScene spScene) {
-        auto& scene = *spScene;
-        for (auto& node : scene.nodes) {
-            Mat4x4 t{1};
-            auto& model = spScene->models[node.model];
-            t = glm::translate(t, model.translation);
-            if (node.type == Node::Type::TRIANGLE) {
-                for (int i = 0; i < 3; i++) {
-                    auto& v = scene.triangleBuffer[node.entity].v[i];
-                    v = t * Vec4{v, 1};
-                }
-            }
-            else if (node.type == Node::Type::SPHERE) {
-                auto& v = scene.sphereBuffer[node.entity].position;
-                v = t * Vec4{v, 1};
-            }
-            else if (node.type == Node::Type::PLANE) {
-                auto& v = scene.planeBuffer[node.entity].position;
-                v = t * Vec4{v, 1};
-            }
-            else if (node.type == Node::Type::MESH) {
-                auto& m = scene.meshBuffer[node.entity];
-                for (auto& pos : m.positions) {
-                    pos = t * Vec4{pos, 1};
-                }
-            }
-        }
+        WorldTransform::exec(*spScene, false);
     }
 }
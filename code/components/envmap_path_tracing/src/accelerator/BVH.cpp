@@ -1,9 +1,32 @@
 #include "accelerator/BVH.hpp"
 #include "intersections/intersections.hpp"
 #include <algorithm>
+#include <mutex>
+#include <queue>
+#include <functional>
 
 namespace EnvMapPathTracer
 {
+    namespace
+    {
+        // 上一次渲染的树; builtCost 是最近一次完整构建时的 SAH 代价, refit 不更新它
+        struct BVHCache
+        {
+            mutex mtx;
+            RenderOption::BVHBuilder builder = RenderOption::BVHBuilder::MEDIAN;
+            size_t triangles = 0;
+            size_t spheres = 0;
+            float builtCost = 0;
+            shared_ptr<CompactBVH> data;
+            RefitState state;
+        };
+
+        BVHCache& bvhCache() {
+            static BVHCache c;
+            return c;
+        }
+    }
+
     AABB BVH::computeBounds(const Triangle& t) const {
         AABB box;
         box.expand(t.v1);
@@ -17,12 +40,18 @@ namespace EnvMapPathTracer
         return AABB(s.position - r, s.position + r);
     }
 
-    void BVH::build(const Scene& scn) {
-        scene = &scn;
-        primitives.clear();
-        nodes.clear();
+    bool BVH::triangleOf(const Primitive& prim, Vec3 v[3]) const {
+        if (prim.type != PrimitiveType::TRIANGLE) return false;
+        auto& t = scene->triangleBuffer[prim.index];
+        v[0] = t.v1;
+        v[1] = t.v2;
+        v[2] = t.v3;
+        return true;
+    }
 
-        // 收集所有图元
+    void BVH::collectPrimitives(const Scene& scn) {
+        primitives.clear();
+        primitives.reserve(scn.triangleBuffer.size() + scn.sphereBuffer.size());
         for (size_t i = 0; i < scn.triangleBuffer.size(); i++) {
             Primitive p;
             p.type = PrimitiveType::TRIANGLE;
@@ -37,86 +66,206 @@ namespace EnvMapPathTracer
             p.bounds = computeBounds(scn.sphereBuffer[i]);
             primitives.push_back(p);
         }
-
-        if (primitives.empty()) return;
-
-        nodes.reserve(primitives.size() * 2);
-        buildRecursive(0, primitives.size());
     }
 
-    int BVH::buildRecursive(int start, int end) {
-        int nodeIdx = nodes.size();
-        nodes.push_back(BVHNode{});
-        BVHNode& node = nodes[nodeIdx];
+    void BVH::build(const Scene& scn) {
+        scene = &scn;
+        refitted = false;
+        cost = 0;
+        builder = scn.renderOption.bvhBuilder;
+        lazy = scn.renderOption.lazyBuild;
+        compact.reset();
 
-        // 计算边界
-        for (int i = start; i < end; i++) {
-            node.bounds.expand(primitives[i].bounds);
-        }
+        auto& cache = bvhCache();
+        lock_guard<mutex> lk(cache.mtx);
 
-        int count = end - start;
-        if (count <= 4) {
-            // 叶子节点
-            node.primStart = start;
-            node.primCount = count;
-            return nodeIdx;
+        if (lazy) {
+            // 不完整的树不能用于 refit, 下一次完整构建前缓存作废
+            cache.data.reset();
+            collectPrimitives(scn);
+            buildNodes();
+            return;
+        }
+        // 图元数量与构建方式都与上次相同时先尝试 refit
+        if (cache.data && cache.builder == builder
+            && cache.triangles == scn.triangleBuffer.size()
+            && cache.spheres == scn.sphereBuffer.size()) {
+            // 没有其他渲染持有时原地更新, 否则先复制一份
+            if (cache.data.use_count() > 1) cache.data = make_shared<CompactBVH>(*cache.data);
+            if (refit(scn, *cache.data, cache.state, cache.builtCost)) {
+                refitted = true;
+                compact = cache.data;
+                return;
+            }
         }
 
-        // 选择最长轴分割
-        int axis = node.bounds.longestAxis();
-        int mid = (start + end) / 2;
+        // 收集所有图元
+        collectPrimitives(scn);
+        buildNodes();
+        cost = nodeCost();
+        compress();
 
-        // 按质心排序
-        std::nth_element(primitives.begin() + start, primitives.begin() + mid,
-            primitives.begin() + end,
-            [axis](const Primitive& a, const Primitive& b) {
-                return a.bounds.centroid()[axis] < b.bounds.centroid()[axis];
-            });
+        cache.builder = builder;
+        cache.triangles = scn.triangleBuffer.size();
+        cache.spheres = scn.sphereBuffer.size();
+        cache.builtCost = cost;
+        cache.data = compact;
+        initRefitState(scn, *compact, cache.state);
+    }
 
-        node.left = buildRecursive(start, mid);
-        node.right = buildRecursive(mid, end);
-        return nodeIdx;
+    AABB BVH::primitiveBounds(const Scene& scn, size_t key) const {
+        size_t triangles = scn.triangleBuffer.size();
+        return key < triangles ? computeBounds(scn.triangleBuffer[key]) : computeBounds(scn.sphereBuffer[key - triangles]);
     }
 
-    HitRecord BVH::intersectPrimitive(const Primitive& prim, const Ray& ray, float tMin, float tMax) const {
-        if (prim.type == PrimitiveType::TRIANGLE) {
-            return Intersection::xTriangle(ray, scene->triangleBuffer[prim.index], tMin, tMax);
-        } else {
-            return Intersection::xSphere(ray, scene->sphereBuffer[prim.index], tMin, tMax);
+    void BVH::initRefitState(const Scene& scn, const CompactBVH& c, RefitState& state) const {
+        const size_t triangles = scn.triangleBuffer.size();
+        const size_t n = c.nodes.size();
+        state.primBounds.resize(triangles + scn.sphereBuffer.size());
+        for (size_t i = 0; i < state.primBounds.size(); i++) state.primBounds[i] = primitiveBounds(scn, i);
+        state.exact.assign(n, AABB{});
+        state.decoded.assign(n, AABB{});
+        state.parent.assign(n, 0);
+        state.refLeaf.assign(c.primRefs.size(), 0);
+        state.queued.assign(n, 0);
+        state.weightedArea = 0;
+        if (n == 0) return;
+
+        // 节点按深度优先存储, 子节点下标总大于父节点, 逆序遍历即为自底向上
+        for (int i = int(n) - 1; i >= 0; i--) {
+            auto& node = c.nodes[i];
+            if (node.isLeaf()) {
+                for (uint32_t k = 0; k < node.primCount(); k++) {
+                    uint32_t r = node.primStart() + k;
+                    uint32_t ref = c.primRefs[r];
+                    size_t key = ref & CompactBVH::sphereFlag ? triangles + (ref & ~CompactBVH::sphereFlag) : ref;
+                    state.exact[i].expand(state.primBounds[key]);
+                    state.refLeaf[r] = uint32_t(i);
+                }
+            }
+            else {
+                state.exact[i] = state.exact[i + 1];
+                state.exact[i].expand(state.exact[node.right()]);
+                state.parent[i + 1] = state.parent[node.right()] = uint32_t(i);
+            }
+            state.weightedArea += double(state.exact[i].surfaceArea()) * (node.isLeaf() ? node.primCount() : 1);
+        }
+
+        state.decoded[0] = c.rootBounds;
+        for (size_t i = 0; i < n; i++) {
+            auto& node = c.nodes[i];
+            if (node.isLeaf()) continue;
+            state.decoded[i + 1] = decodeChild(state.decoded[i], node, 0);
+            state.decoded[node.right()] = decodeChild(state.decoded[i], node, 1);
         }
     }
 
-    HitRecord BVH::intersect(const Ray& ray, float tMin, float tMax) const {
-        if (nodes.empty()) return nullopt;
-
-        HitRecord closest = nullopt;
-        float closestT = tMax;
+    bool BVH::refit(const Scene& scn, CompactBVH& c, RefitState& state, float builtCost) {
+        updated = 0;
+        if (c.nodes.empty()) return true;
+        const size_t triangles = scn.triangleBuffer.size();
 
-        // 栈式遍历
-        int stack[64];
-        int stackPtr = 0;
-        stack[stackPtr++] = 0;
+        // 找出包围盒变化的图元; 都没有变化时树不需要任何改动
+        vector<uint8_t> moved(state.primBounds.size(), 0);
+        bool anyMoved = false;
+        for (size_t i = 0; i < state.primBounds.size(); i++) {
+            AABB box = primitiveBounds(scn, i);
+            if (box == state.primBounds[i]) continue;
+            state.primBounds[i] = box;
+            moved[i] = 1;
+            anyMoved = true;
+        }
 
-        while (stackPtr > 0) {
-            int idx = stack[--stackPtr];
-            const BVHNode& node = nodes[idx];
+        if (anyMoved) {
+            // 自底向上: 子节点下标总大于父节点, 按下标从大到小出队, 每个节点只在它的孩子都处理完后处理一次
+            // 包围盒没有变化的节点不再向上传播
+            priority_queue<uint32_t> up;
+            // 孩子的包围盒或自身解码后的包围盒变化了, 需要重新量化的内部节点, 按下标从小到大即自顶向下处理
+            priority_queue<uint32_t, vector<uint32_t>, greater<uint32_t>> down;
+            enum : uint8_t { IN_UP = 1, IN_DOWN = 2 };
+            auto push = [&](auto& q, uint32_t i, uint8_t flag) {
+                if (state.queued[i] & flag) return;
+                state.queued[i] |= flag;
+                q.push(i);
+            };
 
-            if (!node.bounds.hit(ray, tMin, closestT)) continue;
+            for (size_t r = 0; r < c.primRefs.size(); r++) {
+                uint32_t ref = c.primRefs[r];
+                size_t key = ref & CompactBVH::sphereFlag ? triangles + (ref & ~CompactBVH::sphereFlag) : ref;
+                if (moved[key]) push(up, state.refLeaf[r], IN_UP);
+            }
 
-            if (node.isLeaf()) {
-                for (int i = 0; i < node.primCount; i++) {
-                    auto hit = intersectPrimitive(primitives[node.primStart + i], ray, tMin, closestT);
-                    if (hit && hit->t < closestT) {
-                        closestT = hit->t;
-                        closest = hit;
+            while (!up.empty()) {
+                uint32_t i = up.top();
+                up.pop();
+                state.queued[i] &= ~IN_UP;
+                auto& node = c.nodes[i];
+                AABB box;
+                if (node.isLeaf()) {
+                    for (uint32_t k = 0; k < node.primCount(); k++) {
+                        uint32_t ref = c.primRefs[node.primStart() + k];
+                        box.expand(state.primBounds[ref & CompactBVH::sphereFlag ? triangles + (ref & ~CompactBVH::sphereFlag) : ref]);
                     }
                 }
-            } else {
-                stack[stackPtr++] = node.left;
-                stack[stackPtr++] = node.right;
+                else {
+                    box = state.exact[i + 1];
+                    box.expand(state.exact[node.right()]);
+                }
+                if (box == state.exact[i]) continue;
+                state.weightedArea += (double(box.surfaceArea()) - state.exact[i].surfaceArea()) * (node.isLeaf() ? node.primCount() : 1);
+                state.exact[i] = box;
+                updated++;
+                if (i == 0) {
+                    // 根节点的参照盒就是它的真实包围盒
+                    c.rootBounds = state.decoded[0] = box;
+                    if (!node.isLeaf()) push(down, 0, IN_DOWN);
+                }
+                else {
+                    push(up, state.parent[i], IN_UP);
+                    push(down, state.parent[i], IN_DOWN);
+                }
             }
+
+            // 自顶向下重新量化; 出队时本节点解码后的包围盒已经是最终结果
+            while (!down.empty()) {
+                uint32_t i = down.top();
+                down.pop();
+                state.queued[i] &= ~IN_DOWN;
+                auto& node = c.nodes[i];
+                uint32_t children[2] = {i + 1, node.right()};
+                for (int k = 0; k < 2; k++) {
+                    uint32_t child = children[k];
+                    encodeChild(state.decoded[i], state.exact[child], node, k);
+                    AABB box = decodeChild(state.decoded[i], node, k);
+                    if (box == state.decoded[child]) continue;
+                    state.decoded[child] = box;
+                    if (!c.nodes[child].isLeaf()) push(down, child, IN_DOWN);
+                }
+            }
+        }
+
+        float rootArea = state.exact[0].surfaceArea();
+        cost = rootArea > 0 ? float(state.weightedArea / rootArea) : 0;
+        return cost <= builtCost * refitThreshold;
+    }
+
+    HitRecord BVH::intersectRef(uint32_t ref, const Ray& ray, float tMin, float tMax) const {
+        if (ref & CompactBVH::sphereFlag) {
+            return Intersection::xSphere(ray, scene->sphereBuffer[ref & ~CompactBVH::sphereFlag], tMin, tMax);
         }
+        return Intersection::xTriangle(ray, scene->triangleBuffer[ref], tMin, tMax);
+    }
 
+    HitRecord BVH::intersect(const Ray& ray, float tMin, float tMax) const {
+        HitRecord closest = nullopt;
+        float closestT = tMax;
+        traverse(ray, tMin, closestT, [&](uint32_t ref) {
+            auto hit = intersectRef(ref, ray, tMin, closestT);
+            if (hit && hit->t < closestT) {
+                closestT = hit->t;
+                closest = hit;
+            }
+        });
         return closest;
     }
 }
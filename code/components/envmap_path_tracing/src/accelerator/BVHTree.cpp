@@ -0,0 +1,728 @@
+#include "accelerator/BVHTree.hpp"
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <thread>
+
+namespace EnvMapPathTracer
+{
+    namespace
+    {
+        // 网格的底层 BVH 大多很小, 又是多个网格并行构建, 图元数不到该值时排序不再分线程
+        constexpr size_t parallelThreshold = 1 << 16;
+
+        template<typename Task>
+        void parallelFor(size_t taskNums, Task task) {
+            if (taskNums == 1) {
+                task(0);
+                return;
+            }
+            vector<thread> t;
+            for (size_t i = 0; i < taskNums; i++) t.emplace_back(task, i);
+            for (auto& th : t) th.join();
+        }
+
+        // 在 10 位整数的相邻两位之间插入两个 0
+        uint32_t expandBits(uint32_t v) {
+            v = (v * 0x00010001u) & 0xFF0000FFu;
+            v = (v * 0x00000101u) & 0x0F00F00Fu;
+            v = (v * 0x00000011u) & 0xC30C30C3u;
+            v = (v * 0x00000005u) & 0x49249249u;
+            return v;
+        }
+
+        // p 为归一化到 [0, 1] 的坐标, 每轴 10 位, 共 30 位
+        uint32_t morton3D(const Vec3& p) {
+            auto q = [](float f) { return uint32_t(std::min(std::max(f * 1024.f, 0.f), 1023.f)); };
+            return (expandBits(q(p.x)) << 2) | (expandBits(q(p.y)) << 1) | expandBits(q(p.z));
+        }
+
+        // 并行 LSD 基数排序, 每轮 8 位
+        // 各线程先统计自己分段的直方图, 按 (位值, 线程) 求前缀和后各自顺序散射, 结果是稳定的
+        void radixSort(vector<uint32_t>& keys, vector<uint32_t>& values) {
+            const size_t n = keys.size();
+            const size_t taskNums = n < parallelThreshold ? 1 : 8;
+            const size_t chunk = (n + taskNums - 1) / taskNums;
+            vector<uint32_t> tmpKeys(n), tmpValues(n);
+            vector<array<size_t, 256>> offset(taskNums);
+            for (int shift = 0; shift < 32; shift += 8) {
+                parallelFor(taskNums, [&](size_t t) {
+                    auto& h = offset[t];
+                    h.fill(0);
+                    for (size_t i = t*chunk; i < std::min(n, (t + 1)*chunk); i++) {
+                        h[(keys[i] >> shift) & 0xFF]++;
+                    }
+                });
+                size_t sum = 0;
+                for (int d = 0; d < 256; d++) {
+                    for (size_t t = 0; t < taskNums; t++) {
+                        size_t c = offset[t][d];
+                        offset[t][d] = sum;
+                        sum += c;
+                    }
+                }
+                parallelFor(taskNums, [&](size_t t) {
+                    auto& o = offset[t];
+                    for (size_t i = t*chunk; i < std::min(n, (t + 1)*chunk); i++) {
+                        size_t dst = o[(keys[i] >> shift) & 0xFF]++;
+                        tmpKeys[dst] = keys[i];
+                        tmpValues[dst] = values[i];
+                    }
+                });
+                keys.swap(tmpKeys);
+                values.swap(tmpValues);
+            }
+        }
+
+        // 已排序的编码在 [first, last] 中最高不同位发生变化的位置 (Karras 2012), 返回左半部分的最后一个下标
+        int findSplit(const vector<uint32_t>& codes, int first, int last) {
+            uint32_t a = codes[first], b = codes[last];
+            // 编码相同时从中间划分
+            if (a == b) return (first + last) / 2;
+            int prefix = std::countl_zero(a ^ b);
+            int split = first;
+            int step = last - first;
+            do {
+                step = (step + 1) >> 1;
+                int next = split + step;
+                if (next < last && std::countl_zero(a ^ codes[next]) > prefix) split = next;
+            } while (step > 1);
+            return split;
+        }
+
+        // 在排好序的 Morton 码上自顶向下生成层次结构
+        struct LBVHEmitter
+        {
+            const vector<uint32_t>& codes;
+            const vector<Primitive>& primitives;
+            vector<BVHNode>& nodes;
+            // 区间不超过该大小时只生成占位节点, 由调用方并行构建
+            int taskSize;
+            vector<pair<int, int>>* tasks;
+
+            int emit(int first, int last) {
+                int nodeIdx = nodes.size();
+                nodes.push_back(BVHNode{});
+                int count = last - first + 1;
+                if (count <= 4) {
+                    for (int i = first; i <= last; i++) {
+                        nodes[nodeIdx].bounds.expand(primitives[i].bounds);
+                    }
+                    nodes[nodeIdx].primStart = first;
+                    nodes[nodeIdx].primCount = count;
+                    return nodeIdx;
+                }
+                if (tasks && count <= taskSize) {
+                    // 占位, 保存区间; 并行构建完成后替换
+                    nodes[nodeIdx].primStart = first;
+                    nodes[nodeIdx].primCount = count;
+                    tasks->push_back({nodeIdx, last});
+                    return nodeIdx;
+                }
+                int split = findSplit(codes, first, last);
+                int left = emit(first, split);
+                int right = emit(split + 1, last);
+                auto& node = nodes[nodeIdx];
+                node.left = left;
+                node.right = right;
+                node.bounds = nodes[left].bounds;
+                node.bounds.expand(nodes[right].bounds);
+                return nodeIdx;
+            }
+        };
+
+        // SBVH 每个节点在每个轴上使用的分箱数
+        constexpr int sbvhBins = 32;
+        // 不超过该数量的引用在 SAH 代价不高于继续划分时成为叶子
+        constexpr int sbvhMaxLeaf = 4;
+        // 超过该深度后按中位数划分, 保证遍历栈 (64) 不会溢出
+        constexpr int sbvhMaxDepth = 32;
+
+        AABB intersectBox(const AABB& a, const AABB& b) {
+            return AABB(glm::max(a.min, b.min), glm::min(a.max, b.max));
+        }
+
+        float unionArea(const AABB& a, const AABB& b) {
+            AABB box = a;
+            box.expand(b);
+            return box.surfaceArea();
+        }
+    }
+
+    void BVHTree::buildNodes() {
+        nodes.clear();
+        if (primitives.empty()) return;
+        if (lazy) {
+            buildLazy();
+        }
+        else if (builder == RenderOption::BVHBuilder::LBVH) {
+            buildLBVH();
+        }
+        else if (builder == RenderOption::BVHBuilder::SBVH) {
+            buildSBVH();
+        }
+        else {
+            // 中位数划分的叶子至少有 2 个图元, 节点数不超过图元数
+            nodes.reserve(primitives.size());
+            buildRecursive(0, primitives.size());
+        }
+    }
+
+    float BVHTree::nodeCost() const {
+        if (nodes.empty()) return 0;
+        float rootArea = nodes[0].bounds.surfaceArea();
+        if (rootArea <= 0) return 0;
+        // 遍历一个内部节点与求交一个图元的代价都取 1
+        float total = 0;
+        for (auto& node : nodes) {
+            float area = node.bounds.surfaceArea() / rootArea;
+            total += node.isLeaf() ? area * node.primCount : area;
+        }
+        return total;
+    }
+
+    void BVHTree::compress() {
+        compact = make_shared<CompactBVH>();
+        if (!nodes.empty()) {
+            compact->rootBounds = nodes[0].bounds;
+            compact->nodes.reserve(nodes.size());
+            compact->primRefs.reserve(primitives.size());
+            compressRecursive(0, nodes[0].bounds);
+        }
+        vector<BVHNode>().swap(nodes);
+        vector<Primitive>().swap(primitives);
+    }
+
+    int BVHTree::compressRecursive(int buildIdx, const AABB& box) {
+        auto& c = *compact;
+        int idx = c.nodes.size();
+        c.nodes.push_back(CompactNode{});
+        const auto& node = nodes[buildIdx];
+        if (node.isLeaf()) {
+            c.nodes[idx].data = CompactNode::leafFlag | (uint32_t(node.primCount) << 28) | uint32_t(c.primRefs.size());
+            for (int k = 0; k < node.primCount; k++) {
+                c.primRefs.push_back(refOf(primitives[node.primStart + k]));
+            }
+            return idx;
+        }
+        encodeChild(box, nodes[node.left].bounds, c.nodes[idx], 0);
+        encodeChild(box, nodes[node.right].bounds, c.nodes[idx], 1);
+        AABB leftBox = decodeChild(box, c.nodes[idx], 0);
+        AABB rightBox = decodeChild(box, c.nodes[idx], 1);
+        compressRecursive(node.left, leftBox);
+        int right = compressRecursive(node.right, rightBox);
+        c.nodes[idx].data = uint32_t(right);
+        return idx;
+    }
+
+    size_t BVHTree::builtNodes() const {
+        if (lazy) return size_t(nodeCount.load());
+        return compact ? compact->nodes.size() : 0;
+    }
+
+    size_t BVHTree::footprint() const {
+        if (lazy) return nodes.size()*sizeof(BVHNode) + primitives.size()*sizeof(Primitive);
+        if (!compact) return 0;
+        return compact->nodes.size()*sizeof(CompactNode) + compact->primRefs.size()*sizeof(uint32_t);
+    }
+
+    int BVHTree::buildRecursive(int start, int end) {
+        int nodeIdx = nodes.size();
+        nodes.push_back(BVHNode{});
+
+        // 计算边界
+        AABB bounds;
+        for (int i = start; i < end; i++) {
+            bounds.expand(primitives[i].bounds);
+        }
+        nodes[nodeIdx].bounds = bounds;
+
+        int count = end - start;
+        if (count <= 4) {
+            // 叶子节点
+            nodes[nodeIdx].primStart = start;
+            nodes[nodeIdx].primCount = count;
+            return nodeIdx;
+        }
+
+        // 选择最长轴分割
+        int axis = bounds.longestAxis();
+        int mid = (start + end) / 2;
+
+        // 按质心排序
+        std::nth_element(primitives.begin() + start, primitives.begin() + mid,
+            primitives.begin() + end,
+            [axis](const Primitive& a, const Primitive& b) {
+                return a.bounds.centroid()[axis] < b.bounds.centroid()[axis];
+            });
+
+        int left = buildRecursive(start, mid);
+        int right = buildRecursive(mid, end);
+        nodes[nodeIdx].left = left;
+        nodes[nodeIdx].right = right;
+        return nodeIdx;
+    }
+
+    void BVHTree::sortByMorton() {
+        const size_t n = primitives.size();
+        AABB centroidBounds;
+        for (auto& p : primitives) centroidBounds.expand(p.bounds.centroid());
+        Vec3 extent = centroidBounds.max - centroidBounds.min;
+        Vec3 scale{
+            extent.x > 0 ? 1.f / extent.x : 0.f,
+            extent.y > 0 ? 1.f / extent.y : 0.f,
+            extent.z > 0 ? 1.f / extent.z : 0.f
+        };
+
+        auto& codes = mortonCodes;
+        codes.resize(n);
+        vector<uint32_t> order(n);
+        const size_t taskNums = n < parallelThreshold ? 1 : 8;
+        const size_t chunk = (n + taskNums - 1) / taskNums;
+        parallelFor(taskNums, [&](size_t t) {
+            for (size_t i = t*chunk; i < std::min(n, (t + 1)*chunk); i++) {
+                codes[i] = morton3D((primitives[i].bounds.centroid() - centroidBounds.min) * scale);
+                order[i] = uint32_t(i);
+            }
+        });
+        radixSort(codes, order);
+        vector<Primitive> sorted(n);
+        for (size_t i = 0; i < n; i++) sorted[i] = primitives[order[i]];
+        primitives.swap(sorted);
+    }
+
+    void BVHTree::buildLBVH() {
+        sortByMorton();
+        const size_t n = primitives.size();
+        const size_t taskNums = 8;
+        auto& codes = mortonCodes;
+
+        // 顶层串行划分, 区间足够小后交给各线程独立生成子树
+        vector<pair<int, int>> tasks;
+        int taskSize = std::max<int>(int(n / (taskNums * 4)), 4096);
+        nodes.clear();
+        nodes.reserve(n / 2);
+        LBVHEmitter top{codes, primitives, nodes, taskSize, &tasks};
+        top.emit(0, int(n) - 1);
+        const int topCount = nodes.size();
+
+        vector<vector<BVHNode>> subtrees(tasks.size());
+        atomic<size_t> next{0};
+        parallelFor(std::min(taskNums, tasks.size()), [&](size_t) {
+            for (size_t i = next++; i < tasks.size(); i = next++) {
+                auto& local = subtrees[i];
+                local.reserve((tasks[i].second - nodes[tasks[i].first].primStart + 1) / 2);
+                LBVHEmitter e{codes, primitives, local, 0, nullptr};
+                e.emit(nodes[tasks[i].first].primStart, tasks[i].second);
+            }
+        });
+
+        // 拼接: 子树的根覆盖占位节点, 其余节点追加到末尾, 子节点下标始终大于父节点
+        for (size_t i = 0; i < tasks.size(); i++) {
+            auto& local = subtrees[i];
+            int offset = int(nodes.size()) - 1;
+            auto remap = [offset](BVHNode node) {
+                if (!node.isLeaf()) {
+                    node.left += offset;
+                    node.right += offset;
+                }
+                return node;
+            };
+            nodes[tasks[i].first] = remap(local[0]);
+            for (size_t k = 1; k < local.size(); k++) nodes.push_back(remap(local[k]));
+        }
+        for (int i = topCount - 1; i >= 0; i--) {
+            auto& node = nodes[i];
+            if (node.isLeaf()) continue;
+            node.bounds = nodes[node.left].bounds;
+            node.bounds.expand(nodes[node.right].bounds);
+        }
+
+        for (int pass = 0; pass < lbvhRestructurePasses; pass++) restructure();
+        vector<uint32_t>().swap(mortonCodes);
+    }
+
+    void BVHTree::buildLazy() {
+        // 按需构建的节点数组是预先分配的, 不能复制引用; SBVH 在这种模式下退化为中位数划分
+        if (builder == RenderOption::BVHBuilder::LBVH) sortByMorton();
+        // 叶子不超过 4 个图元, 二叉树的节点数小于图元数的两倍
+        const size_t capacity = primitives.size() * 2;
+        nodes.assign(capacity, BVHNode{});
+        nodeState.reset(new atomic<int>[capacity]);
+        initLazyNode(0, 0, int(primitives.size()));
+        nodeCount.store(1);
+    }
+
+    void BVHTree::initLazyNode(int idx, int start, int end) {
+        auto& node = nodes[idx];
+        node.bounds = AABB{};
+        for (int i = start; i < end; i++) {
+            node.bounds.expand(primitives[i].bounds);
+        }
+        node.left = node.right = -1;
+        node.primStart = start;
+        node.primCount = end - start;
+        nodeState[idx].store(node.primCount <= 4 ? BUILT : UNBUILT, memory_order_relaxed);
+    }
+
+    void BVHTree::splitLazyNode(int idx) {
+        auto& node = nodes[idx];
+        int start = node.primStart;
+        int end = start + node.primCount;
+        int mid;
+        if (builder == RenderOption::BVHBuilder::LBVH) {
+            mid = findSplit(mortonCodes, start, end - 1) + 1;
+        }
+        else {
+            // 与 buildRecursive 相同: 最长轴上按质心取中位数; 只重排本节点的区间, 其他线程不会读它
+            int axis = node.bounds.longestAxis();
+            mid = (start + end) / 2;
+            std::nth_element(primitives.begin() + start, primitives.begin() + mid,
+                primitives.begin() + end,
+                [axis](const Primitive& a, const Primitive& b) {
+                    return a.bounds.centroid()[axis] < b.bounds.centroid()[axis];
+                });
+        }
+        int left = nodeCount.fetch_add(2);
+        initLazyNode(left, start, mid);
+        initLazyNode(left + 1, mid, end);
+        node.primStart = 0;
+        node.primCount = 0;
+        node.right = left + 1;
+        node.left = left;
+    }
+
+    void BVHTree::expand(int idx) const {
+        auto& state = nodeState[idx];
+        int expected = UNBUILT;
+        if (state.compare_exchange_strong(expected, BUILDING, memory_order_acquire)) {
+            // 按需构建发生在求交过程中, 节点与图元数组本身不是 const 对象
+            const_cast<BVHTree*>(this)->splitLazyNode(idx);
+            state.store(BUILT, memory_order_release);
+        }
+        else {
+            while (state.load(memory_order_acquire) != BUILT) this_thread::yield();
+        }
+    }
+
+    void BVHTree::buildSBVH() {
+        vector<Primitive> refs;
+        refs.swap(primitives);
+        AABB root;
+        for (auto& r : refs) root.expand(r.bounds);
+        sbvhRefs = refs.size();
+        sbvhRefLimit = size_t(float(refs.size()) * (1.f + sbvhDuplicationBudget));
+        sbvhMinOverlap = root.surfaceArea() * sbvhAlpha;
+        nodes.reserve(sbvhRefLimit);
+        primitives.reserve(sbvhRefLimit);
+        buildSBVHNode(refs, 0);
+    }
+
+    void BVHTree::splitReference(const Primitive& ref, int axis, float pos, AABB& left, AABB& right) const {
+        left = AABB{};
+        right = AABB{};
+        Vec3 v[3];
+        if (triangleOf(ref, v)) {
+            for (int i = 0; i < 3; i++) {
+                const Vec3& a = v[i];
+                const Vec3& b = v[(i + 1) % 3];
+                if (a[axis] <= pos) left.expand(a);
+                if (a[axis] >= pos) right.expand(a);
+                // 边与平面的交点同时属于两侧
+                if ((a[axis] < pos && b[axis] > pos) || (a[axis] > pos && b[axis] < pos)) {
+                    Vec3 p = a + (b - a) * std::clamp((pos - a[axis]) / (b[axis] - a[axis]), 0.f, 1.f);
+                    p[axis] = pos;
+                    left.expand(p);
+                    right.expand(p);
+                }
+            }
+        }
+        else {
+            left = ref.bounds;
+            right = ref.bounds;
+        }
+        left.max[axis] = std::min(left.max[axis], pos);
+        right.min[axis] = std::max(right.min[axis], pos);
+        // 引用可能已经被裁剪过, 结果不能超出原有的包围盒
+        left = intersectBox(left, ref.bounds);
+        right = intersectBox(right, ref.bounds);
+    }
+
+    int BVHTree::buildSBVHNode(vector<Primitive>& refs, int depth) {
+        int nodeIdx = nodes.size();
+        nodes.push_back(BVHNode{});
+
+        AABB bounds, centroids;
+        for (auto& r : refs) {
+            bounds.expand(r.bounds);
+            centroids.expand(r.bounds.centroid());
+        }
+        nodes[nodeIdx].bounds = bounds;
+
+        const int n = refs.size();
+        auto makeLeaf = [&]() {
+            nodes[nodeIdx].primStart = primitives.size();
+            nodes[nodeIdx].primCount = n;
+            primitives.insert(primitives.end(), refs.begin(), refs.end());
+            vector<Primitive>().swap(refs);
+            return nodeIdx;
+        };
+        if (n <= 2) return makeLeaf();
+
+        // 代价以本节点表面积归一化: 遍历一个节点与求交一个图元都取 1, 与 nodeCost 一致
+        const float area = bounds.surfaceArea();
+        const float invArea = area > 0 ? 1.f / area : 0.f;
+        float bestCost = FLOAT_INF;
+        int objAxis = -1, objBin = 0;
+        AABB objLeft, objRight;
+        auto objectBin = [&](const Primitive& r, int axis) {
+            float extent = centroids.max[axis] - centroids.min[axis];
+            int b = int((r.bounds.centroid()[axis] - centroids.min[axis]) / extent * float(sbvhBins));
+            return std::clamp(b, 0, sbvhBins - 1);
+        };
+
+        struct Bin {
+            AABB box;
+            int enter = 0;
+            int exit = 0;
+        };
+        Bin bins[sbvhBins];
+        AABB rightBox[sbvhBins];
+        int rightCount[sbvhBins];
+
+        // 对象划分: 按质心分箱
+        if (depth < sbvhMaxDepth) {
+            for (int axis = 0; axis < 3; axis++) {
+                if (centroids.max[axis] <= centroids.min[axis]) continue;
+                for (auto& b : bins) b = Bin{};
+                for (auto& r : refs) {
+                    auto& b = bins[objectBin(r, axis)];
+                    b.box.expand(r.bounds);
+                    b.enter++;
+                }
+                AABB acc;
+                int count = 0;
+                for (int i = sbvhBins - 1; i > 0; i--) {
+                    acc.expand(bins[i].box);
+                    count += bins[i].enter;
+                    rightBox[i] = acc;
+                    rightCount[i] = count;
+                }
+                acc = AABB{};
+                count = 0;
+                for (int i = 1; i < sbvhBins; i++) {
+                    acc.expand(bins[i - 1].box);
+                    count += bins[i - 1].enter;
+                    if (count == 0 || rightCount[i] == 0) continue;
+                    float cost = 1.f + (acc.surfaceArea()*count + rightBox[i].surfaceArea()*rightCount[i]) * invArea;
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        objAxis = axis;
+                        objBin = i;
+                        objLeft = acc;
+                        objRight = rightBox[i];
+                    }
+                }
+            }
+        }
+
+        // 空间划分: 只在对象划分的孩子明显重叠且还有复制预算时尝试
+        int spatialAxis = -1;
+        float spatialPos = 0;
+        bool trySpatial = depth < sbvhMaxDepth && sbvhRefs < sbvhRefLimit
+            && (objAxis < 0 || intersectBox(objLeft, objRight).surfaceArea() > sbvhMinOverlap);
+        if (trySpatial) {
+            for (int axis = 0; axis < 3; axis++) {
+                float lo = bounds.min[axis];
+                float extent = bounds.max[axis] - lo;
+                if (extent <= 0) continue;
+                float binWidth = extent / float(sbvhBins);
+                auto bin = [&](float x) { return std::clamp(int((x - lo) / binWidth), 0, sbvhBins - 1); };
+                for (auto& b : bins) b = Bin{};
+                // 引用在所跨越的每个箱子里只贡献落在箱子内的部分
+                for (auto& r : refs) {
+                    int first = bin(r.bounds.min[axis]);
+                    int last = bin(r.bounds.max[axis]);
+                    Primitive rest = r;
+                    for (int i = first; i < last; i++) {
+                        AABB piece, remain;
+                        splitReference(rest, axis, lo + binWidth*float(i + 1), piece, remain);
+                        bins[i].box.expand(piece);
+                        rest.bounds = remain;
+                    }
+                    bins[last].box.expand(rest.bounds);
+                    bins[first].enter++;
+                    bins[last].exit++;
+                }
+                AABB acc;
+                int count = 0;
+                for (int i = sbvhBins - 1; i > 0; i--) {
+                    acc.expand(bins[i].box);
+                    count += bins[i].exit;
+                    rightBox[i] = acc;
+                    rightCount[i] = count;
+                }
+                acc = AABB{};
+                count = 0;
+                for (int i = 1; i < sbvhBins; i++) {
+                    acc.expand(bins[i - 1].box);
+                    count += bins[i - 1].enter;
+                    if (count == 0 || rightCount[i] == 0) continue;
+                    float cost = 1.f + (acc.surfaceArea()*count + rightBox[i].surfaceArea()*rightCount[i]) * invArea;
+                    if (cost < bestCost) {
+                        bestCost = cost;
+                        spatialAxis = axis;
+                        spatialPos = lo + binWidth*float(i);
+                    }
+                }
+            }
+        }
+
+        if (n <= sbvhMaxLeaf && float(n) <= bestCost) return makeLeaf();
+
+        vector<Primitive> left, right;
+        if (spatialAxis >= 0) {
+            const int axis = spatialAxis;
+            const float pos = spatialPos;
+            AABB leftBox, rightBox;
+            vector<Primitive> straddling;
+            for (auto& r : refs) {
+                if (r.bounds.max[axis] <= pos) {
+                    leftBox.expand(r.bounds);
+                    left.push_back(r);
+                }
+                else if (r.bounds.min[axis] >= pos) {
+                    rightBox.expand(r.bounds);
+                    right.push_back(r);
+                }
+                else {
+                    straddling.push_back(r);
+                }
+            }
+            vector<AABB> leftPiece(straddling.size()), rightPiece(straddling.size());
+            for (size_t i = 0; i < straddling.size(); i++) {
+                splitReference(straddling[i], axis, pos, leftPiece[i], rightPiece[i]);
+                leftBox.expand(leftPiece[i]);
+                rightBox.expand(rightPiece[i]);
+            }
+            // 逐个决定跨越平面的引用是复制到两侧还是整体放到一侧 (reference unsplitting)
+            float nl = float(left.size() + straddling.size());
+            float nr = float(right.size() + straddling.size());
+            for (size_t i = 0; i < straddling.size(); i++) {
+                auto& r = straddling[i];
+                float splitCost = sbvhRefs < sbvhRefLimit
+                    ? leftBox.surfaceArea()*nl + rightBox.surfaceArea()*nr : FLOAT_INF;
+                float leftCost = unionArea(leftBox, r.bounds)*nl + rightBox.surfaceArea()*(nr - 1);
+                float rightCost = leftBox.surfaceArea()*(nl - 1) + unionArea(rightBox, r.bounds)*nr;
+                if (splitCost <= leftCost && splitCost <= rightCost) {
+                    sbvhRefs++;
+                    left.push_back({r.type, r.index, leftPiece[i]});
+                    right.push_back({r.type, r.index, rightPiece[i]});
+                }
+                else if (leftCost <= rightCost) {
+                    leftBox.expand(r.bounds);
+                    left.push_back(r);
+                    nr -= 1;
+                }
+                else {
+                    rightBox.expand(r.bounds);
+                    right.push_back(r);
+                    nl -= 1;
+                }
+            }
+        }
+        else if (objAxis >= 0) {
+            for (auto& r : refs) {
+                (objectBin(r, objAxis) < objBin ? left : right).push_back(r);
+            }
+        }
+        if (left.empty() || right.empty()) {
+            // 没有可用的划分 (质心重合或超过深度): 与 buildRecursive 相同, 按最长轴质心的中位数划分
+            if (n <= sbvhMaxLeaf) return makeLeaf();
+            int axis = bounds.longestAxis();
+            int mid = n / 2;
+            std::nth_element(refs.begin(), refs.begin() + mid, refs.end(),
+                [axis](const Primitive& a, const Primitive& b) {
+                    return a.bounds.centroid()[axis] < b.bounds.centroid()[axis];
+                });
+            left.assign(refs.begin(), refs.begin() + mid);
+            right.assign(refs.begin() + mid, refs.end());
+        }
+        vector<Primitive>().swap(refs);
+
+        int l = buildSBVHNode(left, depth + 1);
+        int r = buildSBVHNode(right, depth + 1);
+        nodes[nodeIdx].left = l;
+        nodes[nodeIdx].right = r;
+        return nodeIdx;
+    }
+
+    void BVHTree::restructure() {
+        // 自底向上处理; 只接受不增加节点高度的旋转, 保证遍历栈深度不超过构建时
+        vector<int> height(nodes.size(), 0);
+        auto unionArea = [this](int a, int b) {
+            AABB box = nodes[a].bounds;
+            box.expand(nodes[b].bounds);
+            return box.surfaceArea();
+        };
+        for (int i = int(nodes.size()) - 1; i >= 0; i--) {
+            auto& node = nodes[i];
+            if (node.isLeaf()) continue;
+            // 候选: 把 other 与 child 的某个孩子交换, child 的新包围盒越小越好
+            int bestChild = -1, bestSlot = 0;
+            float bestGain = 0;
+            for (int side = 0; side < 2; side++) {
+                int child = side == 0 ? node.right : node.left;
+                int other = side == 0 ? node.left : node.right;
+                auto& c = nodes[child];
+                if (c.isLeaf()) continue;
+                float area = c.bounds.surfaceArea();
+                for (int slot = 0; slot < 2; slot++) {
+                    int moved = slot == 0 ? c.left : c.right;
+                    int kept = slot == 0 ? c.right : c.left;
+                    int newChildHeight = 1 + std::max(height[other], height[kept]);
+                    int newHeight = 1 + std::max(height[moved], newChildHeight);
+                    if (newHeight > 1 + std::max(height[node.left], height[node.right])) continue;
+                    float gain = area - unionArea(other, kept);
+                    if (gain > bestGain) {
+                        bestGain = gain;
+                        bestChild = side;
+                        bestSlot = slot;
+                    }
+                }
+            }
+            if (bestChild != -1) {
+                int& childRef = bestChild == 0 ? node.right : node.left;
+                int& otherRef = bestChild == 0 ? node.left : node.right;
+                auto& c = nodes[childRef];
+                int& movedRef = bestSlot == 0 ? c.left : c.right;
+                std::swap(otherRef, movedRef);
+                c.bounds = nodes[c.left].bounds;
+                c.bounds.expand(nodes[c.right].bounds);
+                height[childRef] = 1 + std::max(height[c.left], height[c.right]);
+            }
+            height[i] = 1 + std::max(height[node.left], height[node.right]);
+        }
+
+        // 旋转打乱了节点顺序, 重新按先序排列, refit 依赖子节点下标大于父节点
+        vector<BVHNode> ordered;
+        ordered.reserve(nodes.size());
+        vector<pair<int, int>> stack{{0, -1}};
+        while (!stack.empty()) {
+            auto [idx, parentSlot] = stack.back();
+            stack.pop_back();
+            int newIdx = ordered.size();
+            ordered.push_back(nodes[idx]);
+            if (parentSlot >= 0) {
+                // parentSlot 编码为 父节点下标*2 + (是否右孩子)
+                auto& parent = ordered[parentSlot >> 1];
+                (parentSlot & 1 ? parent.right : parent.left) = newIdx;
+            }
+            if (!nodes[idx].isLeaf()) {
+                stack.push_back({nodes[idx].right, newIdx*2 + 1});
+                stack.push_back({nodes[idx].left, newIdx*2});
+            }
+        }
+        nodes.swap(ordered);
+    }
+}
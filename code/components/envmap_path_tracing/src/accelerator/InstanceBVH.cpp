@@ -0,0 +1,202 @@
+#include "accelerator/InstanceBVH.hpp"
+#include "scene/WorldTransform.hpp"
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+namespace EnvMapPathTracer
+{
+    namespace
+    {
+        // 底层 BVH 缓存, 跨渲染保留; 每次构建后只保留当前场景用到的条目
+        struct BlasCache
+        {
+            mutex mtx;
+            vector<shared_ptr<MeshBVH>> entries;
+        };
+
+        BlasCache& blasCache() {
+            static BlasCache c;
+            return c;
+        }
+
+        AABB transformBounds(const AABB& b, const Mat4x4& m) {
+            AABB r;
+            for (int i = 0; i < 8; i++) {
+                Vec3 p{ (i & 1) ? b.max.x : b.min.x, (i & 2) ? b.max.y : b.min.y, (i & 4) ? b.max.z : b.min.z };
+                r.expand(Vec3{m*Vec4{p, 1}});
+            }
+            return r;
+        }
+    }
+
+    void InstanceBVH::build(const Scene& scene) {
+        nodes.clear();
+        instances.clear();
+        uniqueMeshes = 0;
+        blasBytes = 0;
+
+        vector<const Node*> meshNodes;
+        for (auto& node : scene.nodes) {
+            if (node.type == Node::Type::MESH && !scene.meshBuffer[node.entity].positionIndices.empty()) {
+                meshNodes.push_back(&node);
+            }
+        }
+        if (meshNodes.empty()) return;
+
+        auto& cache = blasCache();
+        lock_guard<mutex> lk(cache.mtx);
+
+        // 为每个实例找到底层 BVH: 先按数据身份查找, 未命中再按内容哈希查找; 构建方式必须与 renderOption 相同
+        // 缓存中没有的网格去重后并行构建, 与场景 BVH 使用同一种构建方式
+        vector<shared_ptr<MeshBVH>> blas(meshNodes.size());
+        vector<shared_ptr<MeshBVH>> used;
+        vector<shared_ptr<MeshBVH>> built;
+        auto& option = scene.renderOption;
+        auto find = [&option](const vector<shared_ptr<MeshBVH>>& v, const Mesh& mesh, uint64_t h, bool byContent) -> shared_ptr<MeshBVH> {
+            for (auto& e : v) {
+                if (!e->builtWith(option)) continue;
+                if (byContent ? e->matches(mesh, h) : (e->positions.sameData(mesh.positions) && e->indices.sameData(mesh.positionIndices))) return e;
+            }
+            return nullptr;
+        };
+        for (size_t i = 0; i < meshNodes.size(); i++) {
+            auto& mesh = scene.meshBuffer[meshNodes[i]->entity];
+            auto e = find(used, mesh, 0, false);
+            if (!e) {
+                e = find(cache.entries, mesh, 0, false);
+                if (!e) {
+                    uint64_t h = MeshBVH::hashMesh(mesh);
+                    e = find(used, mesh, h, true);
+                    if (!e) e = find(cache.entries, mesh, h, true);
+                    if (!e) {
+                        e = make_shared<MeshBVH>();
+                        // 先登记数据, 同一场景中相同的网格不再重复构建
+                        e->bind(mesh, h, option);
+                        built.push_back(e);
+                    }
+                }
+                if (std::find(used.begin(), used.end(), e) == used.end()) used.push_back(e);
+            }
+            blas[i] = e;
+        }
+
+        if (!built.empty()) {
+            atomic<size_t> next{0};
+            auto task = [&]() {
+                for (size_t i = next++; i < built.size(); i = next++) {
+                    built[i]->build();
+                }
+            };
+            const size_t taskNums = std::min<size_t>(8, built.size());
+            vector<thread> t;
+            for (size_t i = 0; i < taskNums; i++) t.emplace_back(task);
+            for (auto& th : t) th.join();
+        }
+        cache.entries = used;
+        uniqueMeshes = used.size();
+        for (auto& e : used) blasBytes += e->footprint();
+
+        instances.resize(meshNodes.size());
+        for (size_t i = 0; i < meshNodes.size(); i++) {
+            auto& inst = instances[i];
+            inst.blas = blas[i];
+            inst.mesh = &scene.meshBuffer[meshNodes[i]->entity];
+            inst.toWorld = modelMatrix(scene.models[meshNodes[i]->model]);
+            inst.toLocal = glm::inverse(inst.toWorld);
+            inst.normalMatrix = glm::transpose(glm::inverse(Mat3x3{inst.toWorld}));
+            inst.bounds = transformBounds(inst.blas->bounds(), inst.toWorld);
+        }
+
+        nodes.reserve(instances.size() * 2);
+        buildRecursive(0, int(instances.size()));
+    }
+
+    int InstanceBVH::buildRecursive(int start, int end) {
+        int nodeIdx = nodes.size();
+        nodes.push_back(BVHNode{});
+
+        AABB bounds;
+        for (int i = start; i < end; i++) {
+            bounds.expand(instances[i].bounds);
+        }
+        nodes[nodeIdx].bounds = bounds;
+
+        int count = end - start;
+        if (count <= 2) {
+            nodes[nodeIdx].primStart = start;
+            nodes[nodeIdx].primCount = count;
+            return nodeIdx;
+        }
+
+        int axis = bounds.longestAxis();
+        int mid = (start + end) / 2;
+        std::nth_element(instances.begin() + start, instances.begin() + mid,
+            instances.begin() + end,
+            [axis](const Instance& a, const Instance& b) {
+                return a.bounds.centroid()[axis] < b.bounds.centroid()[axis];
+            });
+
+        int left = buildRecursive(start, mid);
+        int right = buildRecursive(mid, end);
+        nodes[nodeIdx].left = left;
+        nodes[nodeIdx].right = right;
+        return nodeIdx;
+    }
+
+    HitRecord InstanceBVH::intersect(const Ray& ray, float tMin, float tMax) const {
+        if (nodes.empty()) return nullopt;
+
+        const Instance* hitInstance = nullptr;
+        float closestT = tMax;
+        unsigned int hitFace = 0;
+        float hitB1 = 0, hitB2 = 0;
+
+        int stack[64];
+        int stackPtr = 0;
+        stack[stackPtr++] = 0;
+
+        while (stackPtr > 0) {
+            const BVHNode& node = nodes[stack[--stackPtr]];
+            if (!node.bounds.hit(ray, tMin, closestT)) continue;
+
+            if (node.isLeaf()) {
+                for (int i = 0; i < node.primCount; i++) {
+                    auto& inst = instances[node.primStart + i];
+                    // 光线变换到局部坐标, 方向不归一化, t 在两个坐标系下相同
+                    Ray local{ Vec3{inst.toLocal*Vec4{ray.origin, 1}}, Mat3x3{inst.toLocal}*ray.direction };
+                    float t, b1, b2;
+                    unsigned int face;
+                    if (inst.blas->intersect(local, tMin, closestT, t, face, b1, b2)) {
+                        closestT = t;
+                        hitInstance = &inst;
+                        hitFace = face;
+                        hitB1 = b1;
+                        hitB2 = b2;
+                    }
+                }
+            } else {
+                stack[stackPtr++] = node.left;
+                stack[stackPtr++] = node.right;
+            }
+        }
+        if (!hitInstance) return nullopt;
+
+        auto& m = *hitInstance->mesh;
+        Vec3 normal;
+        if (m.hasNormal() && (m.normalIndices.size() == m.positionIndices.size())) {
+            normal = (1.f - hitB1 - hitB2)*m.normals[m.normalIndices[hitFace]]
+                + hitB1*m.normals[m.normalIndices[hitFace + 1]]
+                + hitB2*m.normals[m.normalIndices[hitFace + 2]];
+        }
+        else {
+            const auto& v1 = m.positions[m.positionIndices[hitFace]];
+            const auto& v2 = m.positions[m.positionIndices[hitFace + 1]];
+            const auto& v3 = m.positions[m.positionIndices[hitFace + 2]];
+            normal = glm::cross(v2 - v1, v3 - v1);
+        }
+        normal = glm::normalize(hitInstance->normalMatrix*normal);
+        return getHitRecord(closestT, ray.at(closestT), normal, m.material);
+    }
+}
@@ -0,0 +1,115 @@
+#include "accelerator/MeshBVH.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace EnvMapPathTracer
+{
+    namespace
+    {
+        bool testTriangle(const Ray& ray, const Vec3& v1, const Vec3& v2, const Vec3& v3,
+            float tMin, float tMax, float& t, float& b1, float& b2) {
+            auto e1 = v2 - v1;
+            auto e2 = v3 - v1;
+            auto P = glm::cross(ray.direction, e2);
+            float det = glm::dot(e1, P);
+            Vec3 T;
+            if (det > 0) T = ray.origin - v1;
+            else { T = v1 - ray.origin; det = -det; }
+            if (det < 0.000001f) return false;
+            float u = glm::dot(T, P);
+            if (u > det || u < 0.f) return false;
+            Vec3 Q = glm::cross(T, e1);
+            float v = glm::dot(ray.direction, Q);
+            if (v < 0.f || v + u > det) return false;
+            float invDet = 1.f / det;
+            float w = glm::dot(e2, Q) * invDet;
+            if (w >= tMax || w < tMin) return false;
+            t = w;
+            b1 = u * invDet;
+            b2 = v * invDet;
+            return true;
+        }
+    }
+
+    uint64_t MeshBVH::hashMesh(const Mesh& mesh) {
+        uint64_t h = 1469598103934665603ull;
+        auto bytes = [&h](const void* p, size_t n) {
+            auto c = static_cast<const unsigned char*>(p);
+            size_t i = 0;
+            for (; i + 8 <= n; i += 8) {
+                uint64_t w;
+                memcpy(&w, c + i, 8);
+                h ^= w;
+                h *= 1099511628211ull;
+            }
+            for (; i < n; i++) {
+                h ^= c[i];
+                h *= 1099511628211ull;
+            }
+        };
+        bytes(mesh.positions.data(), mesh.positions.size()*sizeof(Vec3));
+        bytes(mesh.positionIndices.data(), mesh.positionIndices.size()*sizeof(Index));
+        return h;
+    }
+
+    bool MeshBVH::matches(const Mesh& mesh, uint64_t meshHash) const {
+        if (positions.sameData(mesh.positions) && indices.sameData(mesh.positionIndices)) return true;
+        return hash == meshHash
+            && positions.size() == mesh.positions.size()
+            && indices.size() == mesh.positionIndices.size()
+            && memcmp(positions.data(), mesh.positions.data(), positions.size()*sizeof(Vec3)) == 0
+            && memcmp(indices.data(), mesh.positionIndices.data(), indices.size()*sizeof(Index)) == 0;
+    }
+
+    bool MeshBVH::builtWith(const RenderOption& option) const {
+        return builder == option.bvhBuilder && lazy == option.lazyBuild;
+    }
+
+    bool MeshBVH::triangleOf(const Primitive& prim, Vec3 v[3]) const {
+        for (int i = 0; i < 3; i++) v[i] = positions[indices[prim.index + i]];
+        return true;
+    }
+
+    void MeshBVH::bind(const Mesh& mesh, uint64_t meshHash, const RenderOption& option) {
+        positions = mesh.positions;
+        indices = mesh.positionIndices;
+        hash = meshHash;
+        builder = option.bvhBuilder;
+        lazy = option.lazyBuild;
+    }
+
+    void MeshBVH::build() {
+        // 图元下标为面在 indices 中的起始下标
+        size_t faceNums = indices.size() / 3;
+        primitives.resize(faceNums);
+        for (size_t i = 0; i < faceNums; i++) {
+            auto& p = primitives[i];
+            p.type = PrimitiveType::TRIANGLE;
+            p.index = i*3;
+            p.bounds = AABB{};
+            p.bounds.expand(positions[indices[i*3]]);
+            p.bounds.expand(positions[indices[i*3 + 1]]);
+            p.bounds.expand(positions[indices[i*3 + 2]]);
+        }
+        buildNodes();
+        if (!lazy) compress();
+    }
+
+    bool MeshBVH::intersect(const Ray& ray, float tMin, float tMax, float& t, unsigned int& face, float& b1, float& b2) const {
+        bool hit = false;
+        float closestT = tMax;
+        traverse(ray, tMin, closestT, [&](uint32_t f) {
+            float tt, u, v;
+            if (testTriangle(ray, positions[indices[f]], positions[indices[f + 1]], positions[indices[f + 2]],
+                tMin, closestT, tt, u, v)) {
+                closestT = tt;
+                face = f;
+                b1 = u;
+                b2 = v;
+                hit = true;
+            }
+        });
+        if (hit) t = closestT;
+        return hit;
+    }
+}
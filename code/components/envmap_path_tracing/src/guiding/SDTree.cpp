@@ -0,0 +1,220 @@
+#include "guiding/SDTree.hpp"
+#include "shaders/Shader.hpp"
+
+namespace EnvMapPathTracer
+{
+    namespace
+    {
+        void atomicAdd(atomic<float>& a, float v) {
+            float cur = a.load(memory_order_relaxed);
+            while (!a.compare_exchange_weak(cur, cur + v, memory_order_relaxed));
+        }
+
+        // 象限编号: x 方向为低位, y 方向为高位
+        int quadrant(Vec2& p) {
+            int ix = p.x >= 0.5f ? 1 : 0;
+            int iy = p.y >= 0.5f ? 1 : 0;
+            p = p * 2.f - Vec2{ix, iy};
+            return ix + 2*iy;
+        }
+    }
+
+    DTree::Node::Node() {
+        for (auto& s : sum) s.store(0, memory_order_relaxed);
+    }
+
+    DTree::Node::Node(const Node& n) {
+        *this = n;
+    }
+
+    auto DTree::Node::operator=(const Node& n) -> Node& {
+        for (int i=0; i<4; i++) {
+            sum[i].store(n.sum[i].load(memory_order_relaxed), memory_order_relaxed);
+            child[i] = n.child[i];
+        }
+        return *this;
+    }
+
+    float DTree::Node::total() const {
+        float t = 0;
+        for (auto& s : sum) t += s.load(memory_order_relaxed);
+        return t;
+    }
+
+    DTree::DTree()
+        : nodes(1)
+    {}
+
+    DTree::DTree(const DTree& t)
+        : nodes(t.nodes)
+    {}
+
+    DTree& DTree::operator=(const DTree& t) {
+        nodes = t.nodes;
+        return *this;
+    }
+
+    Vec2 DTree::toSquare(const Vec3& d) {
+        float cosTheta = glm::clamp(d.z, -1.f, 1.f);
+        float phi = atan2(d.y, d.x);
+        if (phi < 0) phi += 2*PI;
+        return glm::clamp(Vec2{(cosTheta + 1.f)*0.5f, phi/(2*PI)}, Vec2{0}, Vec2{0.99999994f});
+    }
+
+    Vec3 DTree::toSphere(const Vec2& p) {
+        float cosTheta = 2*p.x - 1;
+        float sinTheta = sqrt(glm::max(0.f, 1 - cosTheta*cosTheta));
+        float phi = 2*PI*p.y;
+        return {sinTheta*cos(phi), sinTheta*sin(phi), cosTheta};
+    }
+
+    void DTree::record(const Vec3& d, float value) {
+        if (!(value >= 0) || isinf(value)) return;
+        Vec2 p = toSquare(d);
+        int node = 0;
+        while (true) {
+            int q = quadrant(p);
+            atomicAdd(nodes[node].sum[q], value);
+            if (nodes[node].child[q] == 0) break;
+            node = nodes[node].child[q];
+        }
+    }
+
+    float DTree::pdf(const Vec3& d) const {
+        Vec2 p = toSquare(d);
+        float density = 1;
+        int node = 0;
+        while (true) {
+            float t = nodes[node].total();
+            if (t <= 0) return 0;
+            int q = quadrant(p);
+            density *= 4*nodes[node].sum[q].load(memory_order_relaxed) / t;
+            if (nodes[node].child[q] == 0) break;
+            node = nodes[node].child[q];
+        }
+        // [0, 1]^2 到单位球的映射面积比为 4π
+        return density / (4*PI);
+    }
+
+    Vec3 DTree::sample(Vec2 u) const {
+        Vec2 origin{0};
+        float size = 1;
+        int node = 0;
+        while (true) {
+            float s[4];
+            for (int i=0; i<4; i++) s[i] = nodes[node].sum[i].load(memory_order_relaxed);
+            // 先按上下两行的能量选行, 再在行内选列, 随机数在选择后重新缩放到 [0, 1)
+            float bottom = s[0] + s[1], t = bottom + s[2] + s[3];
+            float pRow = t > 0 ? bottom/t : 0.5f;
+            int row = 0;
+            if (u.y < pRow) u.y /= pRow;
+            else {
+                u.y = (u.y - pRow) / (1 - pRow);
+                row = 1;
+            }
+            float rowSum = s[2*row] + s[2*row + 1];
+            float pCol = rowSum > 0 ? s[2*row]/rowSum : 0.5f;
+            int col = 0;
+            if (u.x < pCol) u.x /= pCol;
+            else {
+                u.x = (u.x - pCol) / (1 - pCol);
+                col = 1;
+            }
+            u = glm::clamp(u, Vec2{0}, Vec2{0.99999994f});
+            size *= 0.5f;
+            origin += size * Vec2{col, row};
+            int q = col + 2*row;
+            if (nodes[node].child[q] == 0) return toSphere(origin + size*u);
+            node = nodes[node].child[q];
+        }
+    }
+
+    void DTree::refine(float threshold) {
+        vector<Node> old;
+        old.swap(nodes);
+        nodes.resize(1);
+        float t = old[0].total();
+        if (t <= 0) return;
+        float sums[4];
+        for (int i=0; i<4; i++) sums[i] = old[0].sum[i].load(memory_order_relaxed);
+        refineNode(old, 0, sums, 0, 1, t, threshold);
+    }
+
+    void DTree::refineNode(const vector<Node>& old, int oldNode, const float sums[4],
+        int node, int depth, float total, float threshold) {
+        if (depth >= maxDepth) return;
+        for (int q=0; q<4; q++) {
+            if (sums[q] / total <= threshold) continue;
+            int c = int(nodes.size());
+            nodes.emplace_back();
+            nodes[node].child[q] = c;
+            int oldChild = (oldNode >= 0 && old[oldNode].child[q] != 0) ? old[oldNode].child[q] : -1;
+            float childSums[4];
+            for (int i=0; i<4; i++) {
+                childSums[i] = oldChild >= 0 ? old[oldChild].sum[i].load(memory_order_relaxed) : sums[q]*0.25f;
+            }
+            refineNode(old, oldChild, childSums, c, depth + 1, total, threshold);
+        }
+    }
+
+    SDTree::Leaf::Leaf(const Leaf& l)
+        : sampling(l.sampling)
+        , building(l.building)
+        , samples(l.samples.load(memory_order_relaxed))
+    {}
+
+    void SDTree::build(const AABB& b) {
+        box = b;
+        // 包围盒较薄的方向放宽一些, 避免除以 0
+        Vec3 d = glm::max(box.max - box.min, Vec3{0.0001f});
+        box.max = box.min + d;
+        nodes.assign(1, Node{});
+        leaves.clear();
+        leaves.emplace_back();
+    }
+
+    int SDTree::lookup(const Vec3& p) const {
+        Vec3 local = glm::clamp((p - box.min) / (box.max - box.min), Vec3{0}, Vec3{0.99999994f});
+        int node = 0;
+        while (nodes[node].child != 0) {
+            int a = nodes[node].axis;
+            local[a] *= 2;
+            if (local[a] >= 1) {
+                local[a] -= 1;
+                node = nodes[node].child + 1;
+            }
+            else node = nodes[node].child;
+        }
+        return nodes[node].leaf;
+    }
+
+    void SDTree::record(int l, const Vec3& d, float value) {
+        auto& leaf = leaves[l];
+        leaf.building.record(d, value);
+        leaf.samples.fetch_add(1, memory_order_relaxed);
+    }
+
+    void SDTree::refine(int iteration) {
+        float threshold = spatialThreshold * sqrt(float(1u << iteration));
+        // 新加入的孩子也会被遍历到, 一次可以划分多层; 孩子各继承一半的记录数
+        for (size_t i=0; i<nodes.size(); i++) {
+            if (nodes[i].child != 0) continue;
+            int leaf = nodes[i].leaf;
+            uint32_t count = leaves[leaf].samples.load(memory_order_relaxed);
+            if (count <= threshold) continue;
+            leaves[leaf].samples.store(count / 2, memory_order_relaxed);
+            int other = int(leaves.size());
+            leaves.push_back(leaves[leaf]);
+            int c = int(nodes.size());
+            int axis = (nodes[i].axis + 1) % 3;
+            nodes.push_back(Node{axis, 0, leaf});
+            nodes.push_back(Node{axis, 0, other});
+            nodes[i].child = c;
+        }
+        for (auto& l : leaves) {
+            l.sampling = l.building;
+            l.building.refine(directionalThreshold);
+            l.samples.store(0, memory_order_relaxed);
+        }
+    }
+}
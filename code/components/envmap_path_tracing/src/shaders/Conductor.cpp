@@ -22,4 +22,9 @@ namespace EnvMapPathTracer
             1.0f         // delta分布，pdf=1
         };
     }
+
+    float Conductor::pdf(const Vec3&, const Vec3&) const {
+        // delta 分布, 路径引导只对非 delta 材质查询 pdf
+        return 0;
+    }
 }
@@ -69,4 +69,9 @@ namespace EnvMapPathTracer
             1.0f
         };
     }
+
+    float Dielectric::pdf(const Vec3&, const Vec3&) const {
+        // delta 分布, 路径引导只对非 delta 材质查询 pdf
+        return 0;
+    }
 }
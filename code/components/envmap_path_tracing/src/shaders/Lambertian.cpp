@@ -34,4 +34,8 @@ namespace EnvMapPathTracer
             pdf
         };
     }
+
+    float Lambertian::pdf(const Vec3& normal, const Vec3& wi) const {
+        return glm::max(glm::dot(wi, normal), 0.f) / PI;
+    }
 }
@@ -16,15 +16,18 @@ namespace RenderExample
 
             int height = spScene->renderOption.height;
             int width = spScene->renderOption.width;
-            RGBA* pixels = new RGBA[height*width]{};
+            // 输出线性 HDR 颜色, 色调映射与 gamma 由 Screen 在显示时完成
+            FrameBuffer frame{unsigned(width), unsigned(height)};
+            RGB* color = frame.float3(FrameBuffer::COLOR);
+            // 需要时也可以输出其他通道, 在结果窗口中切换显示
+            float* depth = frame.float1(FrameBuffer::DEPTH);
             for (int i=0; i<height; i++) {
                 for (int j=0; j<width; j++) {
-                    pixels[i*width+j] = {float(i)/float(height), float(j)/float(width), 1.f, 1.f};
+                    color[i*width+j] = {float(i)/float(height), float(j)/float(width), 1.f};
+                    depth[i*width+j] = float(i + j);
                 }
             }
-            // 输出颜色
-            getServer().screen.set(pixels, width, height);
-            delete[] pixels;
+            getServer().screen.set(frame);
 
             // logger
             getServer().logger.log("common...");
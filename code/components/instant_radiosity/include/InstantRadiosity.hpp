@@ -0,0 +1,95 @@
+#pragma once
+#ifndef __INSTANT_RADIOSITY_HPP__
+#define __INSTANT_RADIOSITY_HPP__
+
+#include "scene/Scene.hpp"
+#include "Ray.hpp"
+#include "Camera.hpp"
+#include "intersections/intersections.hpp"
+#include "VertexTransformer.hpp"
+#include "KDTree.hpp"
+
+#include <tuple>
+#include <mutex>
+#include <cstdint>
+
+namespace InstantRadiosity
+{
+    using namespace NRenderer;
+    using namespace std;
+
+    // 虚拟点光源: power 已包含沉积点的漫反射系数 albedo/PI
+    struct VPL
+    {
+        Vec3 position;
+        Vec3 normal;
+        Vec3 power;
+    };
+
+    // 组件实例每次渲染都会重建, VPL 放在静态缓存里, 只要场景内容(不含相机与分辨率)不变就复用
+    struct VPLCache
+    {
+        mutex mtx;
+        uint64_t sceneKey = 0;
+        bool valid = false;
+        vector<VPL> vpls;
+        float clampDistance2 = 0.f;
+    };
+
+    class InstantRadiosityRenderer
+    {
+    private:
+        SharedScene spScene;
+        Scene& scene;
+
+        unsigned int width;
+        unsigned int height;
+        unsigned int depth;
+        unsigned int samples;
+        int pathsPerLight;
+
+        Camera camera;
+        unique_ptr<KDTree> accel;
+
+        // 只读引用缓存中的 VPL, 渲染期间缓存不会被改写
+        const vector<VPL>* vpls;
+        float clampDistance2;
+    public:
+        InstantRadiosityRenderer(SharedScene spScene)
+            : spScene               (spScene)
+            , scene                 (*spScene)
+            , camera                (spScene->camera)
+            , vpls                  (nullptr)
+            , clampDistance2        (0.f)
+        {
+            width = scene.renderOption.width;
+            height = scene.renderOption.height;
+            depth = scene.renderOption.depth;
+            samples = scene.renderOption.samplesPerPixel;
+            if (samples < 1) samples = 1;
+            pathsPerLight = scene.renderOption.vplPathsPerLight;
+            if (pathsPerLight < 16) pathsPerLight = 16;
+            if (pathsPerLight > 20000) pathsPerLight = 20000;
+        }
+        ~InstantRadiosityRenderer() = default;
+
+        using RenderResult = tuple<RGBA*, unsigned int, unsigned int>;
+        RenderResult render();
+        void release(const RenderResult& r);
+
+    private:
+        void renderTask(RGBA* pixels, int width, int height, int off, int step);
+        RGB trace(const Ray& ray, int currDepth, unsigned int sampleIdx);
+        HitRecord closestHitObject(const Ray& r);
+        bool occluded(const Ray& r, float tMax);
+        tuple<float, Vec3> closestHitLight(const Ray& r);
+        Vec3 sampleHemisphereCosine() const;
+        Vec3 toWorld(const Vec3& n, const Vec3& local) const;
+
+        uint64_t sceneKey() const;
+        void buildVPLs(vector<VPL>& out);
+        static VPLCache& cache();
+    };
+}
+
+#endif
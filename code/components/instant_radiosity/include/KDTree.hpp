@@ -0,0 +1,71 @@
+#pragma once
+#ifndef __KDTREE_HPP__
+#define __KDTREE_HPP__
+
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include <atomic>
+
+#include "scene/Scene.hpp"
+#include "Ray.hpp"
+#include "intersections/intersections.hpp"
+#include "intersections/HitRecord.hpp"
+
+namespace InstantRadiosity
+{
+    using namespace NRenderer;
+
+    class KDTree
+    {
+    public:
+        KDTree() = default;
+        void setLeafSize(int s);
+        // 按需构建: 只建根节点, 内部节点在第一次被光线访问时才划分
+        void setLazy(bool l);
+        void buildFromScene(const Scene& scene);
+        HitRecord closestHit(const Ray& ray, float tMin, float tMax) const;
+        // 阴影测试: 找到任意一个交点即返回
+        bool occluded(const Ray& ray, float tMin, float tMax) const;
+
+    private:
+        struct Tri {
+            Vec3 v1, v2, v3;
+            Vec3 n1, n2, n3;
+            Vec3 normal;
+            Handle material;
+        };
+        struct AABB {
+            Vec3 min, max;
+        };
+        struct Node {
+            AABB box;
+            std::unique_ptr<Node> left;
+            std::unique_ptr<Node> right;
+            std::vector<int> indices;
+            // 按需构建时未划分的节点为 UNBUILT, indices 暂存它的全部三角形
+            mutable std::atomic<int> state{BUILT};
+            bool isLeaf() const { return !left && !right; }
+        };
+        enum NodeState : int { UNBUILT, BUILDING, BUILT };
+
+        std::unique_ptr<Node> root;
+        std::vector<Tri> tris;
+        int leafSize = 8;
+        bool lazy = false;
+
+        static AABB triBox(const Tri& t);
+        static AABB merge(const AABB& a, const AABB& b);
+        static bool hitAABB(const Ray& r, const AABB& box, float tMin, float tMax);
+        static bool hitAABBWithT(const Ray& r, const AABB& box, float tMin, float tMax, float& tNear);
+        static Vec3 centroid(const Tri& t);
+        std::unique_ptr<Node> build(const std::vector<int>& idx);
+        void split(Node& node);
+        // 由第一个访问到节点的线程划分, 其余线程等待划分完成
+        void expand(const Node* node) const;
+        HitRecord traverse(const Node* node, const Ray& r, float tMin, float tMax) const;
+        bool anyHit(const Node* node, const Ray& r, float tMin, float tMax) const;
+    };
+}
+
+#endif
\ No newline at end of file
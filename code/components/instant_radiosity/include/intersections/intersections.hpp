@@ -0,0 +1,21 @@
+#pragma once
+#ifndef __INTERSECTIONS_HPP__
+#define __INTERSECTIONS_HPP__
+
+#include "HitRecord.hpp"
+#include "Ray.hpp"
+#include "scene/Scene.hpp"
+
+namespace InstantRadiosity
+{
+    namespace Intersection
+    {
+        HitRecord xTriangle(const Ray& ray, const Triangle& t, float tMin = 0.f, float tMax = FLOAT_INF);
+        HitRecord xSphere(const Ray& ray, const Sphere& s, float tMin = 0.f, float tMax = FLOAT_INF);
+        HitRecord xPlane(const Ray& ray, const Plane& p, float tMin = 0.f, float tMax = FLOAT_INF);
+        HitRecord xAreaLight(const Ray& ray, const AreaLight& a, float tMin = 0.f, float tMax = FLOAT_INF);
+        HitRecord xMesh(const Ray& ray, const Mesh& m, float tMin = 0.f, float tMax = FLOAT_INF);
+    }
+}
+
+#endif
\ No newline at end of file
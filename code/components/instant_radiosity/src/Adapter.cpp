@@ -0,0 +1,35 @@
+#include "server/Server.hpp"
+#include "component/RenderComponent.hpp"
+
+#include "InstantRadiosity.hpp"
+
+using namespace std;
+using namespace NRenderer;
+
+namespace InstantRadiosity
+{
+    class Adapter : public RenderComponent
+    {
+    public:
+        void render(SharedScene spScene) {
+            InstantRadiosityRenderer renderer{spScene};
+            auto result = renderer.render();
+            auto [ pixels, width, height ] = result;
+            getServer().screen.setLinear(pixels, width, height);
+            renderer.release(result);
+        }
+    };
+}
+
+const static string description = 
+    "Instant Radiosity (VPL) Renderer.\n"
+    "Supported:\n"
+    " - Lambertian BRDF, mirror reflection\n"
+    " - Area Light\n"
+    " - Triangle, Sphere, Plane, Mesh\n"
+    " - Virtual point lights with clamped contribution\n"
+    " - VPLs are reused while only the camera changes\n\n"
+    "Please use path_tracing_cornel.scn"
+    ;
+
+REGISTER_RENDERER(Instant_Radiosity, description, InstantRadiosity::Adapter);
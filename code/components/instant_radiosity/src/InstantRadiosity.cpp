@@ -0,0 +1,331 @@
+#include "server/Server.hpp"
+#include "InstantRadiosity.hpp"
+
+#include <thread>
+#include <random>
+#include <variant>
+#include "glm/gtc/matrix_transform.hpp"
+
+namespace InstantRadiosity
+{
+    namespace
+    {
+        constexpr float PI = 3.1415926535898f;
+        // 以 VPL 包围盒对角线为尺度的距离截断, 抑制 VPL 附近的亮斑
+        constexpr float vplClampRatio = 0.03f;
+
+        // FNV-1a, 用于判断两次渲染之间场景内容是否变化
+        struct Hasher
+        {
+            uint64_t h = 1469598103934665603ull;
+            void bytes(const void* p, size_t n) {
+                auto c = static_cast<const unsigned char*>(p);
+                for (size_t i=0; i<n; i++) {
+                    h ^= c[i];
+                    h *= 1099511628211ull;
+                }
+            }
+            void f(float v) { bytes(&v, sizeof(v)); }
+            void u(uint64_t v) { bytes(&v, sizeof(v)); }
+            void v3(const Vec3& v) { f(v.x); f(v.y); f(v.z); }
+        };
+    }
+
+    VPLCache& InstantRadiosityRenderer::cache() {
+        static VPLCache c{};
+        return c;
+    }
+
+    void InstantRadiosityRenderer::release(const RenderResult& r) {
+        auto [p, w, h] = r;
+        delete[] p;
+    }
+
+    Vec3 InstantRadiosityRenderer::sampleHemisphereCosine() const {
+        thread_local static std::mt19937 rng{std::random_device{ }()};
+        thread_local static std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        float r1 = dist(rng);
+        float r2 = dist(rng);
+        float phi = 6.283185307179586f * r1;
+        float x = cos(phi) * sqrt(r2);
+        float y = sin(phi) * sqrt(r2);
+        float z = sqrt(glm::max(0.0f, 1.0f - r2));
+        return {x, y, z};
+    }
+
+    Vec3 InstantRadiosityRenderer::toWorld(const Vec3& n, const Vec3& local) const {
+        Vec3 w = glm::normalize(n);
+        Vec3 a = (fabs(w.x) > 0.9f) ? Vec3{0, 1, 0} : Vec3{1, 0, 0};
+        Vec3 v = glm::normalize(glm::cross(w, a));
+        Vec3 u = glm::cross(v, w);
+        return local.x * u + local.y * v + local.z * w;
+    }
+
+    void InstantRadiosityRenderer::renderTask(RGBA* pixels, int width, int height, int off, int step) {
+        thread_local static std::mt19937 rng{std::random_device{}()};
+        thread_local static std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        for(int i=off; i<height; i+=step) {
+            for (int j=0; j<width; j++) {
+                Vec3 color{0, 0, 0};
+                for (unsigned int k=0; k<samples; k++) {
+                    float rx = dist(rng);
+                    float ry = dist(rng);
+                    float x = (float(j)+rx)/float(width);
+                    float y = (float(i)+ry)/float(height);
+                    auto ray = camera.shoot(x, y);
+                    color += trace(ray, 0, k);
+                }
+                color /= float(samples);
+                pixels[(height-i-1)*width+j] = {color, 1};
+            }
+        }
+    }
+
+    uint64_t InstantRadiosityRenderer::sceneKey() const {
+        // 只统计影响 VPL 分布的内容, 相机/分辨率/采样数的变化不会让缓存失效
+        Hasher hs;
+        hs.u(depth);
+        hs.u(pathsPerLight);
+        for (auto& m : scene.materials) {
+            hs.u(m.type);
+            for (auto& p : m.properties) {
+                hs.bytes(p.key.data(), p.key.size());
+                hs.u(uint64_t(p.type));
+                std::visit([&hs](const auto& w) { hs.bytes(&w.value, sizeof(w.value)); }, p.valueWrapper);
+            }
+        }
+        for (auto& s : scene.sphereBuffer) {
+            hs.v3(s.position); hs.f(s.radius); hs.u(s.material.getValue());
+        }
+        for (auto& t : scene.triangleBuffer) {
+            hs.v3(t.v1); hs.v3(t.v2); hs.v3(t.v3); hs.v3(t.normal); hs.u(t.material.getValue());
+        }
+        for (auto& p : scene.planeBuffer) {
+            hs.v3(p.position); hs.v3(p.normal); hs.v3(p.u); hs.v3(p.v); hs.u(p.material.getValue());
+        }
+        for (auto& m : scene.meshBuffer) {
+            hs.u(m.positions.size());
+            if (!m.positions.empty()) hs.bytes(m.positions.data(), m.positions.size()*sizeof(Vec3));
+            hs.u(m.positionIndices.size());
+            if (!m.positionIndices.empty()) hs.bytes(m.positionIndices.data(), m.positionIndices.size()*sizeof(Index));
+            hs.u(m.material.getValue());
+        }
+        for (auto& a : scene.areaLightBuffer) {
+            hs.v3(a.position); hs.v3(a.u); hs.v3(a.v); hs.v3(a.radiance);
+        }
+        return hs.h;
+    }
+
+    auto InstantRadiosityRenderer::render() -> RenderResult {
+        VertexTransformer vertexTransformer{};
+        vertexTransformer.exec(spScene);
+
+        accel = std::make_unique<KDTree>();
+        accel->setLazy(scene.renderOption.lazyBuild);
+        accel->buildFromScene(scene);
+
+        auto& c = cache();
+        std::lock_guard<mutex> lock{c.mtx};
+        auto key = sceneKey();
+        if (!c.valid || c.sceneKey != key) {
+            c.vpls.clear();
+            buildVPLs(c.vpls);
+            Vec3 mn{FLOAT_INF}, mx{-FLOAT_INF};
+            for (auto& v : c.vpls) {
+                mn = glm::min(mn, v.position);
+                mx = glm::max(mx, v.position);
+            }
+            float diag = c.vpls.empty() ? 0.f : glm::length(mx - mn);
+            c.clampDistance2 = (vplClampRatio*diag) * (vplClampRatio*diag);
+            c.sceneKey = key;
+            c.valid = true;
+            getServer().logger.log("Generated " + to_string(c.vpls.size()) + " VPLs.");
+        }
+        else {
+            getServer().logger.log("Scene unchanged, reusing " + to_string(c.vpls.size()) + " cached VPLs.");
+        }
+        vpls = &c.vpls;
+        clampDistance2 = c.clampDistance2;
+
+        RGBA* pixels = new RGBA[width*height]{};
+
+        const int taskNums = 8;
+        std::thread t[taskNums];
+        for (int i=0; i < taskNums; i++) {
+            t[i] = std::thread(&InstantRadiosityRenderer::renderTask, this, pixels, width, height, i, taskNums);
+        }
+        for (int i=0; i < taskNums; i++) {
+            t[i].join();
+        }
+        return {pixels, width, height};
+    }
+
+    void InstantRadiosityRenderer::buildVPLs(vector<VPL>& out) {
+        // 与光子映射相同的光源路径: 面光源余弦发射, 漫反射面处沉积 VPL 并俄罗斯轮盘继续
+        std::mt19937 rng{std::random_device{ }()};
+        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        for (auto& a : scene.areaLightBuffer) {
+            Vec3 nL = glm::normalize(glm::cross(a.u, a.v));
+            float area = glm::length(glm::cross(a.u, a.v));
+            for (int i=0; i<pathsPerLight; i++) {
+                float us = dist(rng);
+                float vs = dist(rng);
+                Vec3 pos = a.position + us*a.u + vs*a.v;
+                Vec3 dir = glm::normalize(toWorld(nL, sampleHemisphereCosine()));
+                Vec3 power = a.radiance * area * PI / float(pathsPerLight);
+                Ray ray{pos + 0.0001f*nL, dir};
+                for (int b=0; b<int(depth); b++) {
+                    auto hit = closestHitObject(ray);
+                    if (!hit) break;
+                    auto& mtl = scene.materials[hit->material.index()];
+                    using PW = Property::Wrapper;
+                    Vec3 origin = hit->hitPoint + 0.0001f * hit->normal;
+                    auto diffuseColor = mtl.getProperty<PW::RGBType>("diffuseColor");
+                    auto reflectColor = mtl.getProperty<PW::RGBType>("reflect");
+                    auto roughnessVal = mtl.getProperty<PW::FloatType>("roughness");
+                    if (diffuseColor) {
+                        Vec3 albedo = (*diffuseColor).value;
+                        out.push_back({origin, glm::normalize(hit->normal), power * albedo / PI});
+                        float p = glm::clamp(glm::max(albedo.x, glm::max(albedo.y, albedo.z)), 0.1f, 0.9f);
+                        if (dist(rng) > p) break;
+                        power *= albedo / p;
+                        Vec3 d = toWorld(hit->normal, sampleHemisphereCosine());
+                        ray = Ray{origin, glm::normalize(d)};
+                    } else if (reflectColor) {
+                        Vec3 reflect = (*reflectColor).value;
+                        float rough = roughnessVal ? (*roughnessVal).value : 0.0f;
+                        float p = glm::clamp(glm::max(reflect.x, glm::max(reflect.y, reflect.z)), 0.1f, 0.9f);
+                        if (dist(rng) > p) break;
+                        power *= reflect / p;
+                        Vec3 rdir = glm::reflect(glm::normalize(ray.direction), glm::normalize(hit->normal));
+                        if (rough > 0.0f) {
+                            Vec3 jitter = toWorld(rdir, sampleHemisphereCosine());
+                            rdir = glm::normalize(rdir + rough * jitter);
+                        }
+                        ray = Ray{origin, rdir};
+                    } else {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+
+    HitRecord InstantRadiosityRenderer::closestHitObject(const Ray& r) {
+        HitRecord closestHit = nullopt;
+        float closest = FLOAT_INF;
+        for (auto& s : scene.sphereBuffer) {
+            auto hitRecord = Intersection::xSphere(r, s, 0.000001f, closest);
+            if (hitRecord && hitRecord->t < closest) { closest = hitRecord->t; closestHit = hitRecord; }
+        }
+        if (accel) {
+            auto hitRecord = accel->closestHit(r, 0.000001f, closest);
+            if (hitRecord && hitRecord->t < closest) { closest = hitRecord->t; closestHit = hitRecord; }
+        }
+        for (auto& p : scene.planeBuffer) {
+            auto hitRecord = Intersection::xPlane(r, p, 0.000001f, closest);
+            if (hitRecord && hitRecord->t < closest) { closest = hitRecord->t; closestHit = hitRecord; }
+        }
+        return closestHit;
+    }
+
+    bool InstantRadiosityRenderer::occluded(const Ray& r, float tMax) {
+        for (auto& s : scene.sphereBuffer) {
+            if (Intersection::xSphere(r, s, 0.000001f, tMax)) return true;
+        }
+        for (auto& p : scene.planeBuffer) {
+            if (Intersection::xPlane(r, p, 0.000001f, tMax)) return true;
+        }
+        return accel && accel->occluded(r, 0.000001f, tMax);
+    }
+
+    tuple<float, Vec3> InstantRadiosityRenderer::closestHitLight(const Ray& r) {
+        Vec3 v = {};
+        HitRecord closest = getHitRecord(FLOAT_INF, {}, {}, {});
+        for (auto& a : scene.areaLightBuffer) {
+            auto hitRecord = Intersection::xAreaLight(r, a, 0.000001f, closest->t);
+            if (hitRecord && hitRecord->t < closest->t) {
+                closest = hitRecord;
+                v = a.radiance;
+            }
+        }
+        return { closest->t, v };
+    }
+
+    RGB InstantRadiosityRenderer::trace(const Ray& r, int currDepth, unsigned int sampleIdx) {
+        if (currDepth >= int(depth)) return Vec3{0};
+        auto hitObject = closestHitObject(r);
+        auto [tLight, emitted] = closestHitLight(r);
+        if (hitObject && hitObject->t < tLight) {
+            auto& mtl = scene.materials[hitObject->material.index()];
+            using PW = Property::Wrapper;
+            auto diffuseColor = mtl.getProperty<PW::RGBType>("diffuseColor");
+            auto reflectColor = mtl.getProperty<PW::RGBType>("reflect");
+            auto roughnessVal = mtl.getProperty<PW::FloatType>("roughness");
+
+            Vec3 origin = hitObject->hitPoint + 0.0001f * hitObject->normal;
+
+            if (reflectColor) {
+                Vec3 reflect = (*reflectColor).value;
+                Vec3 rdir = glm::reflect(glm::normalize(r.direction), glm::normalize(hitObject->normal));
+                float rough = roughnessVal ? (*roughnessVal).value : 0.0f;
+                if (rough > 0.0f) {
+                    Vec3 jitter = toWorld(rdir, sampleHemisphereCosine());
+                    rdir = glm::normalize(rdir + rough * jitter);
+                }
+                return reflect * trace(Ray{origin, rdir}, currDepth+1, sampleIdx);
+            }
+
+            Vec3 albedo = diffuseColor ? (*diffuseColor).value : Vec3{1,1,1};
+
+            Vec3 direct{0, 0, 0};
+            if (diffuseColor && !scene.areaLightBuffer.empty()) {
+                int lightSamples = 8;
+                for (auto& a : scene.areaLightBuffer) {
+                    Vec3 nL = glm::normalize(glm::cross(a.u, a.v));
+                    float area = glm::length(glm::cross(a.u, a.v));
+                    Vec3 sum{0, 0, 0};
+                    for (int s=0; s<lightSamples; s++) {
+                        float us = (s + 0.5f) / float(lightSamples);
+                        float vs = ((s*73) % lightSamples + 0.5f) / float(lightSamples);
+                        Vec3 y = a.position + us*a.u + vs*a.v;
+                        Vec3 out = glm::normalize(y - origin);
+                        float d = glm::length(y - origin);
+                        if (glm::dot(out, hitObject->normal) <= 0) continue;
+                        if (glm::dot(nL, -out) <= 0) continue;
+                        if (occluded(Ray{origin, out}, d - 0.001f)) continue;
+                        float G = glm::max(0.0f, glm::dot(hitObject->normal, out)) * glm::max(0.0f, glm::dot(nL, -out)) / (d*d);
+                        sum += (albedo / PI) * a.radiance * G;
+                    }
+                    direct += sum * (area / float(lightSamples));
+                }
+            }
+
+            // 交错采样: 第 k 个样本只计算下标 = k (mod samples) 的 VPL, 每个像素的全部样本恰好覆盖所有 VPL
+            Vec3 indirect{0, 0, 0};
+            if (vpls && !vpls->empty()) {
+                const Vec3& n = hitObject->normal;
+                for (size_t i = sampleIdx % samples; i < vpls->size(); i += samples) {
+                    auto& vpl = (*vpls)[i];
+                    Vec3 d = vpl.position - origin;
+                    float d2 = glm::dot(d, d);
+                    if (d2 <= 0.0f) continue;
+                    float dist = sqrt(d2);
+                    Vec3 out = d / dist;
+                    float cosX = glm::dot(n, out);
+                    if (cosX <= 0.0f) continue;
+                    float cosY = glm::dot(vpl.normal, -out);
+                    if (cosY <= 0.0f) continue;
+                    if (occluded(Ray{origin, out}, dist - 0.001f)) continue;
+                    indirect += vpl.power * (cosX * cosY / glm::max(d2, clampDistance2));
+                }
+                indirect *= (albedo / PI) * float(samples);
+            }
+            return direct + indirect;
+        } else if (tLight != FLOAT_INF) {
+            return emitted;
+        } else {
+            return Vec3{0};
+        }
+    }
+}
@@ -6,6 +6,7 @@
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <atomic>
 
 #include "scene/Scene.hpp"
 #include "Ray.hpp"
@@ -21,6 +22,8 @@ namespace RayCast
     public:
         KDTree() = default;
         void setLeafSize(int s);
+        // 按需构建: 只建根节点, 内部节点在第一次被光线访问时才划分
+        void setLazy(bool l);
         void buildFromScene(const Scene& scene);
         HitRecord closestHit(const Ray& ray, float tMin, float tMax) const;
 
@@ -39,12 +42,16 @@ namespace RayCast
             std::unique_ptr<Node> left;
             std::unique_ptr<Node> right;
             std::vector<int> indices;
+            // 按需构建时未划分的节点为 UNBUILT, indices 暂存它的全部三角形
+            mutable std::atomic<int> state{BUILT};
             bool isLeaf() const { return !left && !right; }
         };
+        enum NodeState : int { UNBUILT, BUILDING, BUILT };
 
         std::unique_ptr<Node> root;
         std::vector<Tri> tris;
         int leafSize = 8;
+        bool lazy = false;
 
         static AABB triBox(const Tri& t);
         static AABB merge(const AABB& a, const AABB& b);
@@ -52,6 +59,9 @@ namespace RayCast
         static bool hitAABBWithT(const Ray& r, const AABB& box, float tMin, float tMax, float& tNear);
         static Vec3 centroid(const Tri& t);
         std::unique_ptr<Node> build(const std::vector<int>& idx);
+        void split(Node& node);
+        // 由第一个访问到节点的线程划分, 其余线程等待划分完成
+        void expand(const Node* node) const;
         HitRecord traverse(const Node* node, const Ray& r, float tMin, float tMax) const;
     };
 }
@@ -0,0 +1,79 @@
+#pragma once
+#ifndef __LIGHT_TREE_HPP__
+#define __LIGHT_TREE_HPP__
+
+#include "scene/Scene.hpp"
+#include "Ray.hpp"
+
+#include <vector>
+
+namespace RayCast
+{
+    using namespace NRenderer;
+    using namespace std;
+
+    // 光源层次结构: 面光源、点光源与聚光灯按包围盒、发光方向锥与功率组织成二叉树
+    //  - 着色点从根出发, 按两个孩子估计的贡献随机走到一个叶子, 选中概率一并返回
+    //  - 面光源的最近交点也在这棵树上求, 不再逐个测试
+    // 聚光灯的 hotSpot / fallout 按与轴线的夹角处理, 两者之间平滑衰减
+    class LightTree
+    {
+    public:
+        enum class Kind { AREA, POINT, SPOT };
+        struct Selection {
+            Kind kind;
+            size_t index;
+            float pmf;
+        };
+
+        void build(const Scene& scene);
+        size_t size() const { return lightCount; }
+        size_t nodeCount() const { return nodes.size(); }
+        // n 为单位法线, 传 0 表示不考虑朝向; u 为 [0, 1) 上的随机数; 没有光源能照到着色点时返回 false
+        bool sample(const Vec3& p, const Vec3& n, float u, Selection& out) const;
+        // 一次选 count 个光源, u 须升序 (如分层采样), 会被改写; 失败的样本 pmf 为 0
+        void sample(const Vec3& p, const Vec3& n, float* u, int count, Selection* out) const;
+        // 返回最近的面光源下标与距离, 没有命中时返回 -1
+        int closestAreaLight(const Ray& r, float tMin, float tMax, float& t) const;
+        // 聚光灯在单位方向 w 上的强度比例
+        static float spotFalloff(const SpotLight& s, const Vec3& w);
+
+    private:
+        // 一组光源的界: 包围盒, 覆盖所有法线的方向锥 (半角 thetaO),
+        // 每个法线方向上还能照到的角度 thetaE, 以及总功率
+        struct Bounds {
+            Vec3 min{FLOAT_INF, FLOAT_INF, FLOAT_INF};
+            Vec3 max{-FLOAT_INF, -FLOAT_INF, -FLOAT_INF};
+            Vec3 axis{0, 0, 1};
+            float cosThetaO = 1;
+            float cosThetaE = 1;
+            float power = 0;
+        };
+        struct Node {
+            Bounds bounds;
+            // 按先序存储, 左孩子紧跟在父节点之后; 叶子的 right 为 -1
+            int right = -1;
+            Kind kind = Kind::AREA;
+            size_t index = 0;
+            bool isLeaf() const { return right < 0; }
+        };
+        struct Ref {
+            Bounds bounds;
+            Kind kind;
+            size_t index;
+        };
+
+        vector<Node> nodes;
+        size_t lightCount = 0;
+        const Scene* scene = nullptr;
+
+        static Bounds unite(const Bounds& a, const Bounds& b);
+        // 方向锥的度量, 用于 SAOH: 锥越宽、照射范围越大代价越高
+        static float orientationMeasure(const Bounds& b);
+        // 从上界估计 b 内的光源对 p 点 (单位法线 n) 的贡献; 返回 0 时保证确实没有贡献
+        static float importance(const Bounds& b, const Vec3& p, const Vec3& n);
+        int buildRecursive(vector<Ref>& refs, int start, int end, int depth);
+    };
+}
+
+#endif
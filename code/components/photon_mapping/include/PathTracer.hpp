@@ -3,12 +3,14 @@
 #define __PATH_TRACER_HPP__
 
 #include "scene/Scene.hpp"
+#include "server/FrameBuffer.hpp"
 #include "Ray.hpp"
 #include "Camera.hpp"
 #include "intersections/intersections.hpp"
 #include "VertexTransformer.hpp"
 #include "KDTree.hpp"
 #include "PhotonMap.hpp"
+#include "LightTree.hpp"
 
 #include <tuple>
 
@@ -30,11 +32,25 @@ namespace RayCast
 
         Camera camera;
         unique_ptr<KDTree> accel;
-        unique_ptr<PhotonMap> photonMap;
+        LightTree lights;
+        // 全局光子图: 只保存至少经过一次漫反射后的光子, 用于平滑的间接光
+        unique_ptr<PhotonMap> globalMap;
+        // 焦散光子图: 保存 L S+ D 路径上第一次落在漫反射面的光子
+        unique_ptr<PhotonMap> causticMap;
         int photonsPerLight;
+        int causticPhotonsPerLight;
         int gatherK;
+        int causticGatherK;
         int photonMaxDepth;
         float minGatherRadius2;
+        bool photonDiagnostics;
+
+        // 焦散光子定向发射的目标: 带 reflect 属性物体的包围球
+        struct SpecularTarget {
+            Vec3 center;
+            float radius;
+        };
+        vector<SpecularTarget> specularTargets;
     public:
         PathTracerRenderer(SharedScene spScene)
             : spScene               (spScene)
@@ -46,31 +62,50 @@ namespace RayCast
             depth = scene.renderOption.depth;
             samples = scene.renderOption.samplesPerPixel;
             photonsPerLight = scene.renderOption.photonsPerLight;
-            if (photonsPerLight < 10000) photonsPerLight = 10000;
+            if (photonsPerLight < 1000) photonsPerLight = 1000;
             if (photonsPerLight > 100000) photonsPerLight = 100000;
             int g = photonsPerLight / 100;
             if (g < 50) g = 50;
             if (g > 300) g = 300;
             gatherK = g;
+            causticPhotonsPerLight = scene.renderOption.causticPhotonsPerLight;
+            if (causticPhotonsPerLight > 200000) causticPhotonsPerLight = 200000;
+            int cg = causticPhotonsPerLight / 500;
+            if (cg < 20) cg = 20;
+            if (cg > 100) cg = 100;
+            causticGatherK = cg;
             photonMaxDepth = 6;
             minGatherRadius2 = 1e-6f;
+            photonDiagnostics = scene.renderOption.photonDiagnostics;
         }
         ~PathTracerRenderer() = default;
 
-        using RenderResult = tuple<RGBA*, unsigned int, unsigned int>;
-        RenderResult render();
-        void release(const RenderResult& r);
+        // 输出线性 HDR 颜色; 开启 photonDiagnostics 时另外输出 "photonDensity" 通道
+        void render(FrameBuffer& frame);
 
     private:
-        void renderTask(RGBA* pixels, int width, int height, int off, int step);
-        RGB gamma(const RGB& rgb);
+        void renderTask(RGB* color, int width, int height, int off, int step);
         RGB trace(const Ray& ray, int currDepth);
         HitRecord closestHitObject(const Ray& r);
         tuple<float, Vec3> closestHitLight(const Ray& r);
+        // 由光源树选光源的直接光照估计, 返回 sum(Li * cos) / pmf 的平均, 不含 BRDF
+        Vec3 sampleDirect(const Vec3& origin, const Vec3& normal);
         Vec3 sampleHemisphereUniform() const;
         Vec3 sampleHemisphereCosine() const;
         Vec3 toWorld(const Vec3& n, const Vec3& local) const;
         void buildPhotonMap();
+        // 光子密度 AOV: 统计投影到每个像素的光子数
+        void writePhotonDensity(float* density);
+        void buildGlobalPhotonMap();
+        void buildCausticPhotonMap();
+        void collectSpecularTargets();
+        // 材质的统一分类, 全局光子、焦散光子与相机路径都按它决定在表面上的行为:
+        // 有 reflect 属性时按镜面处理 (即使同时有 diffuseColor), 否则有 diffuseColor 时按漫反射处理
+        enum class SurfaceType { SPECULAR, DIFFUSE, ABSORB };
+        SurfaceType classify(Handle material) const;
+        bool isSpecular(Handle material) const;
+        Vec3 sampleCone(const Vec3& axis, float cosMax) const;
+        Vec3 estimateRadiance(const PhotonMap& map, const Vec3& x, const Vec3& albedo, int k) const;
     };
 }
 
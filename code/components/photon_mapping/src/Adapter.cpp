@@ -13,10 +13,9 @@ namespace RayCast
     public:
         void render(SharedScene spScene) {
             PathTracerRenderer renderer{spScene};
-            auto result = renderer.render();
-            auto [ pixels, width, height ] = result;
-            getServer().screen.set(pixels, width, height);
-            renderer.release(result);
+            FrameBuffer frame{};
+            renderer.render(frame);
+            getServer().screen.set(frame);
         }
     };
 }
@@ -28,7 +27,8 @@ const static string description =
     " - Area Light emission\n"
     " - Triangle, Sphere, Plane\n"
     " - KDTree geometry acceleration\n"
-    " - k-NN radiance estimate for indirect\n\n"
+    " - k-NN radiance estimate for indirect\n"
+    " - Separate caustic photon map aimed at reflective objects\n\n"
     "Use cornel_area_light.scn" 
     ;
 
@@ -1,9 +1,12 @@
 // cpp d:\study\computer_graph\nrenderer-master\code\components\ray_tracing_KDTree\src\KDTree.cpp
 #include "KDTree.hpp"
 
+#include <thread>
+
 namespace RayCast
 {
     void KDTree::setLeafSize(int s) { leafSize = std::max(1, s); }
+    void KDTree::setLazy(bool l) { lazy = l; }
     KDTree::AABB KDTree::triBox(const Tri& t) {
         Vec3 mn{
             std::min({t.v1.x, t.v2.x, t.v3.x}),
@@ -61,11 +64,21 @@ namespace RayCast
         AABB box = triBox(tris[idx[0]]);
         for (size_t i=1;i<idx.size();i++) box = merge(box, triBox(tris[idx[i]]));
         node->box = box;
+        node->indices = idx;
         if ((int)idx.size() <= leafSize) {
-            node->indices = idx;
             return std::move(node);
         }
-        Vec3 mn = box.min, mx = box.max;
+        if (lazy) {
+            node->state.store(UNBUILT, std::memory_order_relaxed);
+            return std::move(node);
+        }
+        split(*node);
+        return std::move(node);
+    }
+
+    void KDTree::split(Node& node) {
+        const auto& idx = node.indices;
+        Vec3 mn = node.box.min, mx = node.box.max;
         Vec3 extent = mx - mn;
         int axis = 0;
         if (extent.y > extent.x && extent.y >= extent.z) axis = 1;
@@ -90,13 +103,23 @@ namespace RayCast
             if (v <= median) leftIdx.push_back(i);
             else rightIdx.push_back(i);
         }
-        if (leftIdx.empty() || rightIdx.empty()) {
-            node->indices = idx;
-            return std::move(node);
+        // 无法划分时保持为叶子
+        if (leftIdx.empty() || rightIdx.empty()) return;
+        node.left = build(leftIdx);
+        node.right = build(rightIdx);
+        std::vector<int>().swap(node.indices);
+    }
+
+    void KDTree::expand(const Node* node) const {
+        int expected = UNBUILT;
+        if (node->state.compare_exchange_strong(expected, BUILDING, std::memory_order_acquire)) {
+            // 按需构建发生在求交过程中, 节点本身归 KDTree 所有, 不是 const 对象
+            const_cast<KDTree*>(this)->split(*const_cast<Node*>(node));
+            node->state.store(BUILT, std::memory_order_release);
+        }
+        else {
+            while (node->state.load(std::memory_order_acquire) != BUILT) std::this_thread::yield();
         }
-        node->left = build(leftIdx);
-        node->right = build(rightIdx);
-        return std::move(node);
     }
 
     void KDTree::buildFromScene(const Scene& scene) {
@@ -137,6 +160,7 @@ namespace RayCast
     HitRecord KDTree::traverse(const Node* node, const Ray& r, float tMin, float tMax) const {
         if (!node) return getMissRecord();
         if (!hitAABB(r, node->box, tMin, tMax)) return getMissRecord();
+        if (lazy && node->state.load(std::memory_order_acquire) != BUILT) expand(node);
         HitRecord best = getMissRecord();
         float closest = tMax;
         if (node->isLeaf()) {
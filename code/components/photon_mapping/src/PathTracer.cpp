@@ -1,22 +1,13 @@
 #include "PathTracer.hpp"
+#include "server/Server.hpp"
 
 #include <thread>
 #include <random>
-#include <fstream>
 #include <algorithm>
 #include "glm/gtc/matrix_transform.hpp"
 
 namespace RayCast
 {
-    RGB PathTracerRenderer::gamma(const RGB& rgb) {
-        return glm::sqrt(rgb);
-    }
-
-    void PathTracerRenderer::release(const RenderResult& r) {
-        auto [p, w, h] = r;
-        delete[] p;
-    }
-
     Vec3 PathTracerRenderer::sampleHemisphereUniform() const {
         thread_local static std::mt19937 rng{std::random_device{ }()};
         thread_local static std::uniform_real_distribution<float> dist(0.0f, 1.0f);
@@ -46,116 +37,65 @@ namespace RayCast
         return local.x * u + local.y * v + local.z * w;
     }
 
-    void PathTracerRenderer::renderTask(RGBA* pixels, int width, int height, int off, int step) {
+    void PathTracerRenderer::renderTask(RGB* color, int width, int height, int off, int step) {
         thread_local static std::mt19937 rng{std::random_device{}()};
         thread_local static std::uniform_real_distribution<float> dist(0.0f, 1.0f);
         for(int i=off; i<height; i+=step) {
             for (int j=0; j<width; j++) {
-                Vec3 color{0, 0, 0};
+                Vec3 sum{0, 0, 0};
                 for (int k=0; k<samples; k++) {
                     float rx = dist(rng);
                     float ry = dist(rng);
                     float x = (float(j)+rx)/float(width);
                     float y = (float(i)+ry)/float(height);
                     auto ray = camera.shoot(x, y);
-                    color += trace(ray, 0);
+                    sum += trace(ray, 0);
                 }
-                color /= float(samples);
-                color = gamma(color);
-                pixels[(height-i-1)*width+j] = {color, 1};
+                color[(height-i-1)*width+j] = sum / float(samples);
             }
         }
     }
 
-    auto PathTracerRenderer::render() -> RenderResult {
+    void PathTracerRenderer::render(FrameBuffer& frame) {
         VertexTransformer vertexTransformer{};
         vertexTransformer.exec(spScene);
 
         accel = std::make_unique<KDTree>();
+        accel->setLazy(scene.renderOption.lazyBuild);
         accel->buildFromScene(scene);
+        lights.build(scene);
+        getServer().logger.log("Light tree: " + to_string(lights.size()) + " lights, " + to_string(lights.nodeCount()) + " nodes.");
 
         buildPhotonMap();
 
-        RGBA* pixels = new RGBA[width*height]{};
+        frame.resize(width, height);
+        RGB* color = frame.float3(FrameBuffer::COLOR);
 
         const int taskNums = 8;
         std::thread t[taskNums];
         for (int i=0; i < taskNums; i++) {
-            t[i] = std::thread(&PathTracerRenderer::renderTask, this, pixels, width, height, i, taskNums);
+            t[i] = std::thread(&PathTracerRenderer::renderTask, this, color, width, height, i, taskNums);
         }
         for (int i=0; i < taskNums; i++) {
             t[i].join();
         }
-        if (photonMap) {
-            const auto& pts = photonMap->getPhotons();
-            for (const auto& ph : pts) {
-                float sx, sy;
-                if (camera.project(ph.position, sx, sy)) {
-                    int xi = std::min(std::max(int(sx * width), 0), int(width) - 1);
-                    int yi = std::min(std::max(int(sy * height), 0), int(height) - 1);
-                    for (int oy=-1; oy<=1; ++oy) {
-                        for (int ox=-1; ox<=1; ++ox) {
-                            int X = xi + ox, Y = yi + oy;
-                            if (X < 0 || X >= int(width) || Y < 0 || Y >= int(height)) continue;
-                            auto& px = pixels[(height - Y - 1) * width + X];
-                            px.x = glm::min(1.0f, px.x + 0.6f);
-                            px.y = glm::min(1.0f, px.y + 0.6f);
-                            px.z = glm::min(1.0f, px.z + 0.0f);
-                            px.w = 1.0f;
-                        }
-                    }
-                }
-            }
+        if (photonDiagnostics) {
+            writePhotonDensity(frame.float1("photonDensity"));
         }
-        if (photonMap) {
-            const auto& pts = photonMap->getPhotons();
-            for (const auto& ph : pts) {
+    }
+
+    void PathTracerRenderer::writePhotonDensity(float* density) {
+        auto splat = [&](const PhotonMap& map) {
+            for (const auto& ph : map.getPhotons()) {
                 float sx, sy;
-                if (camera.project(ph.position, sx, sy)) {
-                    int xi = std::min(std::max(int(sx * width), 0), int(width) - 1);
-                    int yi = std::min(std::max(int(sy * height), 0), int(height) - 1);
-                    for (int oy=-1; oy<=1; ++oy) {
-                        for (int ox=-1; ox<=1; ++ox) {
-                            int X = xi + ox, Y = yi + oy;
-                            if (X < 0 || X >= int(width) || Y < 0 || Y >= int(height)) continue;
-                            auto& px = pixels[(height - Y - 1) * width + X];
-                            px.x = glm::min(1.0f, px.x + 0.6f);
-                            px.y = glm::min(1.0f, px.y + 0.6f);
-                            px.z = glm::min(1.0f, px.z + 0.0f);
-                            px.w = 1.0f;
-                        }
-                    }
-                }
+                if (!camera.project(ph.position, sx, sy)) continue;
+                int xi = std::min(std::max(int(sx * width), 0), int(width) - 1);
+                int yi = std::min(std::max(int(sy * height), 0), int(height) - 1);
+                density[(height - yi - 1) * width + xi] += 1.0f;
             }
-        }
-        Vec3 imageEnergyLinear{0, 0, 0};
-        for (int i=0; i<height; ++i) {
-            for (int j=0; j<width; ++j) {
-                auto& p = pixels[(height-i-1)*width + j];
-                imageEnergyLinear += Vec3{p.x*p.x, p.y*p.y, p.z*p.z};
-            }
-        }
-        {
-            std::ofstream ofs("photon_map.ppm", std::ios::binary);
-            if (ofs.good()) {
-                ofs << "P6\n" << width << " " << height << "\n255\n";
-                for (unsigned int i=0; i<height; ++i) {
-                    for (unsigned int j=0; j<width; ++j) {
-                        auto& p = pixels[i*width + j];
-                        unsigned char r = (unsigned char)(glm::clamp(p.x, 0.0f, 1.0f) * 255.0f);
-                        unsigned char g = (unsigned char)(glm::clamp(p.y, 0.0f, 1.0f) * 255.0f);
-                        unsigned char b = (unsigned char)(glm::clamp(p.z, 0.0f, 1.0f) * 255.0f);
-                        ofs.write((char*)&r, 1);
-                        ofs.write((char*)&g, 1);
-                        ofs.write((char*)&b, 1);
-                    }
-                }
-                ofs.close();
-                std::cout << "[PhotonMap] Saved image to photon_map.ppm" << std::endl;
-            }
-        }
-        std::cout << "[PhotonMap] ImageEnergy(linear_est) " << imageEnergyLinear << std::endl;
-        return {pixels, width, height};
+        };
+        if (globalMap) splat(*globalMap);
+        if (causticMap) splat(*causticMap);
     }
 
     HitRecord PathTracerRenderer::closestHitObject(const Ray& r) {
@@ -178,24 +118,159 @@ namespace RayCast
     }
 
     tuple<float, Vec3> PathTracerRenderer::closestHitLight(const Ray& r) {
-        Vec3 v = {};
-        HitRecord closest = getHitRecord(FLOAT_INF, {}, {}, {});
-        for (auto& a : scene.areaLightBuffer) {
-            auto hitRecord = Intersection::xAreaLight(r, a, 0.000001f, closest->t);
-            if (hitRecord && hitRecord->t < closest->t) {
-                closest = hitRecord;
-                v = a.radiance;
+        float t;
+        int idx = lights.closestAreaLight(r, 0.000001f, FLOAT_INF, t);
+        if (idx < 0) return { FLOAT_INF, {} };
+        return { t, scene.areaLightBuffer[idx].radiance };
+    }
+
+    Vec3 PathTracerRenderer::sampleDirect(const Vec3& origin, const Vec3& normal) {
+        thread_local static std::mt19937 rng{std::random_device{ }()};
+        thread_local static std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        // 每个样本只对光源树选出的一个光源连一条阴影光线, 代价与光源数量无关
+        const int lightSamples = 8;
+        float u[lightSamples];
+        for (int s=0; s<lightSamples; s++) u[s] = (s + dist(rng)) / float(lightSamples);
+        LightTree::Selection selected[lightSamples];
+        lights.sample(origin, normal, u, lightSamples, selected);
+        Vec3 sum{0, 0, 0};
+        for (int s=0; s<lightSamples; s++) {
+            auto& sel = selected[s];
+            if (sel.pmf <= 0) continue;
+            Vec3 y;
+            Vec3 Li;
+            float cosL = 1.f;
+            float area = 1.f;
+            if (sel.kind == LightTree::Kind::AREA) {
+                auto& a = scene.areaLightBuffer[sel.index];
+                y = a.position + dist(rng)*a.u + dist(rng)*a.v;
+                Vec3 nL = glm::normalize(glm::cross(a.u, a.v));
+                cosL = glm::dot(nL, glm::normalize(origin - y));
+                area = glm::length(glm::cross(a.u, a.v));
+                Li = a.radiance;
+            }
+            else if (sel.kind == LightTree::Kind::POINT) {
+                auto& l = scene.pointLightBuffer[sel.index];
+                y = l.position;
+                Li = l.intensity;
+            }
+            else {
+                auto& l = scene.spotLightBuffer[sel.index];
+                y = l.position;
+                Li = l.intensity * LightTree::spotFalloff(l, glm::normalize(origin - y));
             }
+            Vec3 out = glm::normalize(y - origin);
+            float d = glm::length(y - origin);
+            float cosS = glm::dot(out, normal);
+            if (cosS <= 0 || cosL <= 0) continue;
+            auto shadowHit = closestHitObject(Ray{origin, out});
+            if (shadowHit && shadowHit->t <= d - 0.001f) continue;
+            sum += Li * (cosS * cosL * area / (d*d * sel.pmf));
+        }
+        return sum / float(lightSamples);
+    }
+
+    Vec3 PathTracerRenderer::sampleCone(const Vec3& axis, float cosMax) const {
+        thread_local static std::mt19937 rng{std::random_device{ }()};
+        thread_local static std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        float cosTheta = 1.0f - dist(rng) * (1.0f - cosMax);
+        float sinTheta = sqrt(glm::max(0.0f, 1.0f - cosTheta*cosTheta));
+        float phi = 6.283185307179586f * dist(rng);
+        return toWorld(axis, {sinTheta * cos(phi), sinTheta * sin(phi), cosTheta});
+    }
+
+    auto PathTracerRenderer::classify(Handle material) const -> SurfaceType {
+        if (!material.valid()) return SurfaceType::ABSORB;
+        auto& mtl = scene.materials[material.index()];
+        if (mtl.hasProperty("reflect")) return SurfaceType::SPECULAR;
+        if (mtl.hasProperty("diffuseColor")) return SurfaceType::DIFFUSE;
+        return SurfaceType::ABSORB;
+    }
+
+    bool PathTracerRenderer::isSpecular(Handle material) const {
+        return classify(material) == SurfaceType::SPECULAR;
+    }
+
+    void PathTracerRenderer::collectSpecularTargets() {
+        specularTargets.clear();
+        auto addBox = [this](const Vec3& mn, const Vec3& mx) {
+            Vec3 c = (mn + mx) * 0.5f;
+            specularTargets.push_back({c, glm::length(mx - c) + 0.0001f});
+        };
+        for (auto& s : scene.sphereBuffer) {
+            if (isSpecular(s.material)) specularTargets.push_back({s.position, s.radius + 0.0001f});
+        }
+        for (auto& t : scene.triangleBuffer) {
+            if (isSpecular(t.material)) addBox(glm::min(t.v1, glm::min(t.v2, t.v3)), glm::max(t.v1, glm::max(t.v2, t.v3)));
+        }
+        for (auto& p : scene.planeBuffer) {
+            if (!isSpecular(p.material)) continue;
+            Vec3 c = p.position + 0.5f*(p.u + p.v);
+            float r = 0.5f * glm::max(glm::length(p.u + p.v), glm::length(p.u - p.v));
+            specularTargets.push_back({c, r + 0.0001f});
+        }
+        for (auto& m : scene.meshBuffer) {
+            if (!isSpecular(m.material) || m.positions.empty()) continue;
+            Vec3 mn = m.positions[0], mx = m.positions[0];
+            for (auto& v : m.positions) { mn = glm::min(mn, v); mx = glm::max(mx, v); }
+            addBox(mn, mx);
         }
-        return { closest->t, v };
     }
 
     void PathTracerRenderer::buildPhotonMap() {
-        photonMap = std::make_unique<PhotonMap>();
+        // 先建焦散图: 全局图是否保留 L S D 光子取决于焦散图是否存在
+        buildCausticPhotonMap();
+        buildGlobalPhotonMap();
+    }
+
+    void PathTracerRenderer::buildGlobalPhotonMap() {
+        globalMap = std::make_unique<PhotonMap>();
         std::mt19937 rng{std::random_device{ }()};
         std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        // 追踪一个光子, 从第二次碰撞起在漫反射表面上记录; 第一次碰撞由 sampleDirect 负责
+        auto tracePhoton = [&](Ray ray, Vec3 power) {
+            bool diffuseBounced = false;
+            for (int b=0; b<photonMaxDepth; b++) {
+                auto hit = closestHitObject(ray);
+                if (!hit) break;
+                auto& mtl = scene.materials[hit->material.index()];
+                using PW = Property::Wrapper;
+                Vec3 origin = hit->hitPoint + 0.0001f * hit->normal;
+                auto type = classify(hit->material);
+                if (type == SurfaceType::DIFFUSE) {
+                    Vec3 albedo = (*mtl.getProperty<PW::RGBType>("diffuseColor")).value;
+                    // L S+ D 光子由焦散图负责, 这里只在没有焦散图时保留
+                    if (b > 0 && (diffuseBounced || !causticMap)) globalMap->add(hit->hitPoint, power);
+                    float p = glm::clamp(glm::max(albedo.x, glm::max(albedo.y, albedo.z)), 0.1f, 0.9f);
+                    if (dist(rng) > p) break;
+                    power *= albedo / p;
+                    Vec3 d = toWorld(hit->normal, sampleHemisphereCosine());
+                    ray = Ray{origin, glm::normalize(d)};
+                    diffuseBounced = true;
+                } else if (type == SurfaceType::SPECULAR) {
+                    Vec3 reflect = (*mtl.getProperty<PW::RGBType>("reflect")).value;
+                    auto roughnessVal = mtl.getProperty<PW::FloatType>("roughness");
+                    float rough = roughnessVal ? (*roughnessVal).value : 0.0f;
+                    float p = glm::clamp(glm::max(reflect.x, glm::max(reflect.y, reflect.z)), 0.1f, 0.9f);
+                    if (dist(rng) > p) break;
+                    power *= reflect / p;
+                    Vec3 rdir = glm::reflect(glm::normalize(ray.direction), glm::normalize(hit->normal));
+                    if (rough > 0.0f) {
+                        Vec3 jitter = toWorld(rdir, sampleHemisphereCosine());
+                        rdir = glm::normalize(rdir + rough * jitter);
+                    }
+                    ray = Ray{origin, rdir};
+                } else {
+                    break;
+                }
+            }
+        };
         Vec3 emittedScene{0, 0, 0};
         Vec3 expectedScene{0, 0, 0};
+        auto report = [&](const Vec3& emittedLight, const Vec3& expectedLight) {
+            emittedScene += emittedLight;
+            expectedScene += expectedLight;
+        };
         for (auto& a : scene.areaLightBuffer) {
             Vec3 nL = glm::normalize(glm::cross(a.u, a.v));
             float area = glm::length(glm::cross(a.u, a.v));
@@ -208,47 +283,166 @@ namespace RayCast
                 Vec3 dir = glm::normalize(toWorld(nL, sampleHemisphereCosine()));
                 Vec3 power = a.radiance * area * 3.1415926535898f / float(photonsPerLight);
                 emittedLight += power;
+                tracePhoton(Ray{pos + 0.0001f*nL, dir}, power);
+            }
+            report(emittedLight, expectedLight);
+        }
+        // 点光源向整个球面均匀发射, 总功率为 4 pi I
+        for (auto& l : scene.pointLightBuffer) {
+            Vec3 emittedLight{0, 0, 0};
+            Vec3 expectedLight = l.intensity * 4.0f * 3.1415926535898f;
+            for (int i=0; i<photonsPerLight; i++) {
+                Vec3 dir = glm::normalize(sampleCone(Vec3{0, 0, 1}, -1.0f));
+                Vec3 power = expectedLight / float(photonsPerLight);
+                emittedLight += power;
+                tracePhoton(Ray{l.position, dir}, power);
+            }
+            report(emittedLight, expectedLight);
+        }
+        // 聚光灯在 fallout 圆锥内均匀发射, 光子功率按衰减加权;
+        // 衰减在 hotSpot 内为 1, 之后是关于 cos 的 smoothstep, 积分为两段之和
+        for (auto& l : scene.spotLightBuffer) {
+            Vec3 axis = glm::normalize(l.direction);
+            float cosStart = cos(glm::min(l.hotSpot, l.fallout));
+            float cosEnd = cos(l.fallout);
+            float solidAngle = 6.283185307179586f * (1.0f - cosEnd);
+            Vec3 emittedLight{0, 0, 0};
+            Vec3 expectedLight = l.intensity * 6.283185307179586f * ((1.0f - cosStart) + 0.5f*(cosStart - cosEnd));
+            for (int i=0; i<photonsPerLight; i++) {
+                Vec3 dir = glm::normalize(sampleCone(axis, cosEnd));
+                Vec3 power = l.intensity * LightTree::spotFalloff(l, dir) * solidAngle / float(photonsPerLight);
+                emittedLight += power;
+                tracePhoton(Ray{l.position, dir}, power);
+            }
+            report(emittedLight, expectedLight);
+        }
+        globalMap->build();
+        auto toString = [](const Vec3& v) {
+            return "(" + to_string(v.x) + ", " + to_string(v.y) + ", " + to_string(v.z) + ")";
+        };
+        getServer().logger.log("Photon map: emitted " + toString(emittedScene) + ", expected " + toString(expectedScene) + ".");
+    }
+
+    void PathTracerRenderer::buildCausticPhotonMap() {
+        causticMap.reset();
+        collectSpecularTargets();
+        if (causticPhotonsPerLight <= 0 || specularTargets.empty()) return;
+        causticMap = std::make_unique<PhotonMap>();
+        std::mt19937 rng{std::random_device{ }()};
+        std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        const size_t targetNums = specularTargets.size();
+        vector<float> cdf(targetNums);
+        vector<Vec3> axes(targetNums);
+        vector<float> cosMaxes(targetNums);
+        // 向镜面目标发射一个光源的焦散光子
+        //  - nL 为面光源的法线, 只向其正面的目标发射; 点光源与聚光灯传零向量
+        //  - samplePos() 在光源上取发射点
+        //  - emission(dir) 为沿 dir 发出的强度, 面光源已乘以 cos 与面积; 为 0 时不发射
+        auto emitCaustics = [&](const Vec3& center, const Vec3& nL, auto&& samplePos, auto&& emission) {
+            // 按目标相对光源中心张成的立体角分配选择概率, 背面的目标不发射
+            float total = 0.0f;
+            for (size_t k=0; k<targetNums; k++) {
+                auto& st = specularTargets[k];
+                Vec3 d = st.center - center;
+                float d2 = glm::dot(d, d);
+                float w = 0.0f;
+                if (glm::dot(d, nL) > -st.radius) {
+                    float sin2 = st.radius*st.radius / glm::max(d2, 1e-12f);
+                    w = sin2 >= 1.0f ? 2.0f : 1.0f - sqrt(1.0f - sin2);
+                }
+                total += w;
+                cdf[k] = total;
+            }
+            if (total <= 0.0f) return;
+            const Vec3 fullAxis = glm::dot(nL, nL) > 0.0f ? nL : Vec3{0, 0, 1};
+            for (int i=0; i<causticPhotonsPerLight; i++) {
+                Vec3 pos = samplePos();
+                // 每个目标相对采样点的圆锥, 采样点在包围球内时退化为整个球面
+                for (size_t k=0; k<targetNums; k++) {
+                    auto& st = specularTargets[k];
+                    Vec3 d = st.center - pos;
+                    float d2 = glm::dot(d, d);
+                    if (d2 <= st.radius*st.radius) {
+                        axes[k] = fullAxis;
+                        cosMaxes[k] = -1.0f;
+                    } else {
+                        axes[k] = d / sqrt(d2);
+                        cosMaxes[k] = sqrt(glm::max(0.0f, 1.0f - st.radius*st.radius / d2));
+                    }
+                }
+                size_t sel = std::lower_bound(cdf.begin(), cdf.end(), dist(rng) * total) - cdf.begin();
+                if (sel >= targetNums) sel = targetNums - 1;
+                Vec3 dir = glm::normalize(sampleCone(axes[sel], cosMaxes[sel]));
+                Vec3 intensity = emission(dir);
+                if (intensity == Vec3{0, 0, 0}) continue;
+                // 方向 pdf 是各圆锥均匀分布的混合
+                float pdf = 0.0f;
+                float prev = 0.0f;
+                for (size_t k=0; k<targetNums; k++) {
+                    float pk = (cdf[k] - prev) / total;
+                    prev = cdf[k];
+                    if (pk <= 0.0f || glm::dot(dir, axes[k]) < cosMaxes[k]) continue;
+                    pdf += pk / (6.283185307179586f * (1.0f - cosMaxes[k]));
+                }
+                if (pdf <= 0.0f) continue;
+                Vec3 power = intensity / (pdf * float(causticPhotonsPerLight));
                 Ray ray{pos + 0.0001f*nL, dir};
+                bool viaSpecular = false;
                 for (int b=0; b<photonMaxDepth; b++) {
                     auto hit = closestHitObject(ray);
                     if (!hit) break;
                     auto& mtl = scene.materials[hit->material.index()];
                     using PW = Property::Wrapper;
                     Vec3 origin = hit->hitPoint + 0.0001f * hit->normal;
-                    auto diffuseColor = mtl.getProperty<PW::RGBType>("diffuseColor");
-                    auto reflectColor = mtl.getProperty<PW::RGBType>("reflect");
-                    auto roughnessVal = mtl.getProperty<PW::FloatType>("roughness");
-                    if (diffuseColor) {
-                        Vec3 albedo = (*diffuseColor).value;
-                        if (b > 0) photonMap->add(hit->hitPoint, power);
-                        float p = glm::clamp(glm::max(albedo.x, glm::max(albedo.y, albedo.z)), 0.1f, 0.9f);
-                        if (dist(rng) > p) break;
-                        power *= albedo / p;
-                        Vec3 d = toWorld(hit->normal, sampleHemisphereCosine());
-                        ray = Ray{origin, glm::normalize(d)};
-                    } else if (reflectColor) {
-                        Vec3 reflect = (*reflectColor).value;
-                        float rough = roughnessVal ? (*roughnessVal).value : 0.0f;
-                        float p = glm::clamp(glm::max(reflect.x, glm::max(reflect.y, reflect.z)), 0.1f, 0.9f);
-                        if (dist(rng) > p) break;
-                        power *= reflect / p;
-                        Vec3 rdir = glm::reflect(glm::normalize(ray.direction), glm::normalize(hit->normal));
-                        if (rough > 0.0f) {
-                            Vec3 jitter = toWorld(rdir, sampleHemisphereCosine());
-                            rdir = glm::normalize(rdir + rough * jitter);
-                        }
-                        ray = Ray{origin, rdir};
-                    } else {
+                    auto type = classify(hit->material);
+                    if (type != SurfaceType::SPECULAR) {
+                        if (viaSpecular && type == SurfaceType::DIFFUSE) causticMap->add(hit->hitPoint, power);
                         break;
                     }
+                    Vec3 reflect = (*mtl.getProperty<PW::RGBType>("reflect")).value;
+                    auto roughnessVal = mtl.getProperty<PW::FloatType>("roughness");
+                    float rough = roughnessVal ? (*roughnessVal).value : 0.0f;
+                    float p = glm::clamp(glm::max(reflect.x, glm::max(reflect.y, reflect.z)), 0.1f, 0.9f);
+                    if (dist(rng) > p) break;
+                    power *= reflect / p;
+                    Vec3 rdir = glm::reflect(glm::normalize(ray.direction), glm::normalize(hit->normal));
+                    if (rough > 0.0f) {
+                        Vec3 jitter = toWorld(rdir, sampleHemisphereCosine());
+                        rdir = glm::normalize(rdir + rough * jitter);
+                    }
+                    ray = Ray{origin, rdir};
+                    viaSpecular = true;
                 }
             }
-            emittedScene += emittedLight;
-            expectedScene += expectedLight;
-            std::cout << "[PhotonMap] Emitted(light) " << emittedLight << " | Expected " << expectedLight << std::endl;
+        };
+        for (auto& a : scene.areaLightBuffer) {
+            Vec3 nL = glm::normalize(glm::cross(a.u, a.v));
+            float area = glm::length(glm::cross(a.u, a.v));
+            emitCaustics(a.position + 0.5f*(a.u + a.v), nL,
+                [&]() { return a.position + dist(rng)*a.u + dist(rng)*a.v; },
+                [&](const Vec3& dir) { return a.radiance * glm::max(0.0f, glm::dot(nL, dir)) * area; });
+        }
+        for (auto& l : scene.pointLightBuffer) {
+            emitCaustics(l.position, Vec3{0, 0, 0},
+                [&]() { return l.position; },
+                [&](const Vec3& dir) { return l.intensity; });
+        }
+        for (auto& l : scene.spotLightBuffer) {
+            emitCaustics(l.position, Vec3{0, 0, 0},
+                [&]() { return l.position; },
+                [&](const Vec3& dir) { return l.intensity * LightTree::spotFalloff(l, dir); });
         }
-        photonMap->build();
-        std::cout << "[PhotonMap] Emitted(scene) " << emittedScene << " | Expected(scene) " << expectedScene << std::endl;
+        causticMap->build();
+        getServer().logger.log("Caustic photons: " + to_string(causticMap->getPhotons().size()) + " stored, " + to_string(targetNums) + " targeted.");
+    }
+
+    Vec3 PathTracerRenderer::estimateRadiance(const PhotonMap& map, const Vec3& x, const Vec3& albedo, int k) const {
+        auto knn = map.estimateKNN(x, k);
+        Vec3 sumPower = knn.first;
+        float r2 = knn.second;
+        if (r2 <= 0.0f) return Vec3{0};
+        r2 = glm::max(r2, minGatherRadius2);
+        return (albedo / 3.1415926535898f) * (sumPower / (3.1415926535898f * r2));
     }
 
     RGB PathTracerRenderer::trace(const Ray& r, int currDepth) {
@@ -258,14 +452,13 @@ namespace RayCast
         if (hitObject && hitObject->t < tLight) {
             auto& mtl = scene.materials[hitObject->material.index()];
             using PW = Property::Wrapper;
-            auto diffuseColor = mtl.getProperty<PW::RGBType>("diffuseColor");
-            auto reflectColor = mtl.getProperty<PW::RGBType>("reflect");
-            auto roughnessVal = mtl.getProperty<PW::FloatType>("roughness");
+            auto type = classify(hitObject->material);
 
             Vec3 origin = hitObject->hitPoint + 0.0001f * hitObject->normal;
 
-            if (reflectColor) {
-                Vec3 reflect = (*reflectColor).value;
+            if (type == SurfaceType::SPECULAR) {
+                Vec3 reflect = (*mtl.getProperty<PW::RGBType>("reflect")).value;
+                auto roughnessVal = mtl.getProperty<PW::FloatType>("roughness");
                 Vec3 rdir = glm::reflect(glm::normalize(r.direction), glm::normalize(hitObject->normal));
                 float rough = roughnessVal ? (*roughnessVal).value : 0.0f;
                 if (rough > 0.0f) {
@@ -275,42 +468,23 @@ namespace RayCast
                 return reflect * trace(Ray{origin, rdir}, currDepth+1);
             }
 
+            auto diffuseColor = mtl.getProperty<PW::RGBType>("diffuseColor");
             Vec3 albedo = diffuseColor ? (*diffuseColor).value : Vec3{1,1,1};
 
             Vec3 direct{0, 0, 0};
-            if (diffuseColor && !scene.areaLightBuffer.empty()) {
-                int lightSamples = 8;
-                for (auto& a : scene.areaLightBuffer) {
-                    Vec3 nL = glm::normalize(glm::cross(a.u, a.v));
-                    float area = glm::length(glm::cross(a.u, a.v));
-                    for (int s=0; s<lightSamples; s++) {
-                        float us = (s + 0.5f) / float(lightSamples);
-                        float vs = ((s*73) % lightSamples + 0.5f) / float(lightSamples);
-                        Vec3 y = a.position + us*a.u + vs*a.v;
-                        Vec3 out = glm::normalize(y - origin);
-                        float d = glm::length(y - origin);
-                        if (glm::dot(out, hitObject->normal) <= 0) continue;
-                        if (glm::dot(nL, -out) <= 0) continue;
-                        auto shadowHit = closestHitObject(Ray{origin, out});
-                        if (shadowHit && shadowHit->t <= d - 0.001f) continue;
-                        float G = glm::max(0.0f, glm::dot(hitObject->normal, out)) * glm::max(0.0f, glm::dot(nL, -out)) / (d*d);
-                        direct += (albedo / 3.1415926535898f) * a.radiance * G;
-                    }
-                    direct *= (area / float(lightSamples));
-                }
+            if (type == SurfaceType::DIFFUSE && lights.size() > 0) {
+                direct = (albedo / 3.1415926535898f) * sampleDirect(origin, hitObject->normal);
             }
 
             Vec3 indirect{0, 0, 0};
-            if (photonMap) {
-                auto knn = photonMap->estimateKNN(origin, gatherK);
-                Vec3 sumPower = knn.first;
-                float r2 = knn.second;
-                if (r2 > 0.0f) {
-                    r2 = glm::max(r2, minGatherRadius2);
-                    indirect = (albedo / 3.1415926535898f) * (sumPower / (3.1415926535898f * r2));
-                }
+            if (globalMap) {
+                indirect = estimateRadiance(*globalMap, origin, albedo, gatherK);
+            }
+            Vec3 caustic{0, 0, 0};
+            if (causticMap) {
+                caustic = estimateRadiance(*causticMap, origin, albedo, causticGatherK);
             }
-            return direct + indirect;
+            return direct + indirect + caustic;
         } else if (tLight != FLOAT_INF) {
             return emitted;
         } else {
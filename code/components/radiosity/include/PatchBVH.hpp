@@ -0,0 +1,68 @@
+#pragma once
+#ifndef __RADIOSITY_PATCH_BVH_HPP__
+#define __RADIOSITY_PATCH_BVH_HPP__
+
+#include "geometry/vec.hpp"
+#include "Ray.hpp"
+
+#include <vector>
+#include <optional>
+
+namespace Radiosity
+{
+    using namespace NRenderer;
+    using namespace std;
+
+    // 剖分后的三角形单元, 平面网格中的一个四边形面片由两个单元组成
+    struct Element
+    {
+        Vec3 v0, v1, v2;
+        Vec3 normal;
+        Handle material;
+        int patch;
+        // 共享顶点下标, 渲染时用顶点辐射度做重心插值
+        int vertex[3];
+    };
+
+    struct ElementHit
+    {
+        float t;
+        int element;
+        // 相对 v1, v2 的重心坐标
+        float b1, b2;
+    };
+
+    // 单元数组上的中位数划分 BVH, 求解阶段的可见性与渲染阶段的求交共用
+    class PatchBVH
+    {
+    private:
+        struct Node
+        {
+            Vec3 bMin;
+            Vec3 bMax;
+            int left = -1;   // -1 表示叶子
+            int right = -1;
+            int start = 0;
+            int count = 0;
+            bool isLeaf() const { return left == -1; }
+        };
+        vector<Node> nodes;
+        vector<int> order;
+        const vector<Element>* elements = nullptr;
+
+    public:
+        PatchBVH() = default;
+
+        // elements 在 BVH 生命周期内不能被修改
+        void build(const vector<Element>& elements);
+        optional<ElementHit> closestHit(const Ray& r, float tMin, float tMax) const;
+        bool occluded(const Ray& r, float tMin, float tMax) const;
+
+    private:
+        int buildRecursive(int start, int end, const vector<Vec3>& centroids);
+        static bool hitBox(const Node& node, const Ray& r, const Vec3& invDir, float tMin, float tMax);
+        static bool hitElement(const Element& e, const Ray& r, float tMin, float tMax, float& t, float& b1, float& b2);
+    };
+}
+
+#endif
@@ -0,0 +1,110 @@
+#pragma once
+#ifndef __RADIOSITY_HPP__
+#define __RADIOSITY_HPP__
+
+#include "scene/Scene.hpp"
+#include "Ray.hpp"
+#include "Camera.hpp"
+#include "intersections/intersections.hpp"
+#include "VertexTransformer.hpp"
+#include "PatchBVH.hpp"
+
+#include <tuple>
+#include <mutex>
+#include <cstdint>
+
+namespace Radiosity
+{
+    using namespace NRenderer;
+    using namespace std;
+
+    // 辐射度面片, radiosity/unshot 单位为 W/m^2 (出射辐射度 B = PI * L)
+    struct Patch
+    {
+        Vec3 center;
+        Vec3 normal;
+        float area;
+        Vec3 albedo;
+        Vec3 radiosity;
+        Vec3 unshot;
+        // 面光源被剖分成只发射不接收的面片, 不进入 BVH
+        bool emitter;
+    };
+
+    // 组件实例每次渲染都会重建, 解放在静态缓存里, 场景内容(不含相机与分辨率)不变时直接复用
+    struct RadiositySolution
+    {
+        mutex mtx;
+        uint64_t sceneKey = 0;
+        bool valid = false;
+        vector<Patch> patches;
+        vector<Element> elements;
+        vector<Vec3> vertices;
+        vector<Vec3> vertexRadiosity;
+        PatchBVH bvh;
+        float epsilon = 0.0001f;
+    };
+
+    class RadiosityRenderer
+    {
+    private:
+        SharedScene spScene;
+        Scene& scene;
+
+        unsigned int width;
+        unsigned int height;
+        unsigned int depth;
+        unsigned int samples;
+        int resolution;
+
+        Camera camera;
+
+        // 求解对面片数是平方复杂度, 面片数约与分辨率的平方成正比;
+        // 64 时康奈尔盒约 2 万个面片, 再往上求解时间不可接受
+        static constexpr int maxResolution = 64;
+
+        // 只读引用缓存中的解, 渲染期间缓存不会被改写
+        const RadiositySolution* solution;
+    public:
+        RadiosityRenderer(SharedScene spScene)
+            : spScene               (spScene)
+            , scene                 (*spScene)
+            , camera                (spScene->camera)
+            , solution              (nullptr)
+        {
+            width = scene.renderOption.width;
+            height = scene.renderOption.height;
+            depth = scene.renderOption.depth;
+            samples = scene.renderOption.samplesPerPixel;
+            if (samples < 1) samples = 1;
+            resolution = scene.renderOption.radiosityResolution;
+            if (resolution < 1) resolution = 1;
+            if (resolution > maxResolution) resolution = maxResolution;
+        }
+        ~RadiosityRenderer() = default;
+
+        using RenderResult = tuple<RGBA*, unsigned int, unsigned int>;
+        RenderResult render();
+        void release(const RenderResult& r);
+
+    private:
+        void renderTask(RGBA* pixels, int width, int height, int off, int step);
+        RGB trace(const Ray& ray, int currDepth);
+        RGB gather(const Ray& ray);
+        RGB interpolate(const ElementHit& hit) const;
+        bool occluded(const RadiositySolution& s, const Ray& r, float tMax) const;
+        RGB directLight(const Vec3& origin, const Vec3& normal, const Vec3& albedo) const;
+        Vec3 sampleHemisphereCosine() const;
+        Vec3 toWorld(const Vec3& n, const Vec3& local) const;
+        Vec3 albedoOf(Handle material) const;
+
+        uint64_t sceneKey() const;
+        void subdivide(RadiositySolution& s) const;
+        void addTriangle(RadiositySolution& s, const Vec3& a, const Vec3& b, const Vec3& c,
+            int ia, int ib, int ic, const Vec3& orient, Handle material, float patchSize) const;
+        void solve(RadiositySolution& s) const;
+        static RadiositySolution& cache();
+    };
+}
+
+#endif
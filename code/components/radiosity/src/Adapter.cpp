@@ -0,0 +1,35 @@
+#include "server/Server.hpp"
+#include "component/RenderComponent.hpp"
+
+#include "Radiosity.hpp"
+
+using namespace std;
+using namespace NRenderer;
+
+namespace Radiosity
+{
+    class Adapter : public RenderComponent
+    {
+    public:
+        void render(SharedScene spScene) {
+            RadiosityRenderer renderer{spScene};
+            auto result = renderer.render();
+            auto [ pixels, width, height ] = result;
+            getServer().screen.setLinear(pixels, width, height);
+            renderer.release(result);
+        }
+    };
+}
+
+const static string description = 
+    "Progressive Radiosity Renderer.\n"
+    "Supported:\n"
+    " - Lambertian BRDF, mirror reflection\n"
+    " - Area Light\n"
+    " - Triangle, Plane, Mesh are subdivided into patches\n"
+    " - Sphere is shaded by gathering from the patch solution\n"
+    " - The solution is reused while only the camera changes\n\n"
+    "Please use path_tracing_cornel.scn"
+    ;
+
+REGISTER_RENDERER(Radiosity, description, Radiosity::Adapter);
@@ -0,0 +1,146 @@
+#include "PatchBVH.hpp"
+
+#include <algorithm>
+
+namespace Radiosity
+{
+    void PatchBVH::build(const vector<Element>& elems) {
+        elements = &elems;
+        nodes.clear();
+        order.resize(elems.size());
+        if (elems.empty()) return;
+
+        vector<Vec3> centroids(elems.size());
+        for (size_t i=0; i<elems.size(); i++) {
+            order[i] = int(i);
+            centroids[i] = (elems[i].v0 + elems[i].v1 + elems[i].v2) / 3.f;
+        }
+        nodes.reserve(elems.size() * 2);
+        buildRecursive(0, int(elems.size()), centroids);
+    }
+
+    int PatchBVH::buildRecursive(int start, int end, const vector<Vec3>& centroids) {
+        int nodeIdx = int(nodes.size());
+        nodes.push_back(Node{});
+        Vec3 bMin{FLOAT_INF}, bMax{-FLOAT_INF};
+        Vec3 cMin{FLOAT_INF}, cMax{-FLOAT_INF};
+        for (int i=start; i<end; i++) {
+            auto& e = (*elements)[order[i]];
+            bMin = glm::min(bMin, glm::min(e.v0, glm::min(e.v1, e.v2)));
+            bMax = glm::max(bMax, glm::max(e.v0, glm::max(e.v1, e.v2)));
+            cMin = glm::min(cMin, centroids[order[i]]);
+            cMax = glm::max(cMax, centroids[order[i]]);
+        }
+        nodes[nodeIdx].bMin = bMin;
+        nodes[nodeIdx].bMax = bMax;
+
+        if (end - start <= 4) {
+            nodes[nodeIdx].start = start;
+            nodes[nodeIdx].count = end - start;
+            return nodeIdx;
+        }
+
+        Vec3 extent = cMax - cMin;
+        int axis = 0;
+        if (extent.y > extent.x) axis = 1;
+        if (extent.z > extent[axis]) axis = 2;
+        int mid = (start + end) / 2;
+        std::nth_element(order.begin() + start, order.begin() + mid, order.begin() + end,
+            [&centroids, axis](int a, int b) {
+                return centroids[a][axis] < centroids[b][axis];
+            });
+
+        // push_back 可能使引用失效, 先递归再回写
+        int left = buildRecursive(start, mid, centroids);
+        int right = buildRecursive(mid, end, centroids);
+        nodes[nodeIdx].left = left;
+        nodes[nodeIdx].right = right;
+        return nodeIdx;
+    }
+
+    bool PatchBVH::hitBox(const Node& node, const Ray& r, const Vec3& invDir, float tMin, float tMax) {
+        for (int a=0; a<3; a++) {
+            float t0 = (node.bMin[a] - r.origin[a]) * invDir[a];
+            float t1 = (node.bMax[a] - r.origin[a]) * invDir[a];
+            if (invDir[a] < 0.f) std::swap(t0, t1);
+            tMin = t0 > tMin ? t0 : tMin;
+            tMax = t1 < tMax ? t1 : tMax;
+            if (tMax < tMin) return false;
+        }
+        return true;
+    }
+
+    bool PatchBVH::hitElement(const Element& e, const Ray& r, float tMin, float tMax, float& t, float& b1, float& b2) {
+        // Möller-Trumbore, 不区分正反面
+        Vec3 e1 = e.v1 - e.v0;
+        Vec3 e2 = e.v2 - e.v0;
+        Vec3 p = glm::cross(r.direction, e2);
+        float det = glm::dot(e1, p);
+        if (fabs(det) < 1e-12f) return false;
+        float invDet = 1.f / det;
+        Vec3 s = r.origin - e.v0;
+        float u = glm::dot(s, p) * invDet;
+        if (u < 0.f || u > 1.f) return false;
+        Vec3 q = glm::cross(s, e1);
+        float v = glm::dot(r.direction, q) * invDet;
+        if (v < 0.f || u + v > 1.f) return false;
+        float tt = glm::dot(e2, q) * invDet;
+        if (tt <= tMin || tt >= tMax) return false;
+        t = tt;
+        b1 = u;
+        b2 = v;
+        return true;
+    }
+
+    optional<ElementHit> PatchBVH::closestHit(const Ray& r, float tMin, float tMax) const {
+        if (nodes.empty()) return nullopt;
+        Vec3 invDir = 1.f / r.direction;
+        optional<ElementHit> closest = nullopt;
+        float closestT = tMax;
+
+        int stack[64];
+        int stackPtr = 0;
+        stack[stackPtr++] = 0;
+        while (stackPtr > 0) {
+            const Node& node = nodes[stack[--stackPtr]];
+            if (!hitBox(node, r, invDir, tMin, closestT)) continue;
+            if (node.isLeaf()) {
+                for (int i=0; i<node.count; i++) {
+                    int idx = order[node.start + i];
+                    float t, b1, b2;
+                    if (hitElement((*elements)[idx], r, tMin, closestT, t, b1, b2)) {
+                        closestT = t;
+                        closest = ElementHit{t, idx, b1, b2};
+                    }
+                }
+            } else {
+                stack[stackPtr++] = node.left;
+                stack[stackPtr++] = node.right;
+            }
+        }
+        return closest;
+    }
+
+    bool PatchBVH::occluded(const Ray& r, float tMin, float tMax) const {
+        if (nodes.empty()) return false;
+        Vec3 invDir = 1.f / r.direction;
+
+        int stack[64];
+        int stackPtr = 0;
+        stack[stackPtr++] = 0;
+        while (stackPtr > 0) {
+            const Node& node = nodes[stack[--stackPtr]];
+            if (!hitBox(node, r, invDir, tMin, tMax)) continue;
+            if (node.isLeaf()) {
+                for (int i=0; i<node.count; i++) {
+                    float t, b1, b2;
+                    if (hitElement((*elements)[order[node.start + i]], r, tMin, tMax, t, b1, b2)) return true;
+                }
+            } else {
+                stack[stackPtr++] = node.left;
+                stack[stackPtr++] = node.right;
+            }
+        }
+        return false;
+    }
+}
@@ -0,0 +1,536 @@
+#include "server/Server.hpp"
+#include "Radiosity.hpp"
+
+#include <thread>
+#include <barrier>
+#include <algorithm>
+#include <random>
+#include <chrono>
+#include <variant>
+#include "glm/gtc/matrix_transform.hpp"
+
+namespace Radiosity
+{
+    namespace
+    {
+        constexpr float PI = 3.1415926535898f;
+        // 剩余未发射能量总和低于初始发射能量的该比例时停止迭代
+        constexpr float convergence = 0.01f;
+        // 球体不做剖分, 漫反射球面的间接光用若干条收集光线从面片解中读取
+        constexpr int gatherSamples = 8;
+        constexpr int lightSamples = 8;
+        // 每批最多同时发射的面片数
+        constexpr size_t shootersPerBatch = 16;
+
+        // FNV-1a, 用于判断两次渲染之间场景内容是否变化
+        struct Hasher
+        {
+            uint64_t h = 1469598103934665603ull;
+            void bytes(const void* p, size_t n) {
+                auto c = static_cast<const unsigned char*>(p);
+                for (size_t i=0; i<n; i++) {
+                    h ^= c[i];
+                    h *= 1099511628211ull;
+                }
+            }
+            void f(float v) { bytes(&v, sizeof(v)); }
+            void u(uint64_t v) { bytes(&v, sizeof(v)); }
+            void v3(const Vec3& v) { f(v.x); f(v.y); f(v.z); }
+        };
+
+        inline float power(const Patch& p) {
+            return (p.unshot.x + p.unshot.y + p.unshot.z) * p.area;
+        }
+
+        inline int cells(float length, float patchSize, int maxCells) {
+            int n = int(ceil(length / patchSize));
+            return n < 1 ? 1 : (n > maxCells ? maxCells : n);
+        }
+    }
+
+    RadiositySolution& RadiosityRenderer::cache() {
+        static RadiositySolution c{};
+        return c;
+    }
+
+    void RadiosityRenderer::release(const RenderResult& r) {
+        auto [p, w, h] = r;
+        delete[] p;
+    }
+
+    Vec3 RadiosityRenderer::sampleHemisphereCosine() const {
+        thread_local static std::mt19937 rng{std::random_device{ }()};
+        thread_local static std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        float r1 = dist(rng);
+        float r2 = dist(rng);
+        float phi = 6.283185307179586f * r1;
+        float x = cos(phi) * sqrt(r2);
+        float y = sin(phi) * sqrt(r2);
+        float z = sqrt(glm::max(0.0f, 1.0f - r2));
+        return {x, y, z};
+    }
+
+    Vec3 RadiosityRenderer::toWorld(const Vec3& n, const Vec3& local) const {
+        Vec3 w = glm::normalize(n);
+        Vec3 a = (fabs(w.x) > 0.9f) ? Vec3{0, 1, 0} : Vec3{1, 0, 0};
+        Vec3 v = glm::normalize(glm::cross(w, a));
+        Vec3 u = glm::cross(v, w);
+        return local.x * u + local.y * v + local.z * w;
+    }
+
+    Vec3 RadiosityRenderer::albedoOf(Handle material) const {
+        // 镜面在求解中只遮挡不反射, 渲染时再追踪反射光线
+        auto& mtl = scene.materials[material.index()];
+        using PW = Property::Wrapper;
+        if (mtl.getProperty<PW::RGBType>("reflect")) return Vec3{0};
+        auto diffuseColor = mtl.getProperty<PW::RGBType>("diffuseColor");
+        return diffuseColor ? (*diffuseColor).value : Vec3{0};
+    }
+
+    uint64_t RadiosityRenderer::sceneKey() const {
+        // 只统计影响辐射度解的内容, 相机/分辨率/采样数/深度的变化不会让缓存失效
+        Hasher hs;
+        hs.u(resolution);
+        for (auto& m : scene.materials) {
+            hs.u(m.type);
+            for (auto& p : m.properties) {
+                hs.bytes(p.key.data(), p.key.size());
+                hs.u(uint64_t(p.type));
+                std::visit([&hs](const auto& w) { hs.bytes(&w.value, sizeof(w.value)); }, p.valueWrapper);
+            }
+        }
+        for (auto& s : scene.sphereBuffer) {
+            hs.v3(s.position); hs.f(s.radius); hs.u(s.material.getValue());
+        }
+        for (auto& t : scene.triangleBuffer) {
+            hs.v3(t.v1); hs.v3(t.v2); hs.v3(t.v3); hs.v3(t.normal); hs.u(t.material.getValue());
+        }
+        for (auto& p : scene.planeBuffer) {
+            hs.v3(p.position); hs.v3(p.normal); hs.v3(p.u); hs.v3(p.v); hs.u(p.material.getValue());
+        }
+        for (auto& m : scene.meshBuffer) {
+            hs.u(m.positions.size());
+            if (!m.positions.empty()) hs.bytes(m.positions.data(), m.positions.size()*sizeof(Vec3));
+            hs.u(m.positionIndices.size());
+            if (!m.positionIndices.empty()) hs.bytes(m.positionIndices.data(), m.positionIndices.size()*sizeof(Index));
+            hs.u(m.material.getValue());
+        }
+        for (auto& a : scene.areaLightBuffer) {
+            hs.v3(a.position); hs.v3(a.u); hs.v3(a.v); hs.v3(a.radiance);
+        }
+        return hs.h;
+    }
+
+    void RadiosityRenderer::addTriangle(RadiositySolution& s, const Vec3& a, const Vec3& b, const Vec3& c,
+        int ia, int ib, int ic, const Vec3& orient, Handle material, float patchSize) const {
+        Vec3 n = glm::cross(b - a, c - a);
+        float len = glm::length(n);
+        if (len < 1e-12f) return;
+        n /= len;
+        if (glm::dot(orient, orient) > 0.f && glm::dot(n, orient) < 0.f) n = -n;
+
+        // 重心网格剖分: n*n 个小三角形, 每个小三角形是一个面片
+        float maxEdge = glm::max(glm::length(b - a), glm::max(glm::length(c - b), glm::length(a - c)));
+        int cnt = cells(maxEdge, patchSize, 64);
+        auto gridIndex = [cnt](int i, int j) { return i*(cnt+1) - i*(i-1)/2 + j; };
+        vector<int> ids((cnt+1)*(cnt+2)/2);
+        for (int i=0; i<=cnt; i++) {
+            for (int j=0; i+j<=cnt; j++) {
+                int id = -1;
+                if (i == 0 && j == 0) id = ia;
+                else if (i == cnt) id = ib;
+                else if (j == cnt) id = ic;
+                if (id < 0) {
+                    id = int(s.vertices.size());
+                    s.vertices.push_back(a + (float(i)/cnt)*(b - a) + (float(j)/cnt)*(c - a));
+                }
+                ids[gridIndex(i, j)] = id;
+            }
+        }
+        Vec3 albedo = albedoOf(material);
+        float area = 0.5f * len / float(cnt*cnt);
+        auto emit = [&](int i0, int i1, int i2) {
+            Element e;
+            e.vertex[0] = i0; e.vertex[1] = i1; e.vertex[2] = i2;
+            e.v0 = s.vertices[i0]; e.v1 = s.vertices[i1]; e.v2 = s.vertices[i2];
+            e.normal = n;
+            e.material = material;
+            e.patch = int(s.patches.size());
+            s.elements.push_back(e);
+            s.patches.push_back({(e.v0 + e.v1 + e.v2) / 3.f, n, area, albedo, Vec3{0}, Vec3{0}, false});
+        };
+        for (int i=0; i<cnt; i++) {
+            for (int j=0; i+j<cnt; j++) {
+                emit(ids[gridIndex(i, j)], ids[gridIndex(i+1, j)], ids[gridIndex(i, j+1)]);
+                if (i+j < cnt-1) {
+                    emit(ids[gridIndex(i+1, j)], ids[gridIndex(i+1, j+1)], ids[gridIndex(i, j+1)]);
+                }
+            }
+        }
+    }
+
+    void RadiosityRenderer::subdivide(RadiositySolution& s) const {
+        Vec3 mn{FLOAT_INF}, mx{-FLOAT_INF};
+        auto expand = [&mn, &mx](const Vec3& v) { mn = glm::min(mn, v); mx = glm::max(mx, v); };
+        for (auto& p : scene.planeBuffer) {
+            expand(p.position); expand(p.position + p.u); expand(p.position + p.v); expand(p.position + p.u + p.v);
+        }
+        for (auto& t : scene.triangleBuffer) {
+            expand(t.v1); expand(t.v2); expand(t.v3);
+        }
+        for (auto& m : scene.meshBuffer) {
+            for (auto& v : m.positions) expand(v);
+        }
+        for (auto& sp : scene.sphereBuffer) {
+            expand(sp.position - Vec3{sp.radius}); expand(sp.position + Vec3{sp.radius});
+        }
+        for (auto& a : scene.areaLightBuffer) {
+            expand(a.position); expand(a.position + a.u + a.v);
+        }
+        if (mn.x > mx.x) return;
+        Vec3 extent = mx - mn;
+        float maxExtent = glm::max(extent.x, glm::max(extent.y, extent.z));
+        float patchSize = maxExtent / float(resolution);
+        s.epsilon = glm::max(1e-5f, 1e-4f * glm::length(extent));
+
+        // 面光源面片放在最前面, 只作为发射者
+        for (auto& a : scene.areaLightBuffer) {
+            Vec3 nL = glm::cross(a.u, a.v);
+            float area = glm::length(nL);
+            if (area <= 0.f) continue;
+            nL /= area;
+            int nu = cells(glm::length(a.u), patchSize, 32);
+            int nv = cells(glm::length(a.v), patchSize, 32);
+            for (int i=0; i<nu; i++) {
+                for (int j=0; j<nv; j++) {
+                    Vec3 center = a.position + ((i + 0.5f)/nu)*a.u + ((j + 0.5f)/nv)*a.v;
+                    Vec3 b = PI * a.radiance;
+                    s.patches.push_back({center, nL, area / float(nu*nv), Vec3{0}, b, b, true});
+                }
+            }
+        }
+
+        for (auto& p : scene.planeBuffer) {
+            Vec3 n = glm::normalize(p.normal);
+            int nu = cells(glm::length(p.u), patchSize, 256);
+            int nv = cells(glm::length(p.v), patchSize, 256);
+            int base = int(s.vertices.size());
+            for (int i=0; i<=nu; i++) {
+                for (int j=0; j<=nv; j++) {
+                    s.vertices.push_back(p.position + (float(i)/nu)*p.u + (float(j)/nv)*p.v);
+                }
+            }
+            Vec3 albedo = albedoOf(p.material);
+            float area = glm::length(glm::cross(p.u, p.v)) / float(nu*nv);
+            auto id = [base, nv](int i, int j) { return base + i*(nv+1) + j; };
+            for (int i=0; i<nu; i++) {
+                for (int j=0; j<nv; j++) {
+                    int patch = int(s.patches.size());
+                    Vec3 center = p.position + ((i + 0.5f)/nu)*p.u + ((j + 0.5f)/nv)*p.v;
+                    s.patches.push_back({center, n, area, albedo, Vec3{0}, Vec3{0}, false});
+                    int quad[2][3] = {
+                        { id(i, j), id(i+1, j), id(i+1, j+1) },
+                        { id(i, j), id(i+1, j+1), id(i, j+1) }
+                    };
+                    for (auto& q : quad) {
+                        Element e;
+                        e.vertex[0] = q[0]; e.vertex[1] = q[1]; e.vertex[2] = q[2];
+                        e.v0 = s.vertices[q[0]]; e.v1 = s.vertices[q[1]]; e.v2 = s.vertices[q[2]];
+                        e.normal = n;
+                        e.material = p.material;
+                        e.patch = patch;
+                        s.elements.push_back(e);
+                    }
+                }
+            }
+        }
+
+        for (auto& t : scene.triangleBuffer) {
+            addTriangle(s, t.v1, t.v2, t.v3, -1, -1, -1, t.normal, t.material, patchSize);
+        }
+
+        // 网格的原始顶点在相邻三角形之间共享, 插值结果在三角形边界上连续
+        for (auto& m : scene.meshBuffer) {
+            int base = int(s.vertices.size());
+            s.vertices.insert(s.vertices.end(), m.positions.begin(), m.positions.end());
+            for (size_t i = 0; i + 2 < m.positionIndices.size(); i += 3) {
+                int i0 = base + int(m.positionIndices[i]);
+                int i1 = base + int(m.positionIndices[i + 1]);
+                int i2 = base + int(m.positionIndices[i + 2]);
+                // addTriangle 会向 vertices 追加顶点, 先拷贝出来
+                Vec3 a = s.vertices[i0], b = s.vertices[i1], c = s.vertices[i2];
+                addTriangle(s, a, b, c, i0, i1, i2, Vec3{0}, m.material, patchSize);
+            }
+        }
+    }
+
+    bool RadiosityRenderer::occluded(const RadiositySolution& s, const Ray& r, float tMax) const {
+        for (auto& sp : scene.sphereBuffer) {
+            if (Intersection::xSphere(r, sp, 0.000001f, tMax)) return true;
+        }
+        return s.bvh.occluded(r, 0.000001f, tMax);
+    }
+
+    void RadiosityRenderer::solve(RadiositySolution& s) const {
+        // 渐进式辐射度(shooting): 每轮挑选未发射能量最大的面片, 向所有可见面片分发
+        // 接收点形状因子使用圆盘近似 F = cosI*cosJ*Ai / (PI*r^2 + Ai), 可见性用中心到中心的 any-hit 光线
+        float total = 0.f;
+        for (auto& p : s.patches) total += power(p);
+        if (total <= 0.f) return;
+
+        vector<int> receivers;
+        for (int j=0; j<int(s.patches.size()); j++) {
+            auto& p = s.patches[j];
+            if (!p.emitter && glm::max(p.albedo.x, glm::max(p.albedo.y, p.albedo.z)) > 0.f) receivers.push_back(j);
+        }
+
+        // 每批发射未发射能量最大的若干个面片, 批内各发射者的 unshot 先取出快照再清零,
+        // 接收者按下标分给固定的一组工作线程, 整个求解只创建一次线程, 批与批之间用 barrier 同步
+        struct Shooter {
+            int index;
+            Vec3 origin;
+            Vec3 normal;
+            float area;
+            Vec3 unshot;
+        };
+        const int maxShots = int(glm::min<size_t>(s.patches.size() * 4, 50000));
+        const int taskNums = 8;
+        vector<Shooter> batch;
+        vector<int> order(s.patches.size());
+        bool finished = false;
+        std::barrier sync(taskNums + 1);
+
+        auto shoot = [&](int off) {
+            for (;;) {
+                sync.arrive_and_wait();
+                if (finished) return;
+                for (size_t k=off; k<receivers.size(); k+=taskNums) {
+                    int j = receivers[k];
+                    Patch& dst = s.patches[j];
+                    Vec3 target = dst.center + s.epsilon * dst.normal;
+                    for (auto& src : batch) {
+                        if (j == src.index) continue;
+                        Vec3 d = target - src.origin;
+                        float r2 = glm::dot(d, d);
+                        if (r2 <= 0.f) continue;
+                        float r = sqrt(r2);
+                        Vec3 dir = d / r;
+                        float cosI = glm::dot(src.normal, dir);
+                        if (cosI <= 0.f) continue;
+                        float cosJ = -glm::dot(dst.normal, dir);
+                        if (cosJ <= 0.f) continue;
+                        if (occluded(s, Ray{src.origin, dir}, r - s.epsilon)) continue;
+                        float F = cosI * cosJ * src.area / (PI * r2 + src.area);
+                        Vec3 dB = dst.albedo * src.unshot * F;
+                        dst.radiosity += dB;
+                        dst.unshot += dB;
+                    }
+                }
+                sync.arrive_and_wait();
+            }
+        };
+        std::thread t[taskNums];
+        for (int i=0; i<taskNums; i++) t[i] = std::thread(shoot, i);
+
+        int it = 0;
+        int batches = 0;
+        while (it < maxShots) {
+            float remaining = 0.f;
+            float best = 0.f;
+            for (auto& p : s.patches) {
+                remaining += power(p);
+                best = glm::max(best, power(p));
+            }
+            if (remaining < convergence * total) break;
+
+            // 只有能量与最大者相当的面片才进入同一批, 避免过早发射能量还在增长的面片
+            const size_t batchSize = glm::min<size_t>(shootersPerBatch, maxShots - it);
+            for (int i=0; i<int(order.size()); i++) order[i] = i;
+            std::partial_sort(order.begin(), order.begin() + glm::min(batchSize, order.size()), order.end(),
+                [&s](int a, int b) { return power(s.patches[a]) > power(s.patches[b]); });
+            batch.clear();
+            for (size_t k=0; k<batchSize && k<order.size(); k++) {
+                auto& p = s.patches[order[k]];
+                if (power(p) < 0.5f * best) break;
+                batch.push_back({order[k], p.center + s.epsilon * p.normal, p.normal, p.area, p.unshot});
+                p.unshot = Vec3{0};
+            }
+            it += int(batch.size());
+            batches++;
+            sync.arrive_and_wait();
+            sync.arrive_and_wait();
+        }
+        finished = true;
+        sync.arrive_and_wait();
+        for (int i=0; i<taskNums; i++) t[i].join();
+
+        // 面片辐射度按单元面积加权平均到共享顶点上, 供渲染时插值
+        vector<float> weight(s.vertices.size(), 0.f);
+        s.vertexRadiosity.assign(s.vertices.size(), Vec3{0});
+        for (auto& e : s.elements) {
+            float a = 0.5f * glm::length(glm::cross(e.v1 - e.v0, e.v2 - e.v0));
+            for (int k=0; k<3; k++) {
+                s.vertexRadiosity[e.vertex[k]] += a * s.patches[e.patch].radiosity;
+                weight[e.vertex[k]] += a;
+            }
+        }
+        for (size_t i=0; i<s.vertexRadiosity.size(); i++) {
+            if (weight[i] > 0.f) s.vertexRadiosity[i] /= weight[i];
+        }
+        getServer().logger.log("Radiosity converged after " + to_string(it) + " shots in " + to_string(batches) + " batches.");
+    }
+
+    auto RadiosityRenderer::render() -> RenderResult {
+        VertexTransformer vertexTransformer{};
+        vertexTransformer.exec(spScene);
+
+        if (int(scene.renderOption.radiosityResolution) > maxResolution) {
+            getServer().logger.warning("Radiosity resolution clamped to " + to_string(maxResolution) + ".");
+        }
+        auto& c = cache();
+        std::lock_guard<mutex> lock{c.mtx};
+        auto key = sceneKey();
+        if (!c.valid || c.sceneKey != key) {
+            auto start = std::chrono::steady_clock::now();
+            c.patches.clear();
+            c.elements.clear();
+            c.vertices.clear();
+            c.vertexRadiosity.clear();
+            subdivide(c);
+            c.bvh.build(c.elements);
+            getServer().logger.log("Radiosity: " + to_string(c.patches.size()) + " patches, "
+                + to_string(c.elements.size()) + " elements.");
+            solve(c);
+            c.sceneKey = key;
+            c.valid = true;
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+            getServer().logger.log("Radiosity solution built in " + to_string(ms) + " ms.");
+        }
+        else {
+            getServer().logger.log("Scene unchanged, reusing cached radiosity solution.");
+        }
+        solution = &c;
+
+        RGBA* pixels = new RGBA[width*height]{};
+
+        const int taskNums = 8;
+        std::thread t[taskNums];
+        for (int i=0; i < taskNums; i++) {
+            t[i] = std::thread(&RadiosityRenderer::renderTask, this, pixels, width, height, i, taskNums);
+        }
+        for (int i=0; i < taskNums; i++) {
+            t[i].join();
+        }
+        return {pixels, width, height};
+    }
+
+    void RadiosityRenderer::renderTask(RGBA* pixels, int width, int height, int off, int step) {
+        thread_local static std::mt19937 rng{std::random_device{}()};
+        thread_local static std::uniform_real_distribution<float> dist(0.0f, 1.0f);
+        for(int i=off; i<height; i+=step) {
+            for (int j=0; j<width; j++) {
+                Vec3 color{0, 0, 0};
+                for (unsigned int k=0; k<samples; k++) {
+                    float rx = dist(rng);
+                    float ry = dist(rng);
+                    float x = (float(j)+rx)/float(width);
+                    float y = (float(i)+ry)/float(height);
+                    auto ray = camera.shoot(x, y);
+                    color += trace(ray, 0);
+                }
+                color /= float(samples);
+                pixels[(height-i-1)*width+j] = {color, 1};
+            }
+        }
+    }
+
+    RGB RadiosityRenderer::interpolate(const ElementHit& hit) const {
+        auto& e = solution->elements[hit.element];
+        auto& B = solution->vertexRadiosity;
+        Vec3 b = (1.f - hit.b1 - hit.b2) * B[e.vertex[0]] + hit.b1 * B[e.vertex[1]] + hit.b2 * B[e.vertex[2]];
+        return b / PI;
+    }
+
+    RGB RadiosityRenderer::directLight(const Vec3& origin, const Vec3& normal, const Vec3& albedo) const {
+        Vec3 direct{0, 0, 0};
+        for (auto& a : scene.areaLightBuffer) {
+            Vec3 nL = glm::normalize(glm::cross(a.u, a.v));
+            float area = glm::length(glm::cross(a.u, a.v));
+            Vec3 sum{0, 0, 0};
+            for (int s=0; s<lightSamples; s++) {
+                float us = (s + 0.5f) / float(lightSamples);
+                float vs = ((s*73) % lightSamples + 0.5f) / float(lightSamples);
+                Vec3 y = a.position + us*a.u + vs*a.v;
+                Vec3 out = glm::normalize(y - origin);
+                float d = glm::length(y - origin);
+                if (glm::dot(out, normal) <= 0) continue;
+                if (glm::dot(nL, -out) <= 0) continue;
+                if (occluded(*solution, Ray{origin, out}, d - 0.001f)) continue;
+                float G = glm::dot(normal, out) * glm::dot(nL, -out) / (d*d);
+                sum += (albedo / PI) * a.radiance * G;
+            }
+            direct += sum * (area / float(lightSamples));
+        }
+        return direct;
+    }
+
+    RGB RadiosityRenderer::gather(const Ray& r) {
+        // 只读取面片解; 光源由 directLight 负责, 球面之间的多次反弹忽略
+        float closest = FLOAT_INF;
+        auto eh = solution->bvh.closestHit(r, 0.000001f, closest);
+        if (eh) closest = eh->t;
+        for (auto& sp : scene.sphereBuffer) {
+            if (Intersection::xSphere(r, sp, 0.000001f, closest)) return Vec3{0};
+        }
+        if (eh) return interpolate(*eh);
+        return Vec3{0};
+    }
+
+    RGB RadiosityRenderer::trace(const Ray& r, int currDepth) {
+        if (currDepth >= int(depth)) return Vec3{0};
+        float closest = FLOAT_INF;
+        auto eh = solution->bvh.closestHit(r, 0.000001f, closest);
+        if (eh) closest = eh->t;
+        HitRecord sphereHit = nullopt;
+        for (auto& sp : scene.sphereBuffer) {
+            auto hitRecord = Intersection::xSphere(r, sp, 0.000001f, closest);
+            if (hitRecord && hitRecord->t < closest) { closest = hitRecord->t; sphereHit = hitRecord; }
+        }
+        for (auto& a : scene.areaLightBuffer) {
+            auto hitRecord = Intersection::xAreaLight(r, a, 0.000001f, closest);
+            if (hitRecord && hitRecord->t < closest) return a.radiance;
+        }
+        if (!sphereHit && !eh) return Vec3{0};
+
+        Handle material = sphereHit ? sphereHit->material : solution->elements[eh->element].material;
+        Vec3 normal = sphereHit ? sphereHit->normal : solution->elements[eh->element].normal;
+        Vec3 hitPoint = r.at(closest);
+        Vec3 origin = hitPoint + 0.0001f * normal;
+
+        auto& mtl = scene.materials[material.index()];
+        using PW = Property::Wrapper;
+        auto reflectColor = mtl.getProperty<PW::RGBType>("reflect");
+        auto roughnessVal = mtl.getProperty<PW::FloatType>("roughness");
+        if (reflectColor) {
+            Vec3 rdir = glm::reflect(glm::normalize(r.direction), glm::normalize(normal));
+            float rough = roughnessVal ? (*roughnessVal).value : 0.0f;
+            if (rough > 0.0f) {
+                Vec3 jitter = toWorld(rdir, sampleHemisphereCosine());
+                rdir = glm::normalize(rdir + rough * jitter);
+            }
+            return (*reflectColor).value * trace(Ray{origin, rdir}, currDepth+1);
+        }
+
+        // 剖分过的表面直接插值辐射度解
+        if (!sphereHit) return interpolate(*eh);
+
+        Vec3 albedo = albedoOf(material);
+        Vec3 indirect{0, 0, 0};
+        for (int s=0; s<gatherSamples; s++) {
+            Vec3 d = toWorld(normal, sampleHemisphereCosine());
+            indirect += gather(Ray{origin, glm::normalize(d)});
+        }
+        indirect *= albedo / float(gatherSamples);
+        return directLight(origin, normal, albedo) + indirect;
+    }
+}
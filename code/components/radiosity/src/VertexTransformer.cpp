@@ -0,0 +1,10 @@
+#include "VertexTransformer.hpp"
+#include "scene/WorldTransform.hpp"
+
+namespace Radiosity
+{
+    // 变换与缓存由 NRenderer::WorldTransform 统一完成, 不修改 Asset 中的几何
+    void VertexTransformer::exec(SharedScene spScene) {
+        WorldTransform::exec(*spScene);
+    }
+}
\ No newline at end of file
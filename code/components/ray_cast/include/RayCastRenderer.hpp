@@ -8,6 +8,7 @@
 #include "intersections/intersections.hpp"
 
 #include "shaders/ShaderCreator.hpp"
+#include "shaders/GouraudCache.hpp"
 
 namespace RayCast
 {
@@ -20,6 +21,8 @@ namespace RayCast
         RayCast::Camera camera;
 
         vector<SharedShader> shaderPrograms;
+        // 场景中存在 Gouraud 材质时指向静态的顶点光照缓存
+        const GouraudCache* gouraudCache = nullptr;
     public:
         RayCastRenderer(SharedScene spScene)
             : spScene               (spScene)
@@ -33,7 +36,6 @@ namespace RayCast
         void release(const RenderResult& r);
 
     private:
-        RGB gamma(const RGB& rgb);
         RGB trace(const Ray& r);
         HitRecord closestHit(const Ray& r);
     };
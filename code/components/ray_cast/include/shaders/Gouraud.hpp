@@ -36,6 +36,11 @@ namespace RayCast
                        const Vec3& viewDir, const Vec3& lightPos, 
                        const Vec3& lightIntensity) const;
 
+        // shadeVertex 的两部分: 环境光+漫反射与视角无关, 高光依赖视线方向, 供 GouraudCache 分别缓存
+        RGB shadeVertexDiffuse(const Vec3& vertexPos, const Vec3& vertexNormal, const Vec3& lightPos) const;
+        RGB shadeVertexSpecular(const Vec3& vertexPos, const Vec3& vertexNormal,
+                       const Vec3& viewDir, const Vec3& lightPos) const;
+
         // 计算重心坐标
         Vec3 computeBarycentricCoords(const Vec3& p, const Vec3& v1, const Vec3& v2, const Vec3& v3) const;
     };
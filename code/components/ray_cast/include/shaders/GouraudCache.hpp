@@ -0,0 +1,70 @@
+#pragma once
+#ifndef __GOURAUD_CACHE_HPP__
+#define __GOURAUD_CACHE_HPP__
+
+#include "Gouraud.hpp"
+#include "intersections/HitRecord.hpp"
+
+#include <mutex>
+#include <cstdint>
+
+namespace RayCast
+{
+    // 按 (顶点, 点光源) 缓存 Gouraud 顶点光照, 命中时只做一次重心插值
+    //  - 网格顶点按 positionIndices 去重, 相邻面共享的顶点只算一次;
+    //    同一位置带不同法线 (硬边) 时拆成多个顶点, 没有法线的网格用面法线, 仍按角点存放
+    //  - 散三角形没有共享信息, 按角点存放
+    // 组件每次渲染都会重建场景, 缓存是静态的:
+    //  - 网格按 CowVector 的数据身份判断是否变化, 几何不变时 WorldTransform 会共享上次的数组
+    //  - 材质、光源与散三角形按内容哈希; 几何、材质或光源变化时全部重算
+    //  - 只有相机移动时只重算依赖视线的高光项
+    class GouraudCache
+    {
+    public:
+        // 渲染期间持有, 保证缓存不被其他渲染改写
+        mutex mtx;
+
+        static GouraudCache& instance();
+
+        void update(const Scene& scene, const vector<SharedShader>& shaders);
+        RGB shade(const HitCandidate& c, size_t light) const;
+
+    private:
+        struct MeshSource
+        {
+            // 持有源数组, 保证比较用的数据身份在缓存期间不会被复用
+            CowVector<Vec3> positions;
+            CowVector<Vec3> normals;
+            CowVector<Index> positionIndices;
+            CowVector<Index> normalIndices;
+        };
+        struct Vertex
+        {
+            Vec3 position;
+            Vec3 normal;
+            Handle material;
+        };
+
+        bool valid = false;
+        uint64_t lightingKey = 0;
+        Vec3 viewPosition = {};
+        vector<MeshSource> meshSources;
+
+        vector<Vertex> vertices;
+        // 角点到顶点的映射, 角点先是 triangleBuffer 的 3*i+k, 然后是每个 mesh 的 positionIndices
+        vector<size_t> meshOffset;
+        vector<uint32_t> cornerVertex;
+        // [light][vertex]
+        vector<vector<RGB>> diffuse;
+        vector<vector<RGB>> specular;
+
+        GouraudCache() = default;
+        uint64_t hashLighting(const Scene& scene) const;
+        bool sameGeometry(const Scene& scene) const;
+        void collectVertices(const Scene& scene);
+        size_t corner(const HitCandidate& c, int k) const;
+        void compute(const Scene& scene, const vector<SharedShader>& shaders, bool full);
+    };
+}
+
+#endif
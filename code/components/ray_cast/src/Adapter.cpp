@@ -15,7 +15,7 @@ namespace RayCast
             RayCastRenderer rayCast{spScene};
             auto result = rayCast.render();
             auto [ pixels, width, height ] = result;
-            getServer().screen.set(pixels, width, height);
+            getServer().screen.setLinear(pixels, width, height);
             rayCast.release(result);
         }
     };
@@ -8,9 +8,6 @@ namespace RayCast
         auto [p, w, h] = r;
         delete[] p;
     }
-    RGB RayCastRenderer::gamma(const RGB& rgb) {
-        return glm::sqrt(rgb);
-    }
     auto RayCastRenderer::render() -> RenderResult {
         auto width = scene.renderOption.width;
         auto height = scene.renderOption.height;
@@ -24,12 +21,22 @@ namespace RayCast
             shaderPrograms.push_back(shaderCreator.create(mtl, scene.textures));
         }
 
+        bool hasGouraud = false;
+        for (auto& sp : shaderPrograms) {
+            if (dynamic_pointer_cast<Gouraud>(sp)) hasGouraud = true;
+        }
+        std::unique_lock<mutex> cacheLock;
+        if (hasGouraud) {
+            auto& cache = GouraudCache::instance();
+            cacheLock = std::unique_lock<mutex>{cache.mtx};
+            cache.update(scene, shaderPrograms);
+            gouraudCache = &cache;
+        }
+
         for (int i=0; i<height; i++) {
             for (int j=0; j < width; j++) {
                 auto ray = camera.shoot(float(j)/float(width), float(i)/float(height));
                 auto color = trace(ray);
-                color = clamp(color);
-                color = gamma(color);
                 pixels[(height-i-1)*width+j] = {color, 1};
             }
         }
@@ -40,7 +47,8 @@ namespace RayCast
     RGB RayCastRenderer::trace(const Ray& r) {
         if (scene.pointLightBuffer.size() < 1) return {0, 0, 0};
         auto& l = scene.pointLightBuffer[0];
-        auto closestHitObj = closestHit(r);
+        auto candidate = Intersection::closestCandidate(r, scene, 0.01f);
+        auto closestHitObj = Intersection::resolve(r, scene, candidate);
         if (closestHitObj) {
             auto& hitRec = *closestHitObj;
             auto out = glm::normalize(l.position - hitRec.hitPoint);
@@ -49,7 +57,7 @@ namespace RayCast
             }
             auto distance = glm::length(l.position - hitRec.hitPoint);
             auto shadowRay = Ray{hitRec.hitPoint, out};
-            auto shadowHit = closestHit(shadowRay);
+            auto shadowHit = Intersection::closestCandidate(shadowRay, scene, 0.01f);
             auto c = shaderPrograms[hitRec.material.index()]->shade(-r.direction, out, hitRec.normal);
             if (dynamic_pointer_cast<Phong>(shaderPrograms[hitRec.material.index()]) && hitRec.hasVertexData) {
                 cout<<"Using Phong Shader"<<endl;
@@ -63,21 +71,11 @@ namespace RayCast
                     l.intensity
                 );
             }
-            if (dynamic_pointer_cast<Gouraud>(shaderPrograms[hitRec.material.index()]) && hitRec.hasVertexData) {
-                // Gouraud着色器专用路径
-                auto gouraudShader = dynamic_pointer_cast<Gouraud>(shaderPrograms[hitRec.material.index()]);
-                cout<<"Using Gouraud Shader"<<endl;
-                // cout<<hitRec.normals[0]<<", "<<hitRec.normals[1]<<", "<<hitRec.normals[2]<<endl;
-                c = gouraudShader->shadeTriangle(
-                    hitRec.hitPoint,
-                    hitRec.vertices[0], hitRec.vertices[1], hitRec.vertices[2],
-                    hitRec.normals[0], hitRec.normals[1], hitRec.normals[2],
-                    -r.direction,
-                    l.position,
-                    l.intensity
-                );
+            if (gouraudCache && hitRec.hasVertexData && dynamic_pointer_cast<Gouraud>(shaderPrograms[hitRec.material.index()])) {
+                // Gouraud着色器专用路径: 顶点光照已在渲染前算好, 这里只做插值
+                c = gouraudCache->shade(candidate, 0);
             }
-            if ((!shadowHit) || (shadowHit && shadowHit->t > distance)) {
+            if ((!shadowHit) || (shadowHit && shadowHit.t > distance)) {
                 return c * l.intensity;
             }
             else {
@@ -90,36 +88,8 @@ namespace RayCast
     }
 
     HitRecord RayCastRenderer::closestHit(const Ray& r) {
-        HitRecord closestHit = nullopt;
-        float closest = FLOAT_INF;
-        for (auto& s : scene.sphereBuffer) {
-            auto hitRecord = Intersection::xSphere(r, s, 0.01, closest);
-            if (hitRecord && hitRecord->t < closest) {
-                closest = hitRecord->t;
-                closestHit = hitRecord;
-            }
-        }
-        for (auto& t : scene.triangleBuffer) {
-            auto hitRecord = Intersection::xTriangle(r, t, 0.01, closest);
-            if (hitRecord && hitRecord->t < closest) {
-                closest = hitRecord->t;
-                closestHit = hitRecord;
-            }
-        }
-        for (auto& p : scene.planeBuffer) {
-            auto hitRecord = Intersection::xPlane(r, p, 0.01, closest);
-            if (hitRecord && hitRecord->t < closest) {
-                closest = hitRecord->t;
-                closestHit = hitRecord;
-            }
-        }
-        for (auto& m : scene.meshBuffer) {
-            auto hitRecord = Intersection::xMesh(r, m, 0.01, closest);
-            if (hitRecord && hitRecord->t < closest) {
-                closest = hitRecord->t;
-                closestHit = hitRecord;
-            }
-        }
-        return closestHit; 
+        // 遍历时只比较 t, 最终命中再展开成完整的 HitRecord
+        auto candidate = Intersection::closestCandidate(r, scene, 0.01f);
+        return Intersection::resolve(r, scene, candidate);
     }
 }
\ No newline at end of file
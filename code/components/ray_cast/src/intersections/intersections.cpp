@@ -2,11 +2,35 @@
 
 namespace RayCast::Intersection
 {
-    HitRecord xTriangle(const Ray& ray, const Triangle& t, float tMin, float tMax) {
-        const auto& v1 = t.v1;
-        const auto& v2 = t.v2;
-        const auto& v3 = t.v3;
-        const auto& normal = glm::normalize(t.normal);
+    namespace
+    {
+        HitRecord triangleRecord(const Ray& ray, float t, const Vec3& v1, const Vec3& v2, const Vec3& v3,
+            const Vec3& normal, const Vec3& n1, const Vec3& n2, const Vec3& n3, Handle material) {
+            return getHitRecordWithVertices(
+                t, ray.at(t), glm::normalize(normal), material,
+                v1, v2, v3,
+                glm::normalize(n1), glm::normalize(n2), glm::normalize(n3)
+            );
+        }
+
+        HitRecord meshRecord(const Ray& ray, const Mesh& m, unsigned int face, float t) {
+            const auto& v1 = m.positions[m.positionIndices[face]];
+            const auto& v2 = m.positions[m.positionIndices[face + 1]];
+            const auto& v3 = m.positions[m.positionIndices[face + 2]];
+            // 计算面法向量
+            Vec3 normal = glm::normalize(glm::cross(v2 - v1, v3 - v1));
+            if (m.hasNormal() && (m.normalIndices.size() == m.positionIndices.size())) {
+                return triangleRecord(ray, t, v1, v2, v3, normal,
+                    m.normals[m.normalIndices[face]],
+                    m.normals[m.normalIndices[face + 1]],
+                    m.normals[m.normalIndices[face + 2]],
+                    m.material);
+            }
+            return triangleRecord(ray, t, v1, v2, v3, normal, normal, normal, normal, m.material);
+        }
+    }
+
+    bool testTriangle(const Ray& ray, const Vec3& v1, const Vec3& v2, const Vec3& v3, float tMin, float tMax, float& t, float& b1, float& b2) {
         auto e1 = v2 - v1;
         auto e2 = v3 - v1;
         auto P = glm::cross(ray.direction, e2);
@@ -14,67 +38,157 @@ namespace RayCast::Intersection
         Vec3 T;
         if (det > 0) T = ray.origin - v1;
         else { T = v1 - ray.origin; det = -det; }
-        if (det < 0.000001f) return getMissRecord();
+        if (det < 0.000001f) return false;
         float u, v, w;
         u = glm::dot(T, P);
-        if (u > det || u < 0.f) return getMissRecord();
+        if (u > det || u < 0.f) return false;
         Vec3 Q = glm::cross(T, e1);
         v = glm::dot(ray.direction, Q);
-        if (v < 0.f || v + u > det) return getMissRecord();
+        if (v < 0.f || v + u > det) return false;
         w = glm::dot(e2, Q);
         float invDet = 1.f / det;
         w *= invDet;
-        if (w >= tMax || w <= tMin) return getMissRecord();
-        // return getHitRecord(w, ray.at(w), normal, t.material);
-        return getHitRecordWithVertices(
-            w, ray.at(w), normal, t.material,
-            t.v1, t.v2, t.v3,
-            glm::normalize(t.n1), glm::normalize(t.n2), glm::normalize(t.n3)
-        );
-
+        if (w >= tMax || w <= tMin) return false;
+        t = w;
+        b1 = u * invDet;
+        b2 = v * invDet;
+        return true;
     }
-    HitRecord xSphere(const Ray& ray, const Sphere& s, float tMin, float tMax) {
-        const auto& position = s.position;
-        const auto& r = s.radius;
-        Vec3 oc = ray.origin - position;
+
+    bool testSphere(const Ray& ray, const Sphere& s, float tMin, float tMax, float& t) {
+        Vec3 oc = ray.origin - s.position;
         float a = glm::dot(ray.direction, ray.direction);
         float b = glm::dot(oc, ray.direction);
-        float c = glm::dot(oc, oc) - r*r;
+        float c = glm::dot(oc, oc) - s.radius*s.radius;
         float discriminant = b*b - a*c;
+        if (discriminant <= 0) return false;
         float sqrtDiscriminant = sqrt(discriminant);
-        if (discriminant > 0) {
-            float temp = (-b - sqrtDiscriminant) / a;
-            if (temp < tMax && temp > tMin) {
-                auto hitPoint = ray.at(temp);
-                auto normal = (hitPoint - position)/r;
-                return getHitRecord(temp, hitPoint, normal, s.material);
-            }
-            temp = (-b + sqrtDiscriminant) / a;
-            if (temp < tMax && temp > tMin) {
-                auto hitPoint = ray.at(temp);
-                auto normal = (hitPoint - position)/r;
-                return getHitRecord(temp, hitPoint, normal, s.material);
-            }
+        float temp = (-b - sqrtDiscriminant) / a;
+        if (temp < tMax && temp > tMin) {
+            t = temp;
+            return true;
         }
-        return getMissRecord();
+        temp = (-b + sqrtDiscriminant) / a;
+        if (temp < tMax && temp > tMin) {
+            t = temp;
+            return true;
+        }
+        return false;
     }
-    HitRecord xPlane(const Ray& ray, const Plane& p, float tMin, float tMax) {
+
+    bool testPlane(const Ray& ray, const Plane& p, float tMin, float tMax, float& t) {
         Vec3 normal = glm::normalize(p.normal);
         auto Np_dot_d = glm::dot(ray.direction, normal);
-        if (Np_dot_d < 0.0000001f && Np_dot_d > -0.00000001f) return getMissRecord();
+        if (Np_dot_d < 0.0000001f && Np_dot_d > -0.00000001f) return false;
         float dp = -glm::dot(p.position, normal);
-        float t = (-dp - glm::dot(normal, ray.origin))/Np_dot_d;
-        if (t >= tMax || t <= tMin) return getMissRecord();
-        // cross test
-        Vec3 hitPoint = ray.at(t);
-        Mat3x3 d{p.u, p.v, glm::cross(p.u, p.v)};
-        d = glm::inverse(d);
-        auto res  = d * (hitPoint - p.position);
-        auto u = res.x, v = res.y;
+        float tt = (-dp - glm::dot(normal, ray.origin))/Np_dot_d;
+        if (tt >= tMax || tt <= tMin) return false;
+        // cross test: 沿 u×v 方向把命中点投影到 (u, v) 坐标, 与求逆矩阵的结果相同
+        Vec3 q = ray.at(tt) - p.position;
+        Vec3 n = glm::cross(p.u, p.v);
+        float invLen2 = 1.f / glm::dot(n, n);
+        float u = glm::dot(glm::cross(q, p.v), n) * invLen2;
+        float v = glm::dot(glm::cross(p.u, q), n) * invLen2;
         if ((u<=1 && u>=0) && (v<=1 && v>=0)) {
-            return getHitRecord(t, hitPoint, normal, p.material);
+            t = tt;
+            return true;
         }
-        return getMissRecord();
+        return false;
+    }
+
+    bool testMesh(const Ray& ray, const Mesh& m, float tMin, float tMax, float& t, unsigned int& face, float& b1, float& b2) {
+        bool hit = false;
+        float closest = tMax;
+        for (size_t i = 0; i + 2 < m.positionIndices.size(); i += 3) {
+            float tt, u, v;
+            if (testTriangle(ray,
+                m.positions[m.positionIndices[i]],
+                m.positions[m.positionIndices[i + 1]],
+                m.positions[m.positionIndices[i + 2]],
+                tMin, closest, tt, u, v)) {
+                closest = tt;
+                face = unsigned(i);
+                b1 = u;
+                b2 = v;
+                hit = true;
+            }
+        }
+        if (hit) t = closest;
+        return hit;
+    }
+
+    HitCandidate closestCandidate(const Ray& ray, const Scene& scene, float tMin, float tMax) {
+        HitCandidate c;
+        c.t = tMax;
+        using Kind = HitCandidate::Kind;
+        for (size_t i=0; i<scene.sphereBuffer.size(); i++) {
+            if (testSphere(ray, scene.sphereBuffer[i], tMin, c.t, c.t)) {
+                c.kind = Kind::SPHERE;
+                c.primitive = unsigned(i);
+            }
+        }
+        for (size_t i=0; i<scene.triangleBuffer.size(); i++) {
+            auto& tr = scene.triangleBuffer[i];
+            if (testTriangle(ray, tr.v1, tr.v2, tr.v3, tMin, c.t, c.t, c.b1, c.b2)) {
+                c.kind = Kind::TRIANGLE;
+                c.primitive = unsigned(i);
+            }
+        }
+        for (size_t i=0; i<scene.planeBuffer.size(); i++) {
+            if (testPlane(ray, scene.planeBuffer[i], tMin, c.t, c.t)) {
+                c.kind = Kind::PLANE;
+                c.primitive = unsigned(i);
+            }
+        }
+        for (size_t i=0; i<scene.meshBuffer.size(); i++) {
+            if (testMesh(ray, scene.meshBuffer[i], tMin, c.t, c.t, c.face, c.b1, c.b2)) {
+                c.kind = Kind::MESH;
+                c.primitive = unsigned(i);
+            }
+        }
+        return c;
+    }
+
+    HitRecord resolve(const Ray& ray, const Scene& scene, const HitCandidate& c) {
+        using Kind = HitCandidate::Kind;
+        switch (c.kind) {
+        case Kind::SPHERE: {
+            auto& s = scene.sphereBuffer[c.primitive];
+            auto hitPoint = ray.at(c.t);
+            auto normal = (hitPoint - s.position)/s.radius;
+            return getHitRecord(c.t, hitPoint, normal, s.material);
+        }
+        case Kind::TRIANGLE: {
+            auto& tr = scene.triangleBuffer[c.primitive];
+            return triangleRecord(ray, c.t, tr.v1, tr.v2, tr.v3, tr.normal, tr.n1, tr.n2, tr.n3, tr.material);
+        }
+        case Kind::PLANE: {
+            auto& p = scene.planeBuffer[c.primitive];
+            return getHitRecord(c.t, ray.at(c.t), glm::normalize(p.normal), p.material);
+        }
+        case Kind::MESH:
+            return meshRecord(ray, scene.meshBuffer[c.primitive], c.face, c.t);
+        default:
+            return getMissRecord();
+        }
+    }
+
+    HitRecord xTriangle(const Ray& ray, const Triangle& t, float tMin, float tMax) {
+        float w, u, v;
+        if (!testTriangle(ray, t.v1, t.v2, t.v3, tMin, tMax, w, u, v)) return getMissRecord();
+        return triangleRecord(ray, w, t.v1, t.v2, t.v3, t.normal, t.n1, t.n2, t.n3, t.material);
+    }
+    HitRecord xSphere(const Ray& ray, const Sphere& s, float tMin, float tMax) {
+        float t;
+        if (!testSphere(ray, s, tMin, tMax, t)) return getMissRecord();
+        auto hitPoint = ray.at(t);
+        auto normal = (hitPoint - s.position)/s.radius;
+        return getHitRecord(t, hitPoint, normal, s.material);
+    }
+    HitRecord xPlane(const Ray& ray, const Plane& p, float tMin, float tMax) {
+        float t;
+        if (!testPlane(ray, p, tMin, tMax, t)) return getMissRecord();
+        return getHitRecord(t, ray.at(t), glm::normalize(p.normal), p.material);
     }
     HitRecord xAreaLight(const Ray& ray, const AreaLight& a, float tMin, float tMax) {
         Vec3 normal = glm::cross(a.u, a.v);
@@ -96,31 +210,9 @@ namespace RayCast::Intersection
         return getMissRecord();
     }
     HitRecord xMesh(const Ray& ray, const Mesh& m, float tMin, float tMax) {
-        HitRecord closestHit = nullopt;
-        float closest = tMax;
-        for (size_t i = 0; i + 2 < m.positionIndices.size(); i += 3) {
-            Triangle t;
-            t.v1 = m.positions[m.positionIndices[i]];
-            t.v2 = m.positions[m.positionIndices[i + 1]];
-            t.v3 = m.positions[m.positionIndices[i + 2]];
-            t.material = m.material;
-            // 计算面法向量
-            Vec3 e1 = t.v2 - t.v1;
-            Vec3 e2 = t.v3 - t.v1;
-            t.normal = glm::normalize(glm::cross(e1, e2));
-            if (m.hasNormal() && (m.normalIndices.size() == m.positionIndices.size())) {
-                t.n1 = m.normals[m.normalIndices[i]];
-                t.n2 = m.normals[m.normalIndices[i + 1]];
-                t.n3 = m.normals[m.normalIndices[i + 2]];
-            } else {
-                t.n1 = t.n2 = t.n3 = t.normal;
-            }
-            auto hitRecord = xTriangle(ray, t, tMin, closest);
-            if (hitRecord && hitRecord->t < closest) {
-                closest = hitRecord->t;
-                closestHit = hitRecord;
-            }
-        }
-        return closestHit;
+        float t, u, v;
+        unsigned int face;
+        if (!testMesh(ray, m, tMin, tMax, t, face, u, v)) return getMissRecord();
+        return meshRecord(ray, m, face, t);
     }
-}
\ No newline at end of file
+}
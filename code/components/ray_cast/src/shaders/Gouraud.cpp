@@ -53,11 +53,14 @@ namespace RayCast
     RGB Gouraud::shadeVertex(const Vec3& vertexPos, const Vec3& vertexNormal, 
                             const Vec3& viewDir, const Vec3& lightPos, 
                             const Vec3& lightIntensity) const {
-        // Blinn-Phong光照模型（在顶点处计算）
+        // 最终颜色 = 环境光 + 漫反射 + 镜面反射
+        return shadeVertexDiffuse(vertexPos, vertexNormal, lightPos)
+            + shadeVertexSpecular(vertexPos, vertexNormal, viewDir, lightPos);
+    }
+
+    RGB Gouraud::shadeVertexDiffuse(const Vec3& vertexPos, const Vec3& vertexNormal, const Vec3& lightPos) const {
         Vec3 N = glm::normalize(vertexNormal);
         Vec3 L = glm::normalize(lightPos - vertexPos);  // 光源方向
-        Vec3 V = glm::normalize(viewDir);                // 视线方向
-        Vec3 H = glm::normalize(L + V);                  // 半程向量
         
         // 环境光
         Vec3 ambient = ambientColor;
@@ -65,13 +68,20 @@ namespace RayCast
         // 漫反射
         float NdotL = std::max(glm::dot(N, L), 0.0f);
         Vec3 diffuse = diffuseColor * NdotL;
+        return ambient + diffuse;
+    }
+
+    RGB Gouraud::shadeVertexSpecular(const Vec3& vertexPos, const Vec3& vertexNormal,
+                            const Vec3& viewDir, const Vec3& lightPos) const {
+        // Blinn-Phong光照模型（在顶点处计算）
+        Vec3 N = glm::normalize(vertexNormal);
+        Vec3 L = glm::normalize(lightPos - vertexPos);  // 光源方向
+        Vec3 V = glm::normalize(viewDir);                // 视线方向
+        Vec3 H = glm::normalize(L + V);                  // 半程向量
         
         // 镜面反射（Blinn-Phong）
         float NdotH = std::max(glm::dot(N, H), 0.0f);
-        Vec3 specular = specularColor * std::pow(NdotH, specularEx);
-        
-        // 最终颜色 = 环境光 + 漫反射 + 镜面反射
-        return ambient + diffuse + specular;
+        return specularColor * std::pow(NdotH, specularEx);
     }
 
     Vec3 Gouraud::computeBarycentricCoords(const Vec3& p, const Vec3& v1, const Vec3& v2, const Vec3& v3) const {
@@ -0,0 +1,175 @@
+#include "shaders/GouraudCache.hpp"
+
+#include <thread>
+#include <variant>
+#include <unordered_map>
+
+namespace RayCast
+{
+    namespace
+    {
+        // FNV-1a, 用于判断两次渲染之间光照相关的内容是否变化
+        struct Hasher
+        {
+            uint64_t h = 1469598103934665603ull;
+            void bytes(const void* p, size_t n) {
+                auto c = static_cast<const unsigned char*>(p);
+                for (size_t i=0; i<n; i++) {
+                    h ^= c[i];
+                    h *= 1099511628211ull;
+                }
+            }
+            void u(uint64_t v) { bytes(&v, sizeof(v)); }
+            void v3(const Vec3& v) { bytes(&v, sizeof(v)); }
+        };
+    }
+
+    GouraudCache& GouraudCache::instance() {
+        static GouraudCache c{};
+        return c;
+    }
+
+    uint64_t GouraudCache::hashLighting(const Scene& scene) const {
+        Hasher hs;
+        for (auto& m : scene.materials) {
+            hs.u(m.type);
+            for (auto& p : m.properties) {
+                hs.bytes(p.key.data(), p.key.size());
+                hs.u(uint64_t(p.type));
+                std::visit([&hs](const auto& w) { hs.bytes(&w.value, sizeof(w.value)); }, p.valueWrapper);
+            }
+        }
+        for (auto& l : scene.pointLightBuffer) {
+            hs.v3(l.position); hs.v3(l.intensity);
+        }
+        for (auto& t : scene.triangleBuffer) {
+            hs.v3(t.v1); hs.v3(t.v2); hs.v3(t.v3);
+            hs.v3(t.n1); hs.v3(t.n2); hs.v3(t.n3);
+            hs.u(t.material.getValue());
+        }
+        // 网格几何由 sameGeometry 按数据身份比较, 这里只记材质
+        for (auto& m : scene.meshBuffer) {
+            hs.u(m.material.getValue());
+        }
+        return hs.h;
+    }
+
+    bool GouraudCache::sameGeometry(const Scene& scene) const {
+        if (meshSources.size() != scene.meshBuffer.size()) return false;
+        for (size_t i=0; i<meshSources.size(); i++) {
+            auto& src = meshSources[i];
+            auto& m = scene.meshBuffer[i];
+            if (!src.positions.sameData(m.positions) || !src.normals.sameData(m.normals)
+                || !src.positionIndices.sameData(m.positionIndices) || !src.normalIndices.sameData(m.normalIndices)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void GouraudCache::update(const Scene& scene, const vector<SharedShader>& shaders) {
+        auto key = hashLighting(scene);
+        bool full = !valid || key != lightingKey || !sameGeometry(scene);
+        if (!full && viewPosition == scene.camera.position) return;
+        viewPosition = scene.camera.position;
+        if (full) {
+            collectVertices(scene);
+            meshSources.clear();
+            for (auto& m : scene.meshBuffer) {
+                meshSources.push_back({m.positions, m.normals, m.positionIndices, m.normalIndices});
+            }
+            diffuse.assign(scene.pointLightBuffer.size(), vector<RGB>(vertices.size(), RGB{0}));
+        }
+        specular.assign(scene.pointLightBuffer.size(), vector<RGB>(vertices.size(), RGB{0}));
+        compute(scene, shaders, full);
+        lightingKey = key;
+        valid = true;
+    }
+
+    void GouraudCache::collectVertices(const Scene& scene) {
+        vertices.clear();
+        meshOffset.clear();
+        cornerVertex.clear();
+        auto add = [this](const Vec3& position, const Vec3& normal, Handle material) {
+            cornerVertex.push_back(uint32_t(vertices.size()));
+            vertices.push_back({position, glm::normalize(normal), material});
+        };
+        for (auto& t : scene.triangleBuffer) {
+            add(t.v1, t.n1, t.material);
+            add(t.v2, t.n2, t.material);
+            add(t.v3, t.n3, t.material);
+        }
+        constexpr uint32_t none = ~uint32_t(0);
+        for (auto& m : scene.meshBuffer) {
+            meshOffset.push_back(cornerVertex.size());
+            if (!m.hasNormal() || m.normalIndices.size() != m.positionIndices.size()) {
+                for (size_t f=0; f+2<m.positionIndices.size(); f+=3) {
+                    const auto& v1 = m.positions[m.positionIndices[f]];
+                    const auto& v2 = m.positions[m.positionIndices[f + 1]];
+                    const auto& v3 = m.positions[m.positionIndices[f + 2]];
+                    Vec3 normal = glm::cross(v2 - v1, v3 - v1);
+                    add(v1, normal, m.material);
+                    add(v2, normal, m.material);
+                    add(v3, normal, m.material);
+                }
+                continue;
+            }
+            // 多数顶点只有一条法线, 直接按位置下标查; 硬边上的其余法线放进 split
+            vector<uint32_t> byPosition(m.positions.size(), none);
+            unordered_map<uint64_t, uint32_t> split;
+            for (size_t i=0; i<m.positionIndices.size(); i++) {
+                Index pi = m.positionIndices[i];
+                Vec3 normal = glm::normalize(m.normals[m.normalIndices[i]]);
+                uint32_t& id = byPosition[pi];
+                if (id == none) {
+                    id = uint32_t(vertices.size());
+                    vertices.push_back({m.positions[pi], normal, m.material});
+                }
+                else if (vertices[id].normal != normal) {
+                    auto [it, inserted] = split.try_emplace((uint64_t(pi) << 32) | m.normalIndices[i], uint32_t(vertices.size()));
+                    if (inserted) vertices.push_back({m.positions[pi], normal, m.material});
+                    cornerVertex.push_back(it->second);
+                    continue;
+                }
+                cornerVertex.push_back(id);
+            }
+        }
+    }
+
+    void GouraudCache::compute(const Scene& scene, const vector<SharedShader>& shaders, bool full) {
+        const size_t n = vertices.size();
+        auto task = [&](size_t off, size_t step) {
+            for (size_t v=off; v<n; v+=step) {
+                auto& vertex = vertices[v];
+                auto gouraud = dynamic_cast<const Gouraud*>(shaders[vertex.material.index()].get());
+                if (!gouraud) continue;
+                Vec3 viewDir = viewPosition - vertex.position;
+                for (size_t l=0; l<scene.pointLightBuffer.size(); l++) {
+                    auto& light = scene.pointLightBuffer[l];
+                    if (full) diffuse[l][v] = gouraud->shadeVertexDiffuse(vertex.position, vertex.normal, light.position);
+                    specular[l][v] = gouraud->shadeVertexSpecular(vertex.position, vertex.normal, viewDir, light.position);
+                }
+            }
+        };
+        const int taskNums = 8;
+        std::thread t[taskNums];
+        for (int i=0; i < taskNums; i++) {
+            t[i] = std::thread(task, size_t(i), size_t(taskNums));
+        }
+        for (int i=0; i < taskNums; i++) {
+            t[i].join();
+        }
+    }
+
+    size_t GouraudCache::corner(const HitCandidate& c, int k) const {
+        if (c.kind == HitCandidate::Kind::TRIANGLE) return size_t(c.primitive)*3 + k;
+        return meshOffset[c.primitive] + c.face + k;
+    }
+
+    RGB GouraudCache::shade(const HitCandidate& c, size_t light) const {
+        auto& d = diffuse[light];
+        auto& s = specular[light];
+        size_t i0 = cornerVertex[corner(c, 0)], i1 = cornerVertex[corner(c, 1)], i2 = cornerVertex[corner(c, 2)];
+        return (1.f - c.b1 - c.b2) * (d[i0] + s[i0]) + c.b1 * (d[i1] + s[i1]) + c.b2 * (d[i2] + s[i2]);
+    }
+}
@@ -4,12 +4,19 @@
 #define __PATH_TRACER_HPP__
 
 #include "scene/Scene.hpp"
+#include "server/FrameBuffer.hpp"
 #include "Ray.hpp"
 #include "Camera.hpp"
 #include "intersections/intersections.hpp"
 #include "VertexTransformer.hpp"
+#include "RenderContext.hpp"
+#include "LightTree.hpp"
+#include "Reservoir.hpp"
+#include "RadianceCache.hpp"
 
 #include <tuple>
+#include <vector>
+#include <functional>
 
 namespace RayCast
 {
@@ -26,8 +33,19 @@ namespace RayCast
         unsigned int height;
         unsigned int depth;
         unsigned int samples;
+        bool restir;
+        bool denoise;
+        bool useCache;
+        unsigned int cacheBounces;
+        unsigned int cacheCellPixels;
+        // 一个像素在单位距离处张开的宽度, 用来把格子的像素数换算成世界空间的边长
+        float pixelSpread = 0;
 
         Camera camera;
+        LightTree lights;
+        RadianceCache cache;
+        // 命中缓存后仍以该概率照常追踪并写回, 让格子里的估计继续收敛
+        static constexpr float cacheRefreshProbability = 0.1f;
     public:
         PathTracerRenderer(SharedScene spScene)
             : spScene               (spScene)
@@ -38,21 +56,49 @@ namespace RayCast
             height = scene.renderOption.height;
             depth = scene.renderOption.depth;
             samples = scene.renderOption.samplesPerPixel;
+            restir = scene.renderOption.restirDI;
+            denoise = scene.renderOption.denoise;
+            useCache = scene.renderOption.radianceCache;
+            cacheBounces = scene.renderOption.radianceCacheBounces;
+            cacheCellPixels = scene.renderOption.radianceCacheCellPixels;
         }
         ~PathTracerRenderer() = default;
 
-        using RenderResult = tuple<RGBA*, unsigned int, unsigned int>;
-        RenderResult render();
-        void release(const RenderResult& r);
+        // 输出线性 HDR 颜色、方差 (ReSTIR 模式下没有) 以及主命中点的反照率、法线与深度;
+        // 开启降噪时降噪前的颜色保存在 "color.noisy" 通道
+        void render(FrameBuffer& frame);
 
     private:
-        void renderTask(RGBA* pixels, int width, int height, int off, int step);
-        RGB gamma(const RGB& rgb);
-        RGB trace(const Ray& ray, int currDepth);
+        // ReSTIR 模式下像素主命中点的信息
+        struct Surface {
+            // 主命中点是漫反射面, 直接光照由蓄水池给出
+            bool valid = false;
+            Vec3 position;
+            Vec3 normal;
+            Vec3 albedo;
+            float depth = 0;
+            // 不经过蓄水池的部分: 直接看到的光源, 或漫反射面上的间接光
+            RGB base;
+        };
+        using TileTask = function<void(RenderContext&, int, int, int, int)>;
+        void forEachTile(vector<RenderContext>& contexts, const TileTask& task);
+        // color 为线性颜色, 按输出图像的像素顺序存放
+        void renderReSTIR(RGB* color, vector<RenderContext>& contexts);
+        void primaryReSTIR(RenderContext& ctx, int x, int y, Surface& surface, Reservoir& r);
+        // 光源样本对表面未考虑遮挡的贡献; 目标函数取它的三通道平均
+        RGB unshadowedContribution(const Surface& x, const LightSample& s) const;
+        float targetFunction(const Surface& x, const LightSample& s) const;
+        // 同时写出每个像素亮度均值的方差, 供降噪使用
+        void renderTile(RenderContext& ctx, RGB* color, float* variance, int x0, int y0, int x1, int y1);
+        // 像素中心的主命中点: 反照率、法线与距离, 未命中漫反射面时反照率为 1
+        void renderGBuffer(vector<RenderContext>& contexts, RGB* albedo, Vec3* normal, float* distance);
+        RGB trace(RenderContext& ctx, const Ray& ray, int currDepth);
         HitRecord closestHitObject(const Ray& r);
         tuple<float, Vec3> closestHitLight(const Ray& r);
+        // 由光源树选光源的直接光照估计, 返回 sum(Li * cos) / pmf 的平均, 不含 BRDF
+        Vec3 sampleDirect(RenderContext& ctx, const Vec3& origin, const Vec3& normal);
 
-        Vec3 sampleHemisphereUniform() const;
+        Vec3 sampleHemisphereUniform(RenderContext& ctx) const;
         Vec3 toWorld(const Vec3& n, const Vec3& local) const;
     };
 }
@@ -0,0 +1,51 @@
+#pragma once
+#ifndef __RADIANCE_CACHE_HPP__
+#define __RADIANCE_CACHE_HPP__
+
+#include "geometry/vec.hpp"
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+namespace RayCast
+{
+    using namespace NRenderer;
+    using namespace std;
+
+    // 世界空间的辐射度缓存: 命中点按量化后的位置与法线散列到格子里, 累加漫反射面的出射辐射度
+    //  - 格子边长取 2 的整数次幂, 由调用方按到相机的距离给出, 远处的格子更大
+    //  - 定长的开放寻址表, 插入与累加都是原子操作, 多线程不加锁; 探测不到空位时放弃记录
+    class RadianceCache
+    {
+    public:
+        // 格子里的样本数达到该值后才会被查询到
+        static constexpr uint32_t minSamples = 16;
+
+        // 清空并按至少 capacity 个格子分配
+        void reset(size_t capacity);
+        // size 为期望的格子边长; 格子样本不足时返回 false
+        bool lookup(const Vec3& p, const Vec3& n, float size, RGB& out) const;
+        void add(const Vec3& p, const Vec3& n, float size, const RGB& radiance);
+        size_t usedCells() const { return used.load(memory_order_relaxed); }
+
+    private:
+        struct Cell {
+            // 0 表示空位
+            atomic<uint64_t> key{0};
+            atomic<float> sum[3];
+            atomic<uint32_t> count{0};
+        };
+        static constexpr int maxProbes = 16;
+
+        unique_ptr<Cell[]> cells;
+        size_t mask = 0;
+        atomic<size_t> used{0};
+
+        static uint64_t hash(const Vec3& p, const Vec3& n, float size);
+        // 返回 key 所在的格子; insert 为 true 时在空位上占用, 找不到时返回 nullptr
+        Cell* find(uint64_t key, bool insert) const;
+    };
+}
+
+#endif
@@ -0,0 +1,81 @@
+#pragma once
+#ifndef __RENDER_CONTEXT_HPP__
+#define __RENDER_CONTEXT_HPP__
+
+#include "geometry/vec.hpp"
+#include "Ray.hpp"
+
+#include <memory>
+#include <random>
+#include <cstdint>
+
+namespace RayCast
+{
+    using namespace NRenderer;
+    using namespace std;
+
+    // 线性分配器: 构造时一次性申请内存, alloc 只移动偏移量, reset 后整块复用
+    class ScratchArena
+    {
+    private:
+        unique_ptr<unsigned char[]> buffer;
+        size_t capacity;
+        size_t offset;
+    public:
+        explicit ScratchArena(size_t capacity)
+            : buffer                (new unsigned char[capacity])
+            , capacity              (capacity)
+            , offset                (0)
+        {}
+
+        // 空间不足时返回 nullptr, 调用方需要自行处理
+        template<typename T>
+        T* alloc(size_t n) {
+            size_t align = alignof(T);
+            size_t start = (offset + align - 1) & ~(align - 1);
+            if (start + n*sizeof(T) > capacity) return nullptr;
+            offset = start + n*sizeof(T);
+            return reinterpret_cast<T*>(buffer.get() + start);
+        }
+        void reset() { offset = 0; }
+        size_t used() const { return offset; }
+    };
+
+    struct RenderStats
+    {
+        uint64_t primaryRays = 0;
+        uint64_t secondaryRays = 0;
+        uint64_t shadowRays = 0;
+        // 在辐射度缓存处结束的路径数
+        uint64_t cacheHits = 0;
+
+        void merge(const RenderStats& o) {
+            primaryRays += o.primaryRays;
+            secondaryRays += o.secondaryRays;
+            shadowRays += o.shadowRays;
+            cacheHits += o.cacheHits;
+        }
+    };
+
+    // 每个工作线程独占一个, 显式传入 trace; 内存都在构造时申请, 渲染循环中不再有堆分配
+    class RenderContext
+    {
+    public:
+        ScratchArena arena;
+        RenderStats stats;
+
+        RenderContext(uint32_t seed, size_t arenaBytes)
+            : arena                 (arenaBytes)
+            , rng                   (seed)
+            , dist                  (0.0f, 1.0f)
+        {}
+
+        float uniform() { return dist(rng); }
+
+    private:
+        std::mt19937 rng;
+        std::uniform_real_distribution<float> dist;
+    };
+}
+
+#endif
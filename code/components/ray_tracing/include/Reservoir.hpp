@@ -0,0 +1,55 @@
+#pragma once
+#ifndef __RESERVOIR_HPP__
+#define __RESERVOIR_HPP__
+
+#include "geometry/vec.hpp"
+#include "LightTree.hpp"
+
+namespace RayCast
+{
+    using namespace NRenderer;
+
+    // 光源上的一个点; 点光源与聚光灯的位置就是光源本身
+    struct LightSample
+    {
+        LightTree::Kind kind = LightTree::Kind::AREA;
+        size_t index = 0;
+        Vec3 position = {};
+    };
+
+    // 加权蓄水池 (ReSTIR): 流式地从候选中按权重保留一个样本
+    struct Reservoir
+    {
+        LightSample y;
+        float wSum = 0;
+        // 已经看过的候选数
+        float M = 0;
+        // y 在所属像素处的目标函数值
+        float pHat = 0;
+        // y 的贡献权重 wSum / (M * pHat), finalize 后有效
+        float W = 0;
+
+        // 以 w / wSum 的概率替换当前样本, u 为 [0, 1) 上的随机数
+        void update(const LightSample& s, float w, float p, float u) {
+            wSum += w;
+            M += 1;
+            if (w > 0 && u * wSum < w) {
+                y = s;
+                pHat = p;
+            }
+        }
+
+        // 合并另一个像素或上一轮的蓄水池; pHere 为 r.y 在本像素处重新计算的目标函数值
+        void merge(const Reservoir& r, float pHere, float u) {
+            float m = M + r.M;
+            update(r.y, pHere * r.W * r.M, pHere, u);
+            M = m;
+        }
+
+        void finalize() {
+            W = (M > 0 && pHat > 0) ? wSum / (M * pHat) : 0;
+        }
+    };
+}
+
+#endif
@@ -23,6 +23,22 @@ namespace RayCast
         array<Vec3, 3> normals = {};
     };
     using HitRecord = optional<HitRecordBase>;
+
+    // 遍历阶段的最近命中: 只有 t、图元编号与重心坐标, 不含任何向量, 确定最终命中后再展开成 HitRecord
+    struct HitCandidate
+    {
+        enum class Kind : unsigned char { NONE, SPHERE, TRIANGLE, PLANE, MESH };
+        float t;
+        Kind kind = Kind::NONE;
+        // 在对应 buffer 中的下标
+        unsigned int primitive = 0;
+        // 网格内命中三角形在 positionIndices 中的起始下标
+        unsigned int face = 0;
+        float b1 = 0.f;
+        float b2 = 0.f;
+
+        explicit operator bool() const { return kind != Kind::NONE; }
+    };
     inline
     HitRecord getMissRecord() {
         return nullopt;
@@ -15,6 +15,17 @@ namespace RayCast
         HitRecord xPlane(const Ray& ray, const Plane& p, float tMin = 0.f, float tMax = FLOAT_INF);
         HitRecord xAreaLight(const Ray& ray, const AreaLight& a, float tMin = 0.f, float tMax = FLOAT_INF);
         HitRecord xMesh(const Ray& ray, const Mesh& m, float tMin = 0.f, float tMax = FLOAT_INF);
+
+        // 轻量求交, 用于遍历: 只判断是否命中并写出 t (三角形额外写出重心坐标)
+        bool testTriangle(const Ray& ray, const Vec3& v1, const Vec3& v2, const Vec3& v3, float tMin, float tMax, float& t, float& b1, float& b2);
+        bool testSphere(const Ray& ray, const Sphere& s, float tMin, float tMax, float& t);
+        bool testPlane(const Ray& ray, const Plane& p, float tMin, float tMax, float& t);
+        bool testMesh(const Ray& ray, const Mesh& m, float tMin, float tMax, float& t, unsigned int& face, float& b1, float& b2);
+
+        // 遍历场景中的所有物体, 只保留最近命中的候选
+        HitCandidate closestCandidate(const Ray& ray, const Scene& scene, float tMin, float tMax = FLOAT_INF);
+        // 为最终命中重建命中点、法线与顶点数据
+        HitRecord resolve(const Ray& ray, const Scene& scene, const HitCandidate& c);
     }
 }
 
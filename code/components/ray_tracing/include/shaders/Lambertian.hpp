@@ -1,19 +0,0 @@
-#pragma once
-#ifndef __LAMBERTIAN_HPP__
-#define __LAMBERTIAN_HPP__
-
-#include "Shader.hpp"
-
-namespace RayCast
-{
-    class Lambertian : public Shader
-    {
-    private:
-        Vec3 diffuseColor;
-    public:
-        Lambertian(Material& material, vector<Texture>& textures);
-        virtual RGB shade(const Vec3& in, const Vec3& out, const Vec3& normal) const;
-    };
-}
-
-#endif
\ No newline at end of file
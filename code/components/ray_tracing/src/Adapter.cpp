@@ -13,10 +13,9 @@ namespace RayCast
     public:
         void render(SharedScene spScene) {
             PathTracerRenderer renderer{spScene};
-            auto result = renderer.render();
-            auto [ pixels, width, height ] = result;
-            getServer().screen.set(pixels, width, height);
-            renderer.release(result);
+            FrameBuffer frame{};
+            renderer.render(frame);
+            getServer().screen.set(frame);
         }
     };
 }
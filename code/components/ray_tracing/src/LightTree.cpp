@@ -0,0 +1,333 @@
+#include "LightTree.hpp"
+#include "intersections/intersections.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+namespace RayCast
+{
+    namespace
+    {
+        constexpr float PI = 3.1415926535898f;
+        // SAOH 每个轴上的分箱数
+        constexpr int lightBins = 12;
+        // 超过该深度后按中位数划分, 保证求交用的栈 (64) 不会溢出
+        constexpr int maxSAOHDepth = 32;
+
+        float safeSqrt(float x) { return sqrt(glm::max(0.f, x)); }
+
+        // cos(max(0, a - b)) 与 sin(max(0, a - b)), 角度以 sin/cos 给出
+        float cosSubClamped(float sinA, float cosA, float sinB, float cosB) {
+            if (cosA > cosB) return 1;
+            return cosA*cosB + sinA*sinB;
+        }
+        float sinSubClamped(float sinA, float cosA, float sinB, float cosB) {
+            if (cosA > cosB) return 0;
+            return sinA*cosB - cosA*sinB;
+        }
+
+        // 绕单位轴 k 旋转 theta (Rodrigues)
+        Vec3 rotate(const Vec3& v, const Vec3& k, float theta) {
+            float c = cos(theta), s = sin(theta);
+            return v*c + glm::cross(k, v)*s + k*glm::dot(k, v)*(1 - c);
+        }
+
+        float average(const Vec3& c) { return (c.x + c.y + c.z) / 3.f; }
+
+        bool hitBox(const Vec3& mn, const Vec3& mx, const Ray& r, float tMin, float tMax) {
+            for (int i = 0; i < 3; i++) {
+                float invD = 1.0f / r.direction[i];
+                float t0 = (mn[i] - r.origin[i]) * invD;
+                float t1 = (mx[i] - r.origin[i]) * invD;
+                if (invD < 0.0f) std::swap(t0, t1);
+                tMin = t0 > tMin ? t0 : tMin;
+                tMax = t1 < tMax ? t1 : tMax;
+                if (tMax < tMin) return false;
+            }
+            return true;
+        }
+    }
+
+    float LightTree::spotFalloff(const SpotLight& s, const Vec3& w) {
+        float cosTheta = glm::dot(glm::normalize(s.direction), w);
+        float cosStart = cos(glm::min(s.hotSpot, s.fallout));
+        float cosEnd = cos(s.fallout);
+        if (cosTheta >= cosStart) return 1;
+        if (cosTheta <= cosEnd) return 0;
+        float x = (cosTheta - cosEnd) / (cosStart - cosEnd);
+        return x*x*(3 - 2*x);
+    }
+
+    LightTree::Bounds LightTree::unite(const Bounds& a, const Bounds& b) {
+        if (a.min.x > a.max.x) return b;
+        if (b.min.x > b.max.x) return a;
+        Bounds r;
+        r.min = glm::min(a.min, b.min);
+        r.max = glm::max(a.max, b.max);
+        r.power = a.power + b.power;
+        r.cosThetaE = glm::min(a.cosThetaE, b.cosThetaE);
+        // 方向锥的并: 一个锥包含另一个时直接取大的, 否则取同时覆盖两者的最小锥
+        float thetaA = acos(glm::clamp(a.cosThetaO, -1.f, 1.f));
+        float thetaB = acos(glm::clamp(b.cosThetaO, -1.f, 1.f));
+        float thetaD = acos(glm::clamp(glm::dot(a.axis, b.axis), -1.f, 1.f));
+        if (glm::min(thetaD + thetaB, PI) <= thetaA) {
+            r.axis = a.axis;
+            r.cosThetaO = a.cosThetaO;
+        }
+        else if (glm::min(thetaD + thetaA, PI) <= thetaB) {
+            r.axis = b.axis;
+            r.cosThetaO = b.cosThetaO;
+        }
+        else {
+            float thetaO = (thetaA + thetaD + thetaB) * 0.5f;
+            Vec3 k = glm::cross(a.axis, b.axis);
+            if (thetaO >= PI || glm::dot(k, k) < 1e-12f) {
+                r.axis = a.axis;
+                r.cosThetaO = -1;
+            }
+            else {
+                r.axis = glm::normalize(rotate(a.axis, glm::normalize(k), thetaO - thetaA));
+                r.cosThetaO = cos(thetaO);
+            }
+        }
+        return r;
+    }
+
+    float LightTree::orientationMeasure(const Bounds& b) {
+        float thetaO = acos(glm::clamp(b.cosThetaO, -1.f, 1.f));
+        float thetaE = acos(glm::clamp(b.cosThetaE, -1.f, 1.f));
+        float thetaW = glm::min(thetaO + thetaE, PI);
+        float sinO = sin(thetaO);
+        return 2*PI*(1 - b.cosThetaO)
+            + PI/2*(2*thetaW*sinO - cos(thetaO - 2*thetaW) - 2*thetaO*sinO + b.cosThetaO);
+    }
+
+    float LightTree::importance(const Bounds& b, const Vec3& p, const Vec3& n) {
+        Vec3 center = (b.min + b.max) * 0.5f;
+        Vec3 d = p - center;
+        float dist2 = glm::dot(d, d);
+        float r2 = glm::dot(b.max - b.min, b.max - b.min) * 0.25f;
+        // 着色点离包围盒很近时用盒子的尺寸限制距离, 避免 1/d² 发散
+        float d2 = glm::max(glm::max(dist2, r2), 1e-8f);
+        Vec3 wi = dist2 > 0 ? d / sqrt(dist2) : b.axis;
+
+        // 着色点相对光源的方向与锥轴的夹角 thetaW, 包围球对着色点张开的半角 thetaB
+        float cosW = glm::dot(b.axis, wi);
+        float sinW = safeSqrt(1 - cosW*cosW);
+        float cosB = dist2 < r2 ? -1.f : safeSqrt(1 - r2/dist2);
+        float sinB = safeSqrt(1 - cosB*cosB);
+        float sinO = safeSqrt(1 - b.cosThetaO*b.cosThetaO);
+        // 最有利情况下的出射角 theta' = max(0, thetaW - thetaO - thetaB), 超出 thetaE 则没有贡献
+        float cosX = cosSubClamped(sinW, cosW, sinO, b.cosThetaO);
+        float sinX = sinSubClamped(sinW, cosW, sinO, b.cosThetaO);
+        float cosP = cosSubClamped(sinX, cosX, sinB, cosB);
+        if (cosP <= b.cosThetaE) return 0;
+        float result = b.power * cosP / d2;
+        // 着色面只接收正面的光照
+        if (n != Vec3{0}) {
+            float cosI = -glm::dot(wi, n);
+            float sinI = safeSqrt(1 - cosI*cosI);
+            result *= glm::max(0.f, cosSubClamped(sinI, cosI, sinB, cosB));
+        }
+        return glm::max(result, 0.f);
+    }
+
+    void LightTree::build(const Scene& scn) {
+        scene = &scn;
+        nodes.clear();
+        vector<Ref> refs;
+        for (size_t i = 0; i < scn.areaLightBuffer.size(); i++) {
+            auto& a = scn.areaLightBuffer[i];
+            Vec3 c = glm::cross(a.u, a.v);
+            float area = glm::length(c);
+            if (area <= 0) continue;
+            Bounds b;
+            for (auto& corner : {a.position, a.position + a.u, a.position + a.v, a.position + a.u + a.v}) {
+                b.min = glm::min(b.min, corner);
+                b.max = glm::max(b.max, corner);
+            }
+            // 面光源的包围盒在法线方向上没有厚度, 稍微放大以免光线求交时出现 0 * inf
+            Vec3 pad = (b.max - b.min) * 1e-4f + Vec3{1e-6f};
+            b.min -= pad;
+            b.max += pad;
+            b.axis = c / area;
+            b.cosThetaO = 1;
+            b.cosThetaE = 0;
+            b.power = average(a.radiance) * area * PI;
+            refs.push_back({b, Kind::AREA, i});
+        }
+        for (size_t i = 0; i < scn.pointLightBuffer.size(); i++) {
+            auto& l = scn.pointLightBuffer[i];
+            Bounds b;
+            b.min = b.max = l.position;
+            b.cosThetaO = -1;
+            b.cosThetaE = 0;
+            b.power = average(l.intensity) * 4 * PI;
+            refs.push_back({b, Kind::POINT, i});
+        }
+        for (size_t i = 0; i < scn.spotLightBuffer.size(); i++) {
+            auto& s = scn.spotLightBuffer[i];
+            if (glm::dot(s.direction, s.direction) <= 0) continue;
+            float thetaO = glm::min(s.hotSpot, s.fallout);
+            Bounds b;
+            b.min = b.max = s.position;
+            b.axis = glm::normalize(s.direction);
+            b.cosThetaO = cos(thetaO);
+            b.cosThetaE = cos(glm::min(s.fallout - thetaO, PI));
+            b.power = average(s.intensity) * 2 * PI * (1 - cos(s.fallout));
+            refs.push_back({b, Kind::SPOT, i});
+        }
+        // 功率为 0 的光源永远不会被选中, 不放进树里
+        refs.erase(std::remove_if(refs.begin(), refs.end(), [](const Ref& r) { return r.bounds.power <= 0; }), refs.end());
+        lightCount = refs.size();
+        if (refs.empty()) return;
+        nodes.reserve(refs.size() * 2);
+        buildRecursive(refs, 0, refs.size(), 0);
+    }
+
+    int LightTree::buildRecursive(vector<Ref>& refs, int start, int end, int depth) {
+        int idx = nodes.size();
+        nodes.push_back(Node{});
+        Bounds total;
+        Vec3 cmin{FLOAT_INF}, cmax{-FLOAT_INF};
+        for (int i = start; i < end; i++) {
+            total = unite(total, refs[i].bounds);
+            Vec3 c = (refs[i].bounds.min + refs[i].bounds.max) * 0.5f;
+            cmin = glm::min(cmin, c);
+            cmax = glm::max(cmax, c);
+        }
+        nodes[idx].bounds = total;
+        if (end - start == 1) {
+            nodes[idx].kind = refs[start].kind;
+            nodes[idx].index = refs[start].index;
+            return idx;
+        }
+
+        auto binOf = [&](const Ref& r, int axis) {
+            float c = (r.bounds.min[axis] + r.bounds.max[axis]) * 0.5f;
+            float extent = cmax[axis] - cmin[axis];
+            return glm::clamp(int((c - cmin[axis]) / extent * lightBins), 0, lightBins - 1);
+        };
+        // SAOH: 功率 * 方向锥度量 * 表面积; 细长的盒子沿短轴划分时加以惩罚
+        auto cost = [](const Bounds& b, float kr) {
+            Vec3 d = b.max - b.min;
+            float area = 2.f*(d.x*d.y + d.y*d.z + d.z*d.x);
+            return b.power * orientationMeasure(b) * area * kr;
+        };
+        int bestAxis = -1, bestBin = 0;
+        float bestCost = FLOAT_INF;
+        Vec3 diag = total.max - total.min;
+        float maxExtent = glm::max(diag.x, glm::max(diag.y, diag.z));
+        for (int axis = 0; axis < 3 && depth < maxSAOHDepth; axis++) {
+            if (cmax[axis] <= cmin[axis]) continue;
+            Bounds bins[lightBins];
+            for (int i = start; i < end; i++) {
+                int b = binOf(refs[i], axis);
+                bins[b] = unite(bins[b], refs[i].bounds);
+            }
+            float kr = diag[axis] > 0 ? maxExtent / diag[axis] : 1.f;
+            for (int s = 1; s < lightBins; s++) {
+                Bounds left, right;
+                for (int b = 0; b < s; b++) left = unite(left, bins[b]);
+                for (int b = s; b < lightBins; b++) right = unite(right, bins[b]);
+                if (left.power <= 0 || right.power <= 0) continue;
+                float c = cost(left, kr) + cost(right, kr);
+                if (c < bestCost) {
+                    bestCost = c;
+                    bestAxis = axis;
+                    bestBin = s;
+                }
+            }
+        }
+
+        int mid = start;
+        if (bestAxis >= 0) {
+            mid = std::partition(refs.begin() + start, refs.begin() + end,
+                [&](const Ref& r) { return binOf(r, bestAxis) < bestBin; }) - refs.begin();
+        }
+        if (mid == start || mid == end) {
+            // 质心重合或过深时按最长轴中位数划分
+            int axis = 0;
+            if (diag.y > diag[axis]) axis = 1;
+            if (diag.z > diag[axis]) axis = 2;
+            mid = (start + end) / 2;
+            std::nth_element(refs.begin() + start, refs.begin() + mid, refs.begin() + end,
+                [axis](const Ref& a, const Ref& b) {
+                    return a.bounds.min[axis] + a.bounds.max[axis] < b.bounds.min[axis] + b.bounds.max[axis];
+                });
+        }
+        buildRecursive(refs, start, mid, depth + 1);
+        int right = buildRecursive(refs, mid, end, depth + 1);
+        nodes[idx].right = right;
+        return idx;
+    }
+
+    bool LightTree::sample(const Vec3& p, const Vec3& n, float u, Selection& out) const {
+        sample(p, n, &u, 1, &out);
+        return out.pmf > 0;
+    }
+
+    void LightTree::sample(const Vec3& p, const Vec3& n, float* u, int count, Selection* out) const {
+        for (int i = 0; i < count; i++) out[i].pmf = 0;
+        if (nodes.empty()) return;
+        // 升序的 u 在每个节点上分成左右两段, 一段内的样本走同一条路径, 节点的重要性只算一次
+        struct Task {
+            int node;
+            int begin, end;
+            float pmf;
+        };
+        Task stack[64];
+        int stackPtr = 0;
+        stack[stackPtr++] = {0, 0, count, 1.f};
+        while (stackPtr > 0) {
+            Task t = stack[--stackPtr];
+            auto& node = nodes[t.node];
+            if (node.isLeaf()) {
+                // 叶子本身不再检查: 照不到着色点的光源由调用方的朝向判断排除, 结果仍然无偏
+                for (int i = t.begin; i < t.end; i++) out[i] = {node.kind, node.index, t.pmf};
+                continue;
+            }
+            int left = t.node + 1;
+            float wl = importance(nodes[left].bounds, p, n);
+            float wr = importance(nodes[node.right].bounds, p, n);
+            if (!(wl + wr > 0)) continue;
+            float pl = wl / (wl + wr);
+            // 复用 u 的剩余部分继续往下选, 映射是单调的, 两段内仍然有序
+            int mid = t.begin;
+            while (mid < t.end && u[mid] < pl) {
+                u[mid] = glm::min(u[mid] / pl, 0.99999994f);
+                mid++;
+            }
+            for (int i = mid; i < t.end; i++) u[i] = glm::min((u[i] - pl) / (1 - pl), 0.99999994f);
+            if (mid < t.end) stack[stackPtr++] = {node.right, mid, t.end, t.pmf * (1 - pl)};
+            if (t.begin < mid) stack[stackPtr++] = {left, t.begin, mid, t.pmf * pl};
+        }
+    }
+
+    int LightTree::closestAreaLight(const Ray& r, float tMin, float tMax, float& t) const {
+        t = tMax;
+        if (nodes.empty()) return -1;
+        int hit = -1;
+        int stack[64];
+        int stackPtr = 0;
+        stack[stackPtr++] = 0;
+        while (stackPtr > 0) {
+            int idx = stack[--stackPtr];
+            auto& node = nodes[idx];
+            if (!hitBox(node.bounds.min, node.bounds.max, r, tMin, t)) continue;
+            if (node.isLeaf()) {
+                if (node.kind != Kind::AREA) continue;
+                auto h = Intersection::xAreaLight(r, scene->areaLightBuffer[node.index], tMin, t);
+                if (h && h->t < t) {
+                    t = h->t;
+                    hit = int(node.index);
+                }
+            }
+            else {
+                stack[stackPtr++] = node.right;
+                stack[stackPtr++] = idx + 1;
+            }
+        }
+        return hit;
+    }
+}
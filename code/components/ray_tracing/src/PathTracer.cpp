@@ -1,26 +1,23 @@
 // d:\study\computer_graph\nrenderer-master\code\components\ray_tracing\src\PathTracer.cpp
 #include "PathTracer.hpp"
+#include "server/Server.hpp"
 
 #include <thread>
+#include <atomic>
 #include <random>
+#include <algorithm>
 #include "glm/gtc/matrix_transform.hpp"
 
 namespace RayCast
 {
-    RGB PathTracerRenderer::gamma(const RGB& rgb) {
-        return glm::sqrt(rgb);
+    namespace
+    {
+        constexpr int tileSize = 16;
     }
 
-    void PathTracerRenderer::release(const RenderResult& r) {
-        auto [p, w, h] = r;
-        delete[] p;
-    }
-
-    Vec3 PathTracerRenderer::sampleHemisphereUniform() const {
-        thread_local static std::mt19937 rng{std::random_device{}()};
-        thread_local static std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-        float z = dist(rng);
-        float phi = 6.283185307179586f * dist(rng);
+    Vec3 PathTracerRenderer::sampleHemisphereUniform(RenderContext& ctx) const {
+        float z = ctx.uniform();
+        float phi = 6.283185307179586f * ctx.uniform();
         float r = sqrt(glm::max(0.0f, 1.0f - z*z));
         return {r * cos(phi), r * sin(phi), z};
     }
@@ -33,81 +30,387 @@ namespace RayCast
         return local.x * u + local.y * v + local.z * w;
     }
 
-    void PathTracerRenderer::renderTask(RGBA* pixels, int width, int height, int off, int step) {
-        thread_local static std::mt19937 rng{std::random_device{}()};
-        thread_local static std::uniform_real_distribution<float> dist(0.0f, 1.0f);
-        for(int i=off; i<height; i+=step) {
-            for (int j=0; j<width; j++) {
-                Vec3 color{0, 0, 0};
-                for (int k=0; k<samples; k++) {
-                    float rx = dist(rng);
-                    float ry = dist(rng);
+    void PathTracerRenderer::renderTile(RenderContext& ctx, RGB* color, float* variance, int x0, int y0, int x1, int y1) {
+        // 累加缓冲取自 arena, 按样本优先的顺序遍历 tile, 最后统一求平均
+        int tw = x1 - x0;
+        int th = y1 - y0;
+        RGB* accum = ctx.arena.alloc<RGB>(tw*th);
+        float* accumSq = ctx.arena.alloc<float>(tw*th);
+        for (int p=0; p<tw*th; p++) {
+            accum[p] = Vec3{0};
+            accumSq[p] = 0;
+        }
+        for (int k=0; k<samples; k++) {
+            for (int i=y0; i<y1; i++) {
+                for (int j=x0; j<x1; j++) {
+                    float rx = ctx.uniform();
+                    float ry = ctx.uniform();
                     float x = (float(j)+rx)/float(width);
                     float y = (float(i)+ry)/float(height);
                     auto ray = camera.shoot(x, y);
-                    color += trace(ray, 0);
+                    RGB c = trace(ctx, ray, 0);
+                    float l = 0.2126f*c.r + 0.7152f*c.g + 0.0722f*c.b;
+                    accum[(i-y0)*tw + (j-x0)] += c;
+                    accumSq[(i-y0)*tw + (j-x0)] += l*l;
+                }
+            }
+        }
+        for (int i=y0; i<y1; i++) {
+            for (int j=x0; j<x1; j++) {
+                Vec3 mean = accum[(i-y0)*tw + (j-x0)] / float(samples);
+                float l = 0.2126f*mean.r + 0.7152f*mean.g + 0.0722f*mean.b;
+                color[(height-i-1)*width+j] = mean;
+                variance[(height-i-1)*width+j] = glm::max(0.f, accumSq[(i-y0)*tw + (j-x0)] / float(samples) - l*l) / float(samples);
+            }
+        }
+    }
+
+    void PathTracerRenderer::renderGBuffer(vector<RenderContext>& contexts, RGB* albedo, Vec3* normal, float* distance) {
+        forEachTile(contexts, [&](RenderContext& ctx, int x0, int y0, int x1, int y1) {
+            for (int i=y0; i<y1; i++) {
+                for (int j=x0; j<x1; j++) {
+                    size_t p = size_t(height-i-1)*width + j;
+                    albedo[p] = RGB{1};
+                    normal[p] = Vec3{0};
+                    distance[p] = 0;
+                    auto ray = camera.shoot((float(j) + 0.5f)/float(width), (float(i) + 0.5f)/float(height));
+                    auto hitObject = closestHitObject(ray);
+                    auto [tLight, emitted] = closestHitLight(ray);
+                    if (hitObject && hitObject->t < tLight) {
+                        auto diffuseColor = scene.materials[hitObject->material.index()].getProperty<Property::Wrapper::RGBType>("diffuseColor");
+                        if (diffuseColor) albedo[p] = (*diffuseColor).value;
+                        normal[p] = hitObject->normal;
+                        distance[p] = hitObject->t;
+                    }
+                    else if (tLight != FLOAT_INF) {
+                        normal[p] = -ray.direction;
+                        distance[p] = tLight;
+                    }
                 }
-                color /= float(samples);
-                color = gamma(color);
-                pixels[(height-i-1)*width+j] = {color, 1};
             }
+        });
+    }
+
+    void PathTracerRenderer::forEachTile(vector<RenderContext>& contexts, const TileTask& task) {
+        // 按 tile 动态分配给工作线程, 每个线程持有自己的 RenderContext, arena 每个 tile 重置一次
+        const int tilesX = (width + tileSize - 1) / tileSize;
+        const int tilesY = (height + tileSize - 1) / tileSize;
+        std::atomic<int> nextTile{0};
+        vector<std::thread> t;
+        for (auto& ctx : contexts) {
+            t.emplace_back([&]() {
+                for (int tile = nextTile++; tile < tilesX*tilesY; tile = nextTile++) {
+                    ctx.arena.reset();
+                    int x0 = (tile % tilesX) * tileSize;
+                    int y0 = (tile / tilesX) * tileSize;
+                    task(ctx, x0, y0, glm::min<int>(x0 + tileSize, width), glm::min<int>(y0 + tileSize, height));
+                }
+            });
         }
+        for (auto& th : t) th.join();
     }
 
-    auto PathTracerRenderer::render() -> RenderResult {
+    void PathTracerRenderer::render(FrameBuffer& frame) {
         VertexTransformer vertexTransformer{};
         vertexTransformer.exec(spScene);
+        lights.build(scene);
 
-        RGBA* pixels = new RGBA[width*height]{};
+        const size_t n = size_t(width)*height;
+        frame.resize(width, height);
+        // 通道都在分发 tile 之前分配好, 各线程只按 tile 写入自己的区域
+        RGB* color = frame.float3(FrameBuffer::COLOR);
+        float* variance = restir ? nullptr : frame.float1(FrameBuffer::VARIANCE);
+        RGB* albedo = frame.float3(FrameBuffer::ALBEDO);
+        Vec3* normal = frame.float3(FrameBuffer::NORMAL);
+        float* distance = frame.float1(FrameBuffer::DEPTH);
+
+        if (useCache) {
+            cache.reset(size_t(width)*height*2);
+            pixelSpread = 2.f * tan(glm::radians(scene.camera.fov) / 2.f) / float(height);
+        }
 
         const int taskNums = 8;
-        std::thread t[taskNums];
+        vector<RenderContext> contexts;
+        contexts.reserve(taskNums);
         for (int i=0; i < taskNums; i++) {
-            t[i] = std::thread(&PathTracerRenderer::renderTask, this, pixels, width, height, i, taskNums);
+            contexts.emplace_back(std::random_device{}(), tileSize*tileSize*(sizeof(RGB) + sizeof(float)));
         }
-        for (int i=0; i < taskNums; i++) {
-            t[i].join();
+        if (restir) {
+            renderReSTIR(color, contexts);
+        }
+        else {
+            forEachTile(contexts, [&](RenderContext& ctx, int x0, int y0, int x1, int y1) {
+                renderTile(ctx, color, variance, x0, y0, x1, y1);
+            });
+        }
+        renderGBuffer(contexts, albedo, normal, distance);
+        if (denoise) {
+            RGB* noisy = frame.float3("color.noisy");
+            std::copy(color, color + n, noisy);
+            DenoiseInput input{};
+            input.color = noisy;
+            input.albedo = albedo;
+            input.normal = normal;
+            input.depth = distance;
+            // ReSTIR 的各轮之间有相关性, 逐像素方差不可靠, 交给降噪器按邻域估计
+            input.variance = variance;
+            input.width = width;
+            input.height = height;
+            getServer().denoiser.denoise(input, color, DenoiseOptions{});
+        }
+        RenderStats total{};
+        for (auto& ctx : contexts) total.merge(ctx.stats);
+        getServer().logger.log("Light tree: " + to_string(lights.size()) + " lights, " + to_string(lights.nodeCount()) + " nodes.");
+        getServer().logger.log("Rays: " + to_string(total.primaryRays) + " primary, "
+            + to_string(total.secondaryRays) + " secondary, " + to_string(total.shadowRays) + " shadow.");
+        if (useCache) {
+            getServer().logger.log("Radiance cache: " + to_string(cache.usedCells()) + " cells, "
+                + to_string(total.cacheHits) + " hits.");
         }
-        return {pixels, width, height};
     }
 
-    HitRecord PathTracerRenderer::closestHitObject(const Ray& r) {
-        HitRecord closestHit = nullopt;
-        float closest = FLOAT_INF;
-        for (auto& s : scene.sphereBuffer) {
-            auto hitRecord = Intersection::xSphere(r, s, 0.000001f, closest);
-            if (hitRecord && hitRecord->t < closest) { closest = hitRecord->t; closestHit = hitRecord; }
+    RGB PathTracerRenderer::unshadowedContribution(const Surface& x, const LightSample& s) const {
+        Vec3 d = s.position - x.position;
+        float dist2 = glm::dot(d, d);
+        if (dist2 <= 0) return RGB{0};
+        Vec3 out = d / sqrt(dist2);
+        float cosS = glm::dot(out, x.normal);
+        if (cosS <= 0) return RGB{0};
+        RGB Le;
+        float cosL = 1.f;
+        if (s.kind == LightTree::Kind::AREA) {
+            auto& a = scene.areaLightBuffer[s.index];
+            cosL = glm::dot(glm::normalize(glm::cross(a.u, a.v)), -out);
+            if (cosL <= 0) return RGB{0};
+            Le = a.radiance;
+        }
+        else if (s.kind == LightTree::Kind::POINT) {
+            Le = scene.pointLightBuffer[s.index].intensity;
+        }
+        else {
+            auto& l = scene.spotLightBuffer[s.index];
+            Le = l.intensity * LightTree::spotFalloff(l, -out);
+        }
+        return (x.albedo / 3.1415926535898f) * Le * (cosS * cosL / dist2);
+    }
+
+    float PathTracerRenderer::targetFunction(const Surface& x, const LightSample& s) const {
+        RGB c = unshadowedContribution(x, s);
+        return (c.x + c.y + c.z) / 3.f;
+    }
+
+    void PathTracerRenderer::primaryReSTIR(RenderContext& ctx, int x, int y, Surface& surface, Reservoir& r) {
+        surface = Surface{};
+        r = Reservoir{};
+        auto ray = camera.shoot((float(x) + ctx.uniform())/float(width), (float(y) + ctx.uniform())/float(height));
+        if (depth == 0) {
+            surface.base = scene.ambient.constant;
+            return;
         }
-        for (auto& t : scene.triangleBuffer) {
-            auto hitRecord = Intersection::xTriangle(r, t, 0.000001f, closest);
-            if (hitRecord && hitRecord->t < closest) { closest = hitRecord->t; closestHit = hitRecord; }
+        ctx.stats.primaryRays++;
+        auto hitObject = closestHitObject(ray);
+        auto [tLight, emitted] = closestHitLight(ray);
+        if (!hitObject || hitObject->t >= tLight) {
+            surface.base = tLight != FLOAT_INF ? emitted : Vec3{0};
+            return;
         }
-        for (auto& p : scene.planeBuffer) {
-            auto hitRecord = Intersection::xPlane(r, p, 0.000001f, closest);
-            if (hitRecord && hitRecord->t < closest) { closest = hitRecord->t; closestHit = hitRecord; }
+        auto& mtl = scene.materials[hitObject->material.index()];
+        using PW = Property::Wrapper;
+        auto diffuseColor = mtl.getProperty<PW::RGBType>("diffuseColor");
+        Vec3 albedo = diffuseColor ? (*diffuseColor).value : Vec3{1, 1, 1};
+        Vec3 origin = hitObject->hitPoint + 0.0001f * hitObject->normal;
+
+        // 间接光与 trace 相同, 只有主命中点的直接光照改由蓄水池给出
+        Vec3 direction = glm::normalize(toWorld(hitObject->normal, sampleHemisphereUniform(ctx)));
+        float pdf = 1.0f/(2.0f*3.1415926535898f);
+        auto next = trace(ctx, Ray{origin, direction}, 1);
+        surface.base = (albedo / 3.1415926535898f) * next * glm::dot(hitObject->normal, direction) / pdf;
+        if (!diffuseColor || lights.size() == 0) return;
+
+        surface.valid = true;
+        surface.position = origin;
+        surface.normal = hitObject->normal;
+        surface.albedo = albedo;
+        surface.depth = hitObject->t;
+
+        // 候选由光源树按重要性选光源、在面光源上均匀取点, 用未考虑遮挡的贡献重采样, 不追踪阴影光线
+        const int candidates = 32;
+        float u[candidates];
+        for (int i=0; i<candidates; i++) u[i] = (i + ctx.uniform()) / float(candidates);
+        LightTree::Selection selected[candidates];
+        lights.sample(origin, surface.normal, u, candidates, selected);
+        for (auto& sel : selected) {
+            if (sel.pmf <= 0) {
+                r.update({}, 0, 0, 0);
+                continue;
+            }
+            LightSample s{sel.kind, sel.index, {}};
+            float sourcePdf = sel.pmf;
+            if (sel.kind == LightTree::Kind::AREA) {
+                auto& a = scene.areaLightBuffer[sel.index];
+                s.position = a.position + ctx.uniform()*a.u + ctx.uniform()*a.v;
+                sourcePdf /= glm::length(glm::cross(a.u, a.v));
+            }
+            else if (sel.kind == LightTree::Kind::POINT) {
+                s.position = scene.pointLightBuffer[sel.index].position;
+            }
+            else {
+                s.position = scene.spotLightBuffer[sel.index].position;
+            }
+            float p = targetFunction(surface, s);
+            r.update(s, p / sourcePdf, p, ctx.uniform());
         }
-        for (auto& m : scene.meshBuffer) {
-            auto hitRecord = Intersection::xMesh(r, m, 0.000001f, closest);
-            if (hitRecord && hitRecord->t < closest) { closest = hitRecord->t; closestHit = hitRecord; }
+        r.finalize();
+    }
+
+    void PathTracerRenderer::renderReSTIR(RGB* color, vector<RenderContext>& contexts) {
+        // 每个像素每轮 (一个 spp) 分三步:
+        //  1. 主命中点生成候选, 与上一轮同一像素的蓄水池合并
+        //  2. 与几个几何相近的邻近像素的蓄水池合并
+        //  3. 只对最终选中的样本追踪一条阴影光线; 被遮挡的样本权重清零后再传给下一轮
+        // 合并时没有考虑邻近像素处的可见性, 在阴影边界附近略有偏差
+        const int spatialNeighbors = 4;
+        const float spatialRadius = 16.f;
+        // 上一轮的蓄水池最多当作这么多个候选, 避免旧样本一直占优
+        const float temporalMaxM = 20.f * 32.f;
+        const size_t n = size_t(width)*height;
+        vector<Surface> surfaces(n);
+        vector<Reservoir> current(n), reused(n), previous(n);
+        vector<RGB> accum(n, RGB{0});
+
+        for (unsigned int pass=0; pass<samples; pass++) {
+            forEachTile(contexts, [&](RenderContext& ctx, int x0, int y0, int x1, int y1) {
+                for (int i=y0; i<y1; i++) {
+                    for (int j=x0; j<x1; j++) {
+                        size_t p = size_t(i)*width + j;
+                        primaryReSTIR(ctx, j, i, surfaces[p], current[p]);
+                        if (pass == 0 || !surfaces[p].valid || previous[p].M <= 0) continue;
+                        Reservoir prev = previous[p];
+                        prev.M = glm::min(prev.M, temporalMaxM);
+                        current[p].merge(prev, targetFunction(surfaces[p], prev.y), ctx.uniform());
+                        current[p].finalize();
+                    }
+                }
+            });
+            forEachTile(contexts, [&](RenderContext& ctx, int x0, int y0, int x1, int y1) {
+                for (int i=y0; i<y1; i++) {
+                    for (int j=x0; j<x1; j++) {
+                        size_t p = size_t(i)*width + j;
+                        auto& surface = surfaces[p];
+                        Reservoir r = current[p];
+                        if (surface.valid) {
+                            for (int k=0; k<spatialNeighbors; k++) {
+                                float radius = spatialRadius * sqrt(ctx.uniform());
+                                float phi = 6.283185307179586f * ctx.uniform();
+                                int nx = j + int(radius * cos(phi));
+                                int ny = i + int(radius * sin(phi));
+                                if (nx < 0 || ny < 0 || nx >= int(width) || ny >= int(height)) continue;
+                                size_t q = size_t(ny)*width + nx;
+                                auto& other = surfaces[q];
+                                if (q == p || !other.valid) continue;
+                                // 法线或深度差别较大的邻居, 样本分布不同, 不参与合并
+                                if (glm::dot(other.normal, surface.normal) < 0.9f) continue;
+                                if (fabs(other.depth - surface.depth) > 0.1f * surface.depth) continue;
+                                r.merge(current[q], targetFunction(surface, current[q].y), ctx.uniform());
+                            }
+                            r.finalize();
+                        }
+                        reused[p] = r;
+                    }
+                }
+            });
+            forEachTile(contexts, [&](RenderContext& ctx, int x0, int y0, int x1, int y1) {
+                for (int i=y0; i<y1; i++) {
+                    for (int j=x0; j<x1; j++) {
+                        size_t p = size_t(i)*width + j;
+                        auto& surface = surfaces[p];
+                        auto& r = reused[p];
+                        RGB color = surface.base;
+                        if (surface.valid && r.W > 0) {
+                            Vec3 d = r.y.position - surface.position;
+                            float dist = glm::length(d);
+                            auto shadowHit = Intersection::closestCandidate(Ray{surface.position, d / dist}, scene, 0.000001f, dist - 0.001f);
+                            ctx.stats.shadowRays++;
+                            if (shadowHit) r.W = 0;
+                            else color += unshadowedContribution(surface, r.y) * r.W;
+                        }
+                        accum[p] += color;
+                    }
+                }
+            });
+            previous.swap(reused);
         }
-        return closestHit;
+
+        for (unsigned int i=0; i<height; i++) {
+            for (unsigned int j=0; j<width; j++) {
+                color[(height-i-1)*width+j] = accum[size_t(i)*width + j] / float(samples);
+            }
+        }
+    }
+
+    HitRecord PathTracerRenderer::closestHitObject(const Ray& r) {
+        // 遍历时只比较 t, 最终命中再展开成完整的 HitRecord
+        auto candidate = Intersection::closestCandidate(r, scene, 0.000001f);
+        return Intersection::resolve(r, scene, candidate);
     }
 
     tuple<float, Vec3> PathTracerRenderer::closestHitLight(const Ray& r) {
-        Vec3 v = {};
-        HitRecord closest = getHitRecord(FLOAT_INF, {}, {}, {});
-        for (auto& a : scene.areaLightBuffer) {
-            auto hitRecord = Intersection::xAreaLight(r, a, 0.000001f, closest->t);
-            if (hitRecord && closest->t > hitRecord->t) {
-                closest = hitRecord;
-                v = a.radiance;
+        float t;
+        int idx = lights.closestAreaLight(r, 0.000001f, FLOAT_INF, t);
+        if (idx < 0) return { FLOAT_INF, {} };
+        return { t, scene.areaLightBuffer[idx].radiance };
+    }
+
+    Vec3 PathTracerRenderer::sampleDirect(RenderContext& ctx, const Vec3& origin, const Vec3& normal) {
+        // 每个样本只对光源树选出的一个光源连一条阴影光线, 代价与光源数量无关
+        const int lightSamples = 8;
+        float u[lightSamples];
+        for (int s=0; s<lightSamples; s++) u[s] = (s + ctx.uniform()) / float(lightSamples);
+        LightTree::Selection selected[lightSamples];
+        lights.sample(origin, normal, u, lightSamples, selected);
+        Vec3 sum{0, 0, 0};
+        for (int s=0; s<lightSamples; s++) {
+            auto& sel = selected[s];
+            if (sel.pmf <= 0) continue;
+            Vec3 y;
+            Vec3 Li;
+            float cosL = 1.f;
+            float area = 1.f;
+            if (sel.kind == LightTree::Kind::AREA) {
+                auto& a = scene.areaLightBuffer[sel.index];
+                y = a.position + ctx.uniform()*a.u + ctx.uniform()*a.v;
+                Vec3 nL = glm::normalize(glm::cross(a.u, a.v));
+                cosL = glm::dot(nL, glm::normalize(origin - y));
+                area = glm::length(glm::cross(a.u, a.v));
+                Li = a.radiance;
             }
+            else if (sel.kind == LightTree::Kind::POINT) {
+                auto& l = scene.pointLightBuffer[sel.index];
+                y = l.position;
+                Li = l.intensity;
+            }
+            else {
+                auto& l = scene.spotLightBuffer[sel.index];
+                y = l.position;
+                Li = l.intensity * LightTree::spotFalloff(l, glm::normalize(origin - y));
+            }
+            Vec3 out = glm::normalize(y - origin);
+            float d = glm::length(y - origin);
+            float cosS = glm::dot(out, normal);
+            if (cosS <= 0 || cosL <= 0) continue;
+            // 阴影光线只关心是否有遮挡, 不需要展开命中信息
+            auto shadowHit = Intersection::closestCandidate(Ray{origin, out}, scene, 0.000001f, d - 0.001f);
+            ctx.stats.shadowRays++;
+            if (shadowHit) continue;
+            sum += Li * (cosS * cosL * area / (d*d * sel.pmf));
         }
-        return { closest->t, v };
+        return sum / float(lightSamples);
     }
 
-    RGB PathTracerRenderer::trace(const Ray& r, int currDepth) {
+    RGB PathTracerRenderer::trace(RenderContext& ctx, const Ray& r, int currDepth) {
         if (currDepth == depth) return scene.ambient.constant;
+        if (currDepth == 0) ctx.stats.primaryRays++;
+        else ctx.stats.secondaryRays++;
         auto hitObject = closestHitObject(r);
         auto [tLight, emitted] = closestHitLight(r);
         if (hitObject && hitObject->t < tLight) {
@@ -119,38 +422,38 @@ namespace RayCast
 
             Vec3 origin = hitObject->hitPoint + 0.0001f * hitObject->normal;
 
-            Vec3 direct{0, 0, 0};
-            if (diffuseColor && !scene.areaLightBuffer.empty()) {
-                int lightSamples = 8;
-                for (auto& a : scene.areaLightBuffer) {
-                    Vec3 nL = glm::normalize(glm::cross(a.u, a.v));
-                    float area = glm::length(glm::cross(a.u, a.v));
-                    for (int s=0; s<lightSamples; s++) {
-                        float us = (s + 0.5f) / float(lightSamples);
-                        float vs = ((s*73) % lightSamples + 0.5f) / float(lightSamples);
-                        Vec3 y = a.position + us*a.u + vs*a.v;
-                        Vec3 out = glm::normalize(y - origin);
-                        float d = glm::length(y - origin);
-                        if (glm::dot(out, hitObject->normal) <= 0) continue;
-                        if (glm::dot(nL, -out) <= 0) continue;
-                        auto shadowHit = closestHitObject(Ray{origin, out});
-                        if (shadowHit && shadowHit->t <= d - 0.001f) continue;
-                        float G = glm::max(0.0f, glm::dot(hitObject->normal, out)) * glm::max(0.0f, glm::dot(nL, -out)) / (d*d);
-                        direct += (albedo / 3.1415926535898f) * a.radiance * G;
-                    }
-                    direct *= (area / float(lightSamples));
+            // 第 cacheBounces 次反弹的漫反射命中点读写缓存; 只在这一层读写, 格子里的值对应相同的剩余深度
+            bool cacheable = useCache && diffuseColor && currDepth == int(cacheBounces);
+            float cellSize = 0;
+            if (cacheable) {
+                cellSize = cacheCellPixels * pixelSpread * glm::length(hitObject->hitPoint - scene.camera.position);
+                // 查询位置在格子大小内抖动, 把格子边界上的阶跃打散成噪声
+                Vec3 jitter = Vec3{ctx.uniform(), ctx.uniform(), ctx.uniform()} - 0.5f;
+                jitter -= glm::dot(jitter, hitObject->normal) * hitObject->normal;
+                RGB cached;
+                if (cache.lookup(hitObject->hitPoint + cellSize * jitter, hitObject->normal, cellSize, cached)
+                    && ctx.uniform() >= cacheRefreshProbability) {
+                    ctx.stats.cacheHits++;
+                    return cached;
                 }
             }
 
-            Vec3 local = sampleHemisphereUniform();
+            Vec3 direct{0, 0, 0};
+            if (diffuseColor && lights.size() > 0) {
+                direct = (albedo / 3.1415926535898f) * sampleDirect(ctx, origin, hitObject->normal);
+            }
+
+            Vec3 local = sampleHemisphereUniform(ctx);
             Vec3 direction = glm::normalize(toWorld(hitObject->normal, local));
 
             float pdf = 1.0f/(2.0f*3.1415926535898f);
             Vec3 attenuation = albedo / 3.1415926535898f;
 
-            auto next = trace(Ray{origin, direction}, currDepth+1);
+            auto next = trace(ctx, Ray{origin, direction}, currDepth+1);
             float n_dot_in = glm::dot(hitObject->normal, direction);
-            return direct + attenuation * next * n_dot_in / pdf;
+            RGB result = direct + attenuation * next * n_dot_in / pdf;
+            if (cacheable) cache.add(hitObject->hitPoint, hitObject->normal, cellSize, result);
+            return result;
         }
         else if (tLight != FLOAT_INF) {
             return emitted;
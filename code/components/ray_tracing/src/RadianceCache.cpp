@@ -0,0 +1,77 @@
+#include "RadianceCache.hpp"
+
+#include <cmath>
+
+namespace RayCast
+{
+    namespace
+    {
+        uint64_t mix(uint64_t h, uint64_t v) {
+            h ^= v + 0x9e3779b97f4a7c15ull + (h << 6) + (h >> 2);
+            h ^= h >> 31;
+            h *= 0xbf58476d1ce4e5b9ull;
+            return h ^ (h >> 29);
+        }
+
+        void atomicAdd(atomic<float>& a, float v) {
+            float cur = a.load(memory_order_relaxed);
+            while (!a.compare_exchange_weak(cur, cur + v, memory_order_relaxed));
+        }
+    }
+
+    void RadianceCache::reset(size_t capacity) {
+        size_t n = 1;
+        while (n < capacity) n <<= 1;
+        cells.reset(new Cell[n]);
+        for (size_t i=0; i<n; i++) {
+            for (auto& s : cells[i].sum) s.store(0, memory_order_relaxed);
+        }
+        mask = n - 1;
+        used.store(0, memory_order_relaxed);
+    }
+
+    uint64_t RadianceCache::hash(const Vec3& p, const Vec3& n, float size) {
+        int level = int(floor(log2(glm::max(size, 1e-6f))));
+        float cell = ldexp(1.f, level);
+        uint64_t h = mix(0, uint64_t(int64_t(level)));
+        for (int i=0; i<3; i++) {
+            h = mix(h, uint64_t(int64_t(floor(p[i] / cell))));
+        }
+        // 法线每个分量分成 4 段, 朝向差别大的面不会落进同一个格子
+        for (int i=0; i<3; i++) {
+            h = mix(h, uint64_t(glm::clamp(int((n[i] + 1.f) * 2.f), 0, 3)));
+        }
+        return h == 0 ? 1 : h;
+    }
+
+    auto RadianceCache::find(uint64_t key, bool insert) const -> Cell* {
+        if (!cells) return nullptr;
+        for (int i=0; i<maxProbes; i++) {
+            Cell& c = cells[(key + i) & mask];
+            uint64_t k = c.key.load(memory_order_acquire);
+            if (k == key) return &c;
+            if (k != 0) continue;
+            if (!insert) return nullptr;
+            if (c.key.compare_exchange_strong(k, key, memory_order_acq_rel) || k == key) return &c;
+        }
+        return nullptr;
+    }
+
+    bool RadianceCache::lookup(const Vec3& p, const Vec3& n, float size, RGB& out) const {
+        auto c = find(hash(p, n, size), false);
+        if (!c) return false;
+        uint32_t count = c->count.load(memory_order_relaxed);
+        if (count < minSamples) return false;
+        out = RGB{c->sum[0].load(memory_order_relaxed), c->sum[1].load(memory_order_relaxed),
+            c->sum[2].load(memory_order_relaxed)} / float(count);
+        return true;
+    }
+
+    void RadianceCache::add(const Vec3& p, const Vec3& n, float size, const RGB& radiance) {
+        if (!isfinite(radiance.x) || !isfinite(radiance.y) || !isfinite(radiance.z)) return;
+        auto c = find(hash(p, n, size), true);
+        if (!c) return;
+        for (int i=0; i<3; i++) atomicAdd(c->sum[i], radiance[i]);
+        if (c->count.fetch_add(1, memory_order_relaxed) == 0) used.fetch_add(1, memory_order_relaxed);
+    }
+}
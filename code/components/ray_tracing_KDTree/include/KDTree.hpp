@@ -6,6 +6,7 @@
 #include <vector>
 #include <memory>
 #include <algorithm>
+#include <atomic>
 
 #include "scene/Scene.hpp"
 #include "Ray.hpp"
@@ -16,44 +17,76 @@ namespace RayCast
 {
     using namespace NRenderer;
 
+    // 空间划分的 kd-tree: 节点按轴对齐平面切分空间, 跨越平面的三角形同时进入两侧
+    //  - 分割平面由 SAH 选出, 候选平面来自三角形裁剪到节点范围后的包围盒边界 (排序后的事件扫描)
+    //  - 一侧为空的划分给予代价折扣, 使空白区域尽早被切掉
+    //  - 遍历用显式栈由近及远进行, 找到的交点在当前区间内即可提前结束
     class KDTree
     {
     public:
         KDTree() = default;
+        // 三角形数不超过该值的节点直接成为叶子, 其余由 SAH 决定是否继续划分
         void setLeafSize(int s);
+        // 按需构建: 只建根节点, 内部节点在第一次被光线访问时才划分
+        void setLazy(bool l);
         void buildFromScene(const Scene& scene);
         HitRecord closestHit(const Ray& ray, float tMin, float tMax) const;
 
     private:
-        struct Tri {
-            Vec3 v1, v2, v3;
-            Vec3 n1, n2, n3;
-            Vec3 normal;
-            Handle material;
-        };
         struct AABB {
             Vec3 min, max;
         };
+        // 同一轴上的事件按 位置, 结束 < 平面 < 开始 排序
+        enum EventType : uint8_t { END, PLANAR, START };
+        struct Event {
+            float pos;
+            int tri;
+            uint8_t axis;
+            uint8_t type;
+            bool operator<(const Event& e) const {
+                if (axis != e.axis) return axis < e.axis;
+                return pos < e.pos || (pos == e.pos && type < e.type);
+            }
+        };
         struct Node {
+            // 节点的空间范围, 只在构建时使用
             AABB box;
+            // 分割轴, -1 表示叶子
+            int axis = -1;
+            float split = 0;
+            int depth = 0;
             std::unique_ptr<Node> left;
             std::unique_ptr<Node> right;
             std::vector<int> indices;
-            bool isLeaf() const { return !left && !right; }
+            // 尚未划分的节点保存裁剪到 box 后的三角形事件与三角形数, 划分后释放
+            std::vector<Event> events;
+            int count = 0;
+            // 按需构建时未划分的节点为 UNBUILT
+            mutable std::atomic<int> state{BUILT};
+            bool isLeaf() const { return axis < 0; }
         };
+        enum NodeState : int { UNBUILT, BUILDING, BUILT };
 
         std::unique_ptr<Node> root;
-        std::vector<Tri> tris;
-        int leafSize = 8;
+        AABB bounds;
+        std::vector<Triangle> tris;
+        std::vector<AABB> triBoxes;
+        int leafSize = 1;
+        int maxDepth = 0;
+        bool lazy = false;
 
-        static AABB triBox(const Tri& t);
+        static AABB triBox(const Triangle& t);
         static AABB merge(const AABB& a, const AABB& b);
-        static bool hitAABB(const Ray& r, const AABB& box, float tMin, float tMax);
-        static bool hitAABBWithT(const Ray& r, const AABB& box, float tMin, float tMax, float& tNear);
-        static Vec3 centroid(const Tri& t);
-        std::unique_ptr<Node> build(const std::vector<int>& idx);
-        HitRecord traverse(const Node* node, const Ray& r, float tMin, float tMax) const;
+        static bool hitAABBWithT(const Ray& r, const AABB& box, float tMin, float tMax, float& tNear, float& tFar);
+        // 三角形裁剪到 box 后的包围盒; 三角形与 box 不相交时返回 false
+        bool clippedBox(int tri, const AABB& box, AABB& out) const;
+        static void addEvents(std::vector<Event>& events, int tri, const AABB& b);
+        static std::vector<int> eventTris(const std::vector<Event>& events);
+        std::unique_ptr<Node> build(const AABB& box, std::vector<Event> events, int count, int depth);
+        void split(Node& node);
+        // 由第一个访问到节点的线程划分, 其余线程等待划分完成
+        void expand(const Node* node) const;
     };
 }
 
-#endif
\ No newline at end of file
+#endif
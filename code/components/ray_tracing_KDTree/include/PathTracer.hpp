@@ -49,7 +49,6 @@ namespace RayCast
 
     private:
         void renderTask(RGBA* pixels, int width, int height, int off, int step);
-        RGB gamma(const RGB& rgb);
         RGB trace(const Ray& ray, int currDepth);
         HitRecord closestHitObject(const Ray& r);
         tuple<float, Vec3> closestHitLight(const Ray& r);
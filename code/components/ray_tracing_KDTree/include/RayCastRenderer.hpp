@@ -35,7 +35,6 @@ namespace RayCast
         void release(const RenderResult& r);
 
     private:
-        RGB gamma(const RGB& rgb);
         RGB trace(const Ray& r);
         HitRecord closestHit(const Ray& r);
     };
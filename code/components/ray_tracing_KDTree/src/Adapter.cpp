@@ -15,7 +15,7 @@ namespace RayCast
             PathTracerRenderer renderer{spScene};
             auto result = renderer.render();
             auto [ pixels, width, height ] = result;
-            getServer().screen.set(pixels, width, height);
+            getServer().screen.setLinear(pixels, width, height);
             renderer.release(result);
         }
     };
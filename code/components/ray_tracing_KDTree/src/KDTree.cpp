@@ -1,10 +1,24 @@
 // cpp d:\study\computer_graph\nrenderer-master\code\components\ray_tracing_KDTree\src\KDTree.cpp
 #include "KDTree.hpp"
 
+#include <cmath>
+#include <thread>
+
 namespace RayCast
 {
+    namespace
+    {
+        // SAH 代价: 遍历一个内部节点与求交一个三角形的相对代价, 以及一侧为空时的折扣
+        constexpr float traversalCost = 1.f;
+        constexpr float intersectCost = 1.5f;
+        constexpr float emptyBonus = 0.8f;
+        // 深度小于该值的节点两侧子树并行构建, 最多 2^3 = 8 个线程
+        constexpr int parallelDepth = 3;
+    }
+
     void KDTree::setLeafSize(int s) { leafSize = std::max(1, s); }
-    KDTree::AABB KDTree::triBox(const Tri& t) {
+    void KDTree::setLazy(bool l) { lazy = l; }
+    KDTree::AABB KDTree::triBox(const Triangle& t) {
         Vec3 mn{
             std::min({t.v1.x, t.v2.x, t.v3.x}),
             std::min({t.v1.y, t.v2.y, t.v3.y}),
@@ -22,96 +36,263 @@ namespace RayCast
         Vec3 mx{std::max(a.max.x,b.max.x), std::max(a.max.y,b.max.y), std::max(a.max.z,b.max.z)};
         return {mn, mx};
     }
-    bool KDTree::hitAABB(const Ray& r, const AABB& box, float tMin, float tMax) {
-        for (int i=0;i<3;i++) {
-            float invD = 1.0f / (i==0?r.direction.x:(i==1?r.direction.y:r.direction.z));
-            float o = (i==0?r.origin.x:(i==1?r.origin.y:r.origin.z));
-            float t0 = ( (i==0?box.min.x:(i==1?box.min.y:box.min.z)) - o ) * invD;
-            float t1 = ( (i==0?box.max.x:(i==1?box.max.y:box.max.z)) - o ) * invD;
-            if (invD < 0.0f) std::swap(t0, t1);
-            tMin = t0 > tMin ? t0 : tMin;
-            tMax = t1 < tMax ? t1 : tMax;
-            if (tMax <= tMin) return false;
-        }
-        return true;
-    }
-    bool KDTree::hitAABBWithT(const Ray& r, const AABB& box, float tMin, float tMax, float& tNear) {
+    bool KDTree::hitAABBWithT(const Ray& r, const AABB& box, float tMin, float tMax, float& tNear, float& tFar) {
         float tn = tMin;
         float tf = tMax;
         for (int i=0;i<3;i++) {
-            float invD = 1.0f / (i==0?r.direction.x:(i==1?r.direction.y:r.direction.z));
-            float o = (i==0?r.origin.x:(i==1?r.origin.y:r.origin.z));
-            float t0 = ( (i==0?box.min.x:(i==1?box.min.y:box.min.z)) - o ) * invD;
-            float t1 = ( (i==0?box.max.x:(i==1?box.max.y:box.max.z)) - o ) * invD;
+            float invD = 1.0f / r.direction[i];
+            float t0 = (box.min[i] - r.origin[i]) * invD;
+            float t1 = (box.max[i] - r.origin[i]) * invD;
             if (invD < 0.0f) std::swap(t0, t1);
             tn = t0 > tn ? t0 : tn;
             tf = t1 < tf ? t1 : tf;
-            if (tf <= tn) return false;
+            if (tf < tn) return false;
         }
         tNear = tn;
+        tFar = tf;
         return true;
     }
-    Vec3 KDTree::centroid(const Tri& t) {
-        return (t.v1 + t.v2 + t.v3) / 3.0f;
+
+    bool KDTree::clippedBox(int tri, const AABB& box, AABB& out) const {
+        const AABB& tb = triBoxes[tri];
+        bool inside = true;
+        for (int a=0;a<3;a++) {
+            if (tb.max[a] < box.min[a] || tb.min[a] > box.max[a]) return false;
+            if (tb.min[a] < box.min[a] || tb.max[a] > box.max[a]) inside = false;
+        }
+        if (inside) {
+            out = tb;
+            return true;
+        }
+        // Sutherland-Hodgman: 依次用 6 个平面裁剪, 每次最多增加一个顶点
+        Vec3 poly[10], tmp[10];
+        const Triangle& t = tris[tri];
+        poly[0] = t.v1; poly[1] = t.v2; poly[2] = t.v3;
+        int n = 3;
+        for (int a=0;a<3;a++) {
+            for (int side=0;side<2;side++) {
+                float plane = side == 0 ? box.min[a] : box.max[a];
+                auto in = [&](const Vec3& v) { return side == 0 ? v[a] >= plane : v[a] <= plane; };
+                int m = 0;
+                for (int i=0;i<n;i++) {
+                    const Vec3& cur = poly[i];
+                    const Vec3& next = poly[(i+1)%n];
+                    bool ci = in(cur), ni = in(next);
+                    if (ci) tmp[m++] = cur;
+                    if (ci != ni) {
+                        float s = (plane - cur[a]) / (next[a] - cur[a]);
+                        Vec3 p = cur + (next - cur)*s;
+                        p[a] = plane;
+                        tmp[m++] = p;
+                    }
+                }
+                n = m;
+                if (n == 0) return false;
+                std::copy(tmp, tmp + n, poly);
+            }
+        }
+        out = {poly[0], poly[0]};
+        for (int i=1;i<n;i++) {
+            out.min = glm::min(out.min, poly[i]);
+            out.max = glm::max(out.max, poly[i]);
+        }
+        out.min = glm::max(out.min, box.min);
+        out.max = glm::min(out.max, box.max);
+        return true;
     }
 
-    std::unique_ptr<KDTree::Node> KDTree::build(const std::vector<int>& idx) {
-        if (idx.empty()) return nullptr;
+    void KDTree::addEvents(std::vector<Event>& events, int tri, const AABB& b) {
+        for (int k=0;k<3;k++) {
+            if (b.min[k] == b.max[k]) events.push_back({b.min[k], tri, uint8_t(k), PLANAR});
+            else {
+                events.push_back({b.min[k], tri, uint8_t(k), START});
+                events.push_back({b.max[k], tri, uint8_t(k), END});
+            }
+        }
+    }
+
+    std::vector<int> KDTree::eventTris(const std::vector<Event>& events) {
+        // 每个三角形在 x 轴上恰好有一个开始或平面事件
+        std::vector<int> result;
+        for (auto& e : events) {
+            if (e.axis == 0 && e.type != END) result.push_back(e.tri);
+        }
+        return result;
+    }
+
+    std::unique_ptr<KDTree::Node> KDTree::build(const AABB& box, std::vector<Event> events, int count, int depth) {
         auto node = std::make_unique<Node>();
-        AABB box = triBox(tris[idx[0]]);
-        for (size_t i=1;i<idx.size();i++) box = merge(box, triBox(tris[idx[i]]));
         node->box = box;
-        if ((int)idx.size() <= leafSize) {
-            node->indices = idx;
+        node->depth = depth;
+        if (count <= leafSize || depth >= maxDepth) {
+            node->indices = eventTris(events);
             return std::move(node);
         }
-        Vec3 mn = box.min, mx = box.max;
-        Vec3 extent = mx - mn;
-        int axis = 0;
-        if (extent.y > extent.x && extent.y >= extent.z) axis = 1;
-        else if (extent.z > extent.x && extent.z >= extent.y) axis = 2;
-        std::vector<int> leftIdx, rightIdx;
-        std::vector<float> cs;
-        cs.reserve(idx.size());
-        for (int i : idx) {
-            Vec3 c = centroid(tris[i]);
-            cs.push_back(axis==0?c.x:(axis==1?c.y:c.z));
-        }
-        float median;
-        {
-            std::vector<float> tmp = cs;
-            size_t mid = tmp.size()/2;
-            std::nth_element(tmp.begin(), tmp.begin()+mid, tmp.end());
-            median = tmp[mid];
-        }
-        for (size_t k=0;k<idx.size();k++) {
-            int i = idx[k];
-            float v = cs[k];
-            if (v <= median) leftIdx.push_back(i);
-            else rightIdx.push_back(i);
-        }
-        if (leftIdx.empty() || rightIdx.empty()) {
-            node->indices = idx;
+        node->events = std::move(events);
+        node->count = count;
+        if (lazy) {
+            node->state.store(UNBUILT, std::memory_order_relaxed);
             return std::move(node);
         }
-        node->left = build(leftIdx);
-        node->right = build(rightIdx);
+        split(*node);
         return std::move(node);
     }
 
+    void KDTree::split(Node& node) {
+        const AABB& box = node.box;
+        std::vector<Event> events = std::move(node.events);
+        const int n = node.count;
+        Vec3 d = box.max - box.min;
+        float area = 2.f*(d.x*d.y + d.y*d.z + d.z*d.x);
+        if (area <= 0) {
+            node.indices = eventTris(events);
+            return;
+        }
+
+        int bestAxis = -1;
+        float bestPos = 0;
+        bool planarLeft = true;
+        float bestCost = intersectCost * n;
+        auto evaluate = [&](int k, float p, int nl, int nr, int np) {
+            // 子节点表面积 = 2 (沿 k 的长度 * 另两边之和 + 另两边之积)
+            float da = d[(k+1)%3], db = d[(k+2)%3];
+            float pl = 2.f*((p - box.min[k])*(da + db) + da*db) / area;
+            float pr = 2.f*((box.max[k] - p)*(da + db) + da*db) / area;
+            auto cost = [&](int a, int b) {
+                float c = traversalCost + intersectCost*(pl*a + pr*b);
+                return (a == 0 || b == 0) ? c * emptyBonus : c;
+            };
+            float cl = cost(nl + np, nr);
+            float cr = cost(nl, nr + np);
+            if (cl < bestCost) { bestCost = cl; bestAxis = k; bestPos = p; planarLeft = true; }
+            if (cr < bestCost) { bestCost = cr; bestAxis = k; bestPos = p; planarLeft = false; }
+        };
+
+        // 事件已按 (轴, 位置, 类型) 排好序, 一次线性扫描即可求出三个轴上所有候选平面的代价
+        // 平面 p 左侧为已开始的三角形, 右侧为尚未结束的三角形, 位于平面上的单独计数
+        int nl[3] = {0, 0, 0}, nr[3] = {n, n, n};
+        for (size_t i=0;i<events.size();) {
+            int k = events[i].axis;
+            float p = events[i].pos;
+            int ends = 0, planars = 0, starts = 0;
+            auto same = [&](int type) {
+                return i < events.size() && events[i].axis == k && events[i].pos == p && events[i].type == type;
+            };
+            while (same(END)) { ends++; i++; }
+            while (same(PLANAR)) { planars++; i++; }
+            while (same(START)) { starts++; i++; }
+            nr[k] -= planars + ends;
+            if (p > box.min[k] && p < box.max[k]) evaluate(k, p, nl[k], nr[k], planars);
+            nl[k] += starts + planars;
+        }
+        if (bestAxis < 0) {
+            node.indices = eventTris(events);
+            return;
+        }
+
+        // 按分割轴上的事件给三角形分类, 标记数组每个线程一份
+        thread_local std::vector<uint8_t> side;
+        if (side.size() < tris.size()) side.resize(tris.size());
+        enum Side : uint8_t { BOTH, LEFT_ONLY, RIGHT_ONLY };
+        for (auto& e : events) {
+            if (e.axis == 0 && e.type != END) side[e.tri] = BOTH;
+        }
+        for (auto& e : events) {
+            if (e.axis != bestAxis) continue;
+            if (e.type == END && e.pos <= bestPos) side[e.tri] = LEFT_ONLY;
+            else if (e.type == START && e.pos >= bestPos) side[e.tri] = RIGHT_ONLY;
+            else if (e.type == PLANAR) {
+                if (e.pos < bestPos || (e.pos == bestPos && planarLeft)) side[e.tri] = LEFT_ONLY;
+                else side[e.tri] = RIGHT_ONLY;
+            }
+        }
+
+        // 只在一侧的三角形的事件按原顺序分到该侧, 不需要重新排序
+        std::vector<Event> leftEvents, rightEvents;
+        std::vector<int> straddling;
+        int leftCount = 0, rightCount = 0;
+        for (auto& e : events) {
+            bool first = e.axis == 0 && e.type != END;
+            switch (side[e.tri]) {
+            case LEFT_ONLY:
+                leftEvents.push_back(e);
+                leftCount += first;
+                break;
+            case RIGHT_ONLY:
+                rightEvents.push_back(e);
+                rightCount += first;
+                break;
+            default:
+                if (first) straddling.push_back(e.tri);
+            }
+        }
+        std::vector<Event>().swap(events);
+
+        // 跨越平面的三角形重新裁剪到两个子节点, 新事件排序后与原有事件归并
+        AABB leftBox = box, rightBox = box;
+        leftBox.max[bestAxis] = bestPos;
+        rightBox.min[bestAxis] = bestPos;
+        std::vector<Event> newLeft, newRight;
+        for (int t : straddling) {
+            AABB c;
+            if (clippedBox(t, leftBox, c)) {
+                addEvents(newLeft, t, c);
+                leftCount++;
+            }
+            if (clippedBox(t, rightBox, c)) {
+                addEvents(newRight, t, c);
+                rightCount++;
+            }
+        }
+        auto mergeInto = [](std::vector<Event>& dst, std::vector<Event>& extra) {
+            if (extra.empty()) return;
+            std::sort(extra.begin(), extra.end());
+            std::vector<Event> merged(dst.size() + extra.size());
+            std::merge(dst.begin(), dst.end(), extra.begin(), extra.end(), merged.begin());
+            dst.swap(merged);
+        };
+        mergeInto(leftEvents, newLeft);
+        mergeInto(rightEvents, newRight);
+
+        // 顶层的左右子树并行构建; 按需构建时由访问线程各自划分, 不另开线程
+        if (!lazy && node.depth < parallelDepth) {
+            std::thread t([&]() {
+                node.left = build(leftBox, std::move(leftEvents), leftCount, node.depth + 1);
+            });
+            node.right = build(rightBox, std::move(rightEvents), rightCount, node.depth + 1);
+            t.join();
+        }
+        else {
+            node.left = build(leftBox, std::move(leftEvents), leftCount, node.depth + 1);
+            node.right = build(rightBox, std::move(rightEvents), rightCount, node.depth + 1);
+        }
+        node.split = bestPos;
+        node.axis = bestAxis;
+    }
+
+    void KDTree::expand(const Node* node) const {
+        int expected = UNBUILT;
+        if (node->state.compare_exchange_strong(expected, BUILDING, std::memory_order_acquire)) {
+            // 按需构建发生在求交过程中, 节点本身归 KDTree 所有, 不是 const 对象
+            const_cast<KDTree*>(this)->split(*const_cast<Node*>(node));
+            node->state.store(BUILT, std::memory_order_release);
+        }
+        else {
+            while (node->state.load(std::memory_order_acquire) != BUILT) std::this_thread::yield();
+        }
+    }
+
     void KDTree::buildFromScene(const Scene& scene) {
         tris.clear();
+        triBoxes.clear();
         for (auto& t : scene.triangleBuffer) {
-            Tri tr;
-            tr.v1 = t.v1; tr.v2 = t.v2; tr.v3 = t.v3;
-            tr.n1 = t.n1; tr.n2 = t.n2; tr.n3 = t.n3;
+            Triangle tr = t;
             tr.normal = glm::normalize(t.normal);
-            tr.material = t.material;
             tris.push_back(tr);
         }
         for (auto& m : scene.meshBuffer) {
             for (size_t i = 0; i + 2 < m.positionIndices.size(); i += 3) {
-                Tri tr;
+                Triangle tr;
                 tr.v1 = m.positions[m.positionIndices[i]];
                 tr.v2 = m.positions[m.positionIndices[i + 1]];
                 tr.v3 = m.positions[m.positionIndices[i + 2]];
@@ -129,55 +310,71 @@ namespace RayCast
                 tris.push_back(tr);
             }
         }
-        std::vector<int> idx(tris.size());
-        for (size_t i=0;i<idx.size();i++) idx[i] = (int)i;
-        root = build(idx);
+        root.reset();
+        if (tris.empty()) return;
+        triBoxes.reserve(tris.size());
+        for (auto& t : tris) triBoxes.push_back(triBox(t));
+        bounds = triBoxes[0];
+        for (auto& b : triBoxes) bounds = merge(bounds, b);
+        // 深度上限取 8 + 1.3 log2(N), 同时保证遍历栈不会溢出
+        maxDepth = std::min(60, int(8 + 1.3f*std::log2(float(tris.size()))));
+        // 事件只在根节点排序一次, 之后每次划分都保持有序, 构建为 O(N log N)
+        std::vector<Event> events;
+        events.reserve(tris.size()*6);
+        for (size_t i=0;i<tris.size();i++) addEvents(events, (int)i, triBoxes[i]);
+        std::sort(events.begin(), events.end());
+        root = build(bounds, std::move(events), (int)tris.size(), 0);
     }
 
-    HitRecord KDTree::traverse(const Node* node, const Ray& r, float tMin, float tMax) const {
-        if (!node) return getMissRecord();
-        if (!hitAABB(r, node->box, tMin, tMax)) return getMissRecord();
+    HitRecord KDTree::closestHit(const Ray& ray, float tMin, float tMax) const {
+        if (!root) return getMissRecord();
+        float tNear, tFar;
+        if (!hitAABBWithT(ray, bounds, tMin, tMax, tNear, tFar)) return getMissRecord();
+
+        struct Todo {
+            const Node* node;
+            float tNear, tFar;
+        };
+        Todo todo[64];
+        int todoPos = 0;
+
         HitRecord best = getMissRecord();
         float closest = tMax;
-        if (node->isLeaf()) {
+        const Node* node = root.get();
+        while (node) {
+            // 已有交点比当前区间更近, 后面的区间不可能更近
+            if (closest < tNear) break;
+            if (lazy && node->state.load(std::memory_order_acquire) != BUILT) expand(node);
+            if (!node->isLeaf()) {
+                int a = node->axis;
+                float o = ray.origin[a], dir = ray.direction[a];
+                bool belowFirst = o < node->split || (o == node->split && dir <= 0);
+                const Node* nearChild = belowFirst ? node->left.get() : node->right.get();
+                const Node* farChild = belowFirst ? node->right.get() : node->left.get();
+                if (dir == 0) {
+                    node = nearChild;
+                    continue;
+                }
+                float tPlane = (node->split - o) / dir;
+                if (tPlane > tFar || tPlane <= 0) node = nearChild;
+                else if (tPlane < tNear) node = farChild;
+                else {
+                    todo[todoPos++] = {farChild, tPlane, tFar};
+                    node = nearChild;
+                    tFar = tPlane;
+                }
+                continue;
+            }
             for (int id : node->indices) {
-                const Tri& tr = tris[id];
-                Triangle t;
-                t.v1 = tr.v1; t.v2 = tr.v2; t.v3 = tr.v3;
-                t.normal = tr.normal;
-                t.n1 = tr.n1; t.n2 = tr.n2; t.n3 = tr.n3;
-                t.material = tr.material;
-                auto hr = Intersection::xTriangle(r, t, tMin, closest);
+                auto hr = Intersection::xTriangle(ray, tris[id], tMin, closest);
                 if (hr && hr->t < closest) { closest = hr->t; best = hr; }
             }
-            return best;
-        }
-        float tNearL = 0.0f, tNearR = 0.0f;
-        bool hitL = node->left && hitAABBWithT(r, node->left->box, tMin, closest, tNearL);
-        bool hitR = node->right && hitAABBWithT(r, node->right->box, tMin, closest, tNearR);
-        auto visit = [&](const Node* child){
-            auto h = traverse(child, r, tMin, closest);
-            if (h && h->t < closest) { closest = h->t; best = h; }
-        };
-        if (hitL && hitR) {
-            if (tNearL <= tNearR) {
-                visit(node->left.get());
-                hitR = hitAABBWithT(r, node->right->box, tMin, closest, tNearR);
-                if (hitR) visit(node->right.get());
-            } else {
-                visit(node->right.get());
-                hitL = hitAABBWithT(r, node->left->box, tMin, closest, tNearL);
-                if (hitL) visit(node->left.get());
-            }
-        } else if (hitL) {
-            visit(node->left.get());
-        } else if (hitR) {
-            visit(node->right.get());
+            if (todoPos == 0) break;
+            --todoPos;
+            node = todo[todoPos].node;
+            tNear = todo[todoPos].tNear;
+            tFar = todo[todoPos].tFar;
         }
         return best;
     }
-
-    HitRecord KDTree::closestHit(const Ray& ray, float tMin, float tMax) const {
-        return traverse(root.get(), ray, tMin, tMax);
-    }
-}
\ No newline at end of file
+}
@@ -7,10 +7,6 @@
 
 namespace RayCast
 {
-    RGB PathTracerRenderer::gamma(const RGB& rgb) {
-        return glm::sqrt(rgb);
-    }
-
     void PathTracerRenderer::release(const RenderResult& r) {
         auto [p, w, h] = r;
         delete[] p;
@@ -48,7 +44,6 @@ namespace RayCast
                     color += trace(ray, 0);
                 }
                 color /= float(samples);
-                color = gamma(color);
                 pixels[(height-i-1)*width+j] = {color, 1};
             }
         }
@@ -59,6 +54,7 @@ namespace RayCast
         vertexTransformer.exec(spScene);
 
         accel = std::make_unique<KDTree>();
+        accel->setLazy(scene.renderOption.lazyBuild);
         accel->buildFromScene(scene);
 
         RGBA* pixels = new RGBA[width*height]{};
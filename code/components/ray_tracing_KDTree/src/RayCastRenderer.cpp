@@ -8,9 +8,6 @@ namespace RayCast
         auto [p, w, h] = r;
         delete[] p;
     }
-    RGB RayCastRenderer::gamma(const RGB& rgb) {
-        return glm::sqrt(rgb);
-    }
     auto RayCastRenderer::render() -> RenderResult {
         auto width = scene.renderOption.width;
         auto height = scene.renderOption.height;
@@ -20,6 +17,7 @@ namespace RayCast
         vertexTransformer.exec(spScene);
 
         accel = std::make_unique<KDTree>();
+        accel->setLazy(scene.renderOption.lazyBuild);
         accel->buildFromScene(scene);
 
         ShaderCreator shaderCreator{};
@@ -31,8 +29,6 @@ namespace RayCast
             for (int j=0; j < width; j++) {
                 auto ray = camera.shoot(float(j)/float(width), float(i)/float(height));
                 auto color = trace(ray);
-                color = clamp(color);
-                color = gamma(color);
                 pixels[(height-i-1)*width+j] = {color, 1};
             }
         }
@@ -51,7 +51,6 @@ namespace SimplePathTracer
     private:
         void renderTask(RGBA* pixels, int width, int height, int off, int step);
 
-        RGB gamma(const RGB& rgb);
         RGB trace(const Ray& ray, int currDepth);
         HitRecord closestHitObject(const Ray& r);
         tuple<float, Vec3> closestHitLight(const Ray& r);
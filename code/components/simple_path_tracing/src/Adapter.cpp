@@ -16,7 +16,7 @@ namespace SimplePathTracer
             SimplePathTracerRenderer renderer{spScene};
             auto renderResult = renderer.render();
             auto [ pixels, width, height ]  = renderResult;
-            getServer().screen.set(pixels, width, height);
+            getServer().screen.setLinear(pixels, width, height);
             renderer.release(renderResult);
         }
     };
@@ -9,10 +9,6 @@
 
 namespace SimplePathTracer
 {
-    RGB SimplePathTracerRenderer::gamma(const RGB& rgb) {
-        return glm::sqrt(rgb);
-    }
-
     void SimplePathTracerRenderer::renderTask(RGBA* pixels, int width, int height, int off, int step) {
         for(int i=off; i<height; i+=step) {
             for (int j=0; j<width; j++) {
@@ -27,7 +23,6 @@ namespace SimplePathTracer
                     color += trace(ray, 0);
                 }
                 color /= samples;
-                color = gamma(color);
                 pixels[(height-i-1)*width+j] = {color, 1};
             }
         }
@@ -0,0 +1,67 @@
+#pragma once
+#ifndef __NR_COW_VECTOR_HPP__
+#define __NR_COW_VECTOR_HPP__
+
+#include <memory>
+#include <vector>
+
+namespace NRenderer
+{
+    using namespace std;
+    // 写时复制的 vector: 拷贝只增加引用计数, 读接口一律返回 const;
+    // 只有通过修改接口 (push_back / resize / edit 等) 写入时, 若数据仍被共享才复制一份
+    template<typename T>
+    class CowVector
+    {
+    private:
+        shared_ptr<vector<T>> p;
+
+        vector<T>& detach() {
+            if (p.use_count() > 1) p = make_shared<vector<T>>(*p);
+            return *p;
+        }
+    public:
+        using value_type = T;
+        using const_iterator = typename vector<T>::const_iterator;
+
+        CowVector()
+            : p                     (make_shared<vector<T>>())
+        {}
+        CowVector(vector<T> v)
+            : p                     (make_shared<vector<T>>(std::move(v)))
+        {}
+        CowVector(initializer_list<T> l)
+            : p                     (make_shared<vector<T>>(l))
+        {}
+        CowVector& operator=(vector<T> v) {
+            p = make_shared<vector<T>>(std::move(v));
+            return *this;
+        }
+
+        size_t size() const { return p->size(); }
+        bool empty() const { return p->empty(); }
+        const T& operator[](size_t i) const { return (*p)[i]; }
+        const T& at(size_t i) const { return p->at(i); }
+        const T& front() const { return p->front(); }
+        const T& back() const { return p->back(); }
+        const T* data() const { return p->data(); }
+        const_iterator begin() const { return p->cbegin(); }
+        const_iterator end() const { return p->cend(); }
+        const vector<T>& get() const { return *p; }
+        // 与其他对象共享同一份数据
+        bool shared() const { return p.use_count() > 1; }
+        bool sameData(const CowVector& o) const { return p == o.p; }
+
+        // 可写访问, 调用前确保数据已独占
+        vector<T>& edit() { return detach(); }
+        void push_back(const T& v) { detach().push_back(v); }
+        template<typename... Args>
+        T& emplace_back(Args&&... args) { return detach().emplace_back(std::forward<Args>(args)...); }
+        void reserve(size_t n) { detach().reserve(n); }
+        void resize(size_t n) { detach().resize(n); }
+        void clear() { p = make_shared<vector<T>>(); }
+        T* mutableData() { return detach().data(); }
+    };
+}
+
+#endif
@@ -9,6 +9,7 @@
 
 #include "Material.hpp"
 #include "common/macros.hpp"
+#include "common/CowVector.hpp"
 
 namespace NRenderer
 {
@@ -61,14 +62,15 @@ namespace NRenderer
     };
     SHARE(Plane);
 
+    // 顶点数据写时复制, 构建 Scene 时拷贝 Mesh 不会复制数组
     struct Mesh : public Entity
     {
-        vector<Vec3> normals;
-        vector<Vec3> positions;
-        vector<Vec2> uvs;
-        vector<Index> normalIndices;
-        vector<Index> positionIndices;
-        vector<Index> uvIndices;
+        CowVector<Vec3> normals;
+        CowVector<Vec3> positions;
+        CowVector<Vec2> uvs;
+        CowVector<Index> normalIndices;
+        CowVector<Index> positionIndices;
+        CowVector<Index> uvIndices;
 
         bool hasNormal() const {
             return normals.size() != 0;
@@ -98,6 +100,8 @@ namespace NRenderer
     struct Model {
         vector<Index> nodes;
         Vec3 translation = {0, 0, 0};
+        // 欧拉角 (度), 依次绕 X、Y、Z 轴旋转
+        Vec3 rotation = {0, 0, 0};
         Vec3 scale = {1, 1, 1};
     };
     SHARE(Model);
@@ -12,17 +12,55 @@ namespace NRenderer
 {
     struct RenderOption
     {
+        // BVH 的构建方式: MEDIAN 为按最长轴中位数划分, LBVH 按 Morton 码排序后线性构建, 适合预览
+        // SBVH 为带空间划分的 SAH 构建, 构建较慢, 适合有大量细长三角形的场景
+        enum class BVHBuilder
+        {
+            MEDIAN, LBVH, SBVH
+        };
         unsigned int width;
         unsigned int height;
         unsigned int depth;
         unsigned int samplesPerPixel;
         unsigned int photonsPerLight;
+        unsigned int causticPhotonsPerLight;
+        // 输出光子密度等调试信息, 默认关闭
+        bool photonDiagnostics;
+        unsigned int vplPathsPerLight;
+        // 辐射度求解时场景包围盒最长边被划分的份数, 决定面片大小
+        unsigned int radiosityResolution;
+        BVHBuilder bvhBuilder;
+        // 加速结构按需构建: 内部节点在第一次被光线访问时才划分
+        bool lazyBuild;
+        // 路径追踪的主命中点用 ReSTIR 蓄水池重采样做直接光照, 每个像素每轮只追踪一条阴影光线
+        bool restirDI;
+        // 环境贴图路径追踪用在线学习的 SD-tree 引导间接光采样, 样本分若干轮逐轮翻倍
+        bool pathGuiding;
+        // 路径追踪的辐射度缓存: 前 radianceCacheBounces 次反弹照常追踪, 之后的漫反射命中点先查缓存
+        // 格子在屏幕上约占 radianceCacheCellPixels 个像素, 越大复用越多、偏差越大
+        bool radianceCache;
+        unsigned int radianceCacheBounces;
+        unsigned int radianceCacheCellPixels;
+        // 渲染结束后用 NRServer 的 à-trous 滤波降噪, 需要组件输出反照率、法线与深度
+        bool denoise;
         RenderOption()
             : width             (500)
             , height            (500)
             , depth             (4)
             , samplesPerPixel   (16)
             , photonsPerLight   (50000)
+            , causticPhotonsPerLight (20000)
+            , photonDiagnostics (false)
+            , vplPathsPerLight  (1000)
+            , radiosityResolution (16)
+            , bvhBuilder        (BVHBuilder::MEDIAN)
+            , lazyBuild         (false)
+            , restirDI          (false)
+            , pathGuiding       (false)
+            , radianceCache     (false)
+            , radianceCacheBounces (1)
+            , radianceCacheCellPixels (8)
+            , denoise           (false)
         {}
     };
 
@@ -3,41 +3,91 @@
 #define __NR_TEXTURE_HPP__
 
 #include <memory>
+#include <algorithm>
 
 #include "geometry/vec.hpp"
 
 namespace NRenderer
 {
     using namespace std;
+    // 像素由引用计数的 storage 持有, 拷贝 Texture 只共享像素而不复制;
+    // 需要写像素时先调用 mutableData, 仍被共享或是只读视图时会先复制一份
     struct Texture
     {
         Texture()
             : height(0)
             , width(0)
             , rgba(nullptr)
+            , readOnly(false)
         {}
-        ~Texture() {
-            delete[]  rgba;
+        Texture(const Texture& texture)
+            : height(texture.height)
+            , width(texture.width)
+            , rgba(texture.rgba)
+            , storage(texture.storage)
+            , readOnly(texture.readOnly)
+        {}
+        Texture(Texture&& texture) noexcept
+            : height(texture.height)
+            , width(texture.width)
+            , rgba(texture.rgba)
+            , storage(std::move(texture.storage))
+            , readOnly(texture.readOnly)
+        {
+            texture.rgba = nullptr;
         }
-        Texture(const Texture& texture) {
-            this->height = texture.height;
-            this->width = texture.width;
-            this->rgba = new RGBA[texture.height*texture.width];
-            for (int i = 0; i < texture.height*texture.width; i++) {
-                this->rgba[i] = texture.rgba[i];
-            }
+        Texture& operator=(const Texture& texture) {
+            height = texture.height;
+            width = texture.width;
+            rgba = texture.rgba;
+            storage = texture.storage;
+            readOnly = texture.readOnly;
+            return *this;
         }
-        Texture(Texture&& texture) noexcept {
-            this->height = texture.height;
-            this->width = texture.width;
-            this->rgba = texture.rgba;
-            texture.rgba = nullptr;
+
+        // 分配新的像素缓冲, 原来共享的缓冲不受影响
+        RGBA* allocate(unsigned int w, unsigned int h) {
+            storage = shared_ptr<RGBA[]>(new RGBA[size_t(w)*h]);
+            readOnly = false;
+            width = w;
+            height = h;
+            rgba = storage.get();
+            return storage.get();
         }
+        // 接管已有的像素缓冲, 由 pixels 的删除器负责释放
+        void adopt(shared_ptr<RGBA[]> pixels, unsigned int w, unsigned int h) {
+            storage = std::move(pixels);
+            readOnly = false;
+            width = w;
+            height = h;
+            rgba = storage.get();
+        }
+        // 引用不可写的外部像素 (如映射的缓存文件), owner 保证 pixels 在纹理存活期间有效
+        void view(shared_ptr<const void> owner, const RGBA* pixels, unsigned int w, unsigned int h) {
+            storage = shared_ptr<RGBA[]>(std::move(owner), const_cast<RGBA*>(pixels));
+            readOnly = true;
+            width = w;
+            height = h;
+            rgba = pixels;
+        }
+        RGBA* mutableData() {
+            if (storage.use_count() > 1 || readOnly) {
+                auto old = storage;
+                allocate(width, height);
+                std::copy(old.get(), old.get() + size_t(width)*height, storage.get());
+            }
+            return storage.get();
+        }
+
         unsigned int height;
         unsigned int width;
-        RGBA* rgba;
+        // 只读视图, 指向 storage
+        const RGBA* rgba;
+    private:
+        shared_ptr<RGBA[]> storage;
+        bool readOnly;
     };
     using SharedTexture = shared_ptr<Texture>;
 }
 
-#endif
\ No newline at end of file
+#endif
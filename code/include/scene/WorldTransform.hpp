@@ -0,0 +1,174 @@
+#pragma once
+#ifndef __NR_WORLD_TRANSFORM_HPP__
+#define __NR_WORLD_TRANSFORM_HPP__
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+#include "Scene.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+namespace NRenderer
+{
+    using namespace std;
+
+    // 模型矩阵: 先缩放, 再依次绕 X、Y、Z 轴旋转, 最后平移
+    inline Mat4x4 modelMatrix(const Model& model) {
+        Mat4x4 m{1};
+        m = glm::translate(m, model.translation);
+        if (model.rotation.z != 0) m = glm::rotate(m, glm::radians(model.rotation.z), Vec3{0, 0, 1});
+        if (model.rotation.y != 0) m = glm::rotate(m, glm::radians(model.rotation.y), Vec3{0, 1, 0});
+        if (model.rotation.x != 0) m = glm::rotate(m, glm::radians(model.rotation.x), Vec3{1, 0, 0});
+        m = glm::scale(m, model.scale);
+        return m;
+    }
+
+    // 把 Scene 中的几何由模型坐标变换到世界坐标, 结果只写入 Scene 自己的缓冲, Asset 中的数据不变
+    // 网格的世界坐标数组按网格缓存 (每个组件 DLL 各一份):
+    //  - 源数组与模型矩阵都没变时直接共享上次的结果, 不再逐顶点计算
+    //  - 只有矩阵或几何变化的网格才重算, 多个网格并行处理
+    class WorldTransform
+    {
+    private:
+        struct MeshEntry
+        {
+            // 持有源数组, 保证比较用的数据身份在缓存期间不会被复用
+            CowVector<Vec3> sourcePositions;
+            CowVector<Vec3> sourceNormals;
+            Mat4x4 matrix{1};
+            CowVector<Vec3> positions;
+            CowVector<Vec3> normals;
+        };
+
+        mutex mtx;
+        vector<MeshEntry> meshes;
+
+        static WorldTransform& instance() {
+            static WorldTransform t;
+            return t;
+        }
+
+        static bool isLinearIdentity(const Mat4x4& m) {
+            return Mat3x3{m} == Mat3x3{1};
+        }
+
+        static Vec3 transformNormal(const Mat3x3& normalMatrix, const Vec3& n) {
+            Vec3 r = normalMatrix*n;
+            float len = glm::length(r);
+            return len > 0 ? r / len : n;
+        }
+
+        static void transformMesh(MeshEntry& e) {
+            const Mat4x4& m = e.matrix;
+            vector<Vec3> positions(e.sourcePositions.size());
+            for (size_t i = 0; i < positions.size(); i++) {
+                positions[i] = m*Vec4{e.sourcePositions[i], 1};
+            }
+            e.positions = std::move(positions);
+            if (isLinearIdentity(m)) {
+                e.normals = e.sourceNormals;
+                return;
+            }
+            Mat3x3 normalMatrix = glm::transpose(glm::inverse(Mat3x3{m}));
+            vector<Vec3> normals(e.sourceNormals.size());
+            for (size_t i = 0; i < normals.size(); i++) {
+                normals[i] = transformNormal(normalMatrix, e.sourceNormals[i]);
+            }
+            e.normals = std::move(normals);
+        }
+
+    public:
+        // transformMeshes 为 false 时网格保持模型坐标, 由调用方按实例矩阵处理 (如两层 BVH)
+        static void exec(Scene& scene, bool transformMeshes = true) {
+            auto& cache = instance();
+            lock_guard<mutex> lk(cache.mtx);
+
+            const Mat4x4 identity{1};
+            vector<Mat4x4> meshMatrix(scene.meshBuffer.size(), identity);
+            for (auto& node : scene.nodes) {
+                Mat4x4 m = modelMatrix(scene.models[node.model]);
+                if (node.type == Node::Type::MESH) {
+                    meshMatrix[node.entity] = m;
+                    continue;
+                }
+                if (m == identity) continue;
+                bool linear = !isLinearIdentity(m);
+                Mat3x3 normalMatrix = glm::transpose(glm::inverse(Mat3x3{m}));
+                if (node.type == Node::Type::TRIANGLE) {
+                    auto& t = scene.triangleBuffer[node.entity];
+                    for (int i=0; i<3; i++) {
+                        t.v[i] = m*Vec4{t.v[i], 1};
+                    }
+                    if (linear) {
+                        t.normal = transformNormal(normalMatrix, t.normal);
+                        t.n1 = transformNormal(normalMatrix, t.n1);
+                        t.n2 = transformNormal(normalMatrix, t.n2);
+                        t.n3 = transformNormal(normalMatrix, t.n3);
+                    }
+                }
+                else if (node.type == Node::Type::SPHERE) {
+                    auto& s = scene.sphereBuffer[node.entity];
+                    s.position = m*Vec4{s.position, 1};
+                    if (linear) {
+                        // 非均匀缩放下球不再是球, 取最大缩放分量作为半径的缩放
+                        auto& sc = scene.models[node.model].scale;
+                        s.radius *= std::max({ std::abs(sc.x), std::abs(sc.y), std::abs(sc.z) });
+                        s.direction = transformNormal(Mat3x3{m}, s.direction);
+                    }
+                }
+                else if (node.type == Node::Type::PLANE) {
+                    auto& p = scene.planeBuffer[node.entity];
+                    p.position = m*Vec4{p.position, 1};
+                    if (linear) {
+                        p.u = Mat3x3{m}*p.u;
+                        p.v = Mat3x3{m}*p.v;
+                        p.normal = transformNormal(normalMatrix, p.normal);
+                    }
+                }
+            }
+            if (!transformMeshes) return;
+
+            cache.meshes.resize(scene.meshBuffer.size());
+            vector<size_t> dirty;
+            for (size_t i = 0; i < scene.meshBuffer.size(); i++) {
+                auto& mesh = scene.meshBuffer[i];
+                auto& e = cache.meshes[i];
+                if (meshMatrix[i] == identity) {
+                    e = MeshEntry{};
+                    continue;
+                }
+                bool clean = e.matrix == meshMatrix[i]
+                    && e.sourcePositions.sameData(mesh.positions)
+                    && e.sourceNormals.sameData(mesh.normals);
+                if (!clean) {
+                    e.sourcePositions = mesh.positions;
+                    e.sourceNormals = mesh.normals;
+                    e.matrix = meshMatrix[i];
+                    dirty.push_back(i);
+                }
+            }
+
+            if (!dirty.empty()) {
+                atomic<size_t> next{0};
+                auto task = [&]() {
+                    for (size_t d = next++; d < dirty.size(); d = next++) {
+                        transformMesh(cache.meshes[dirty[d]]);
+                    }
+                };
+                const size_t taskNums = std::min<size_t>(8, dirty.size());
+                vector<thread> t;
+                for (size_t i = 0; i < taskNums; i++) t.emplace_back(task);
+                for (auto& th : t) th.join();
+            }
+
+            for (size_t i = 0; i < scene.meshBuffer.size(); i++) {
+                if (meshMatrix[i] == identity) continue;
+                scene.meshBuffer[i].positions = cache.meshes[i].positions;
+                scene.meshBuffer[i].normals = cache.meshes[i].normals;
+            }
+        }
+    };
+}
+
+#endif
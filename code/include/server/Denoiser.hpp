@@ -0,0 +1,48 @@
+#pragma once
+#ifndef __NR_DENOISER_HPP__
+#define __NR_DENOISER_HPP__
+
+#include "geometry/vec.hpp"
+#include "common/macros.hpp"
+
+namespace NRenderer
+{
+    // 降噪的输入, 各缓冲都按 width * height 逐行存放, 与输出图像的像素顺序一致
+    struct DenoiseInput
+    {
+        // 线性 HDR 颜色, 未做 gamma
+        const RGB* color = nullptr;
+        // 主命中点的反照率, 为空时不做反照率分离
+        const RGB* albedo = nullptr;
+        // 主命中点的单位法线, 未命中的像素为 0
+        const Vec3* normal = nullptr;
+        // 主命中点到相机的距离, 未命中的像素为 0
+        const float* depth = nullptr;
+        // 每个像素颜色亮度均值的方差, 为空时由 3x3 邻域估计
+        const float* variance = nullptr;
+        unsigned int width = 0;
+        unsigned int height = 0;
+    };
+
+    struct DenoiseOptions
+    {
+        // 滤波层数, 第 i 层的采样间隔为 2^i
+        int levels = 5;
+        float sigmaDepth = 1.f;
+        float sigmaNormal = 128.f;
+        float sigmaLuminance = 4.f;
+    };
+
+    // 边缘保持的 à-trous 小波滤波 (SVGF 的空间部分):
+    //  - 颜色先除以反照率, 只对光照滤波, 贴图与材质的细节不会被抹掉
+    //  - 5x5 B3 样条核, 权重由深度差、法线夹角与按方差归一化的亮度差决定, 方差随层数一起滤波
+    //  - 按行分给多个线程; 各通道分开存放, 内层沿行方向的循环可以被编译器向量化
+    class DLL_EXPORT Denoiser
+    {
+    public:
+        // out 可以与 input.color 相同
+        void denoise(const DenoiseInput& input, RGB* out, const DenoiseOptions& options) const;
+    };
+} // namespace NRenderer
+
+#endif
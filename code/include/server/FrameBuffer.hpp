@@ -0,0 +1,96 @@
+#pragma once
+#ifndef __NR_FRAME_BUFFER_HPP__
+#define __NR_FRAME_BUFFER_HPP__
+
+#include "geometry/vec.hpp"
+#include "common/macros.hpp"
+
+#include <map>
+#include <string>
+#include <vector>
+#include <mutex>
+
+namespace NRenderer
+{
+    using namespace std;
+
+    // 多通道帧缓冲 (AOV): 每个通道有名字与类型, 第一次用到时才分配
+    //  - 各通道都按 width * height 逐行存放, 像素顺序与 Screen 显示的图像一致
+    //  - 只有分配通道时加锁; 通道的内存在帧缓冲存活期间不会移动,
+    //    各线程拿到指针后按块写入互不重叠的区域, 不需要再加锁
+    class DLL_EXPORT FrameBuffer
+    {
+    public:
+        enum class ChannelType
+        {
+            FLOAT1 = 1,
+            FLOAT3 = 3,
+            FLOAT4 = 4
+        };
+
+        // 常用通道的名字; 组件也可以用其他名字输出自己的调试通道
+        // 以 "color." 开头的 FLOAT3 通道 (如 "color.noisy") 同样是线性 HDR 颜色, 显示时与 COLOR 一样处理
+        static constexpr const char* COLOR = "color";           // FLOAT3, 线性 HDR 颜色
+        static constexpr const char* ALBEDO = "albedo";         // FLOAT3, 主命中点的反照率
+        static constexpr const char* NORMAL = "normal";         // FLOAT3, 主命中点的单位法线
+        static constexpr const char* DEPTH = "depth";           // FLOAT1, 主命中点到相机的距离
+        static constexpr const char* VARIANCE = "variance";     // FLOAT1, 颜色亮度均值的方差
+        static constexpr const char* SAMPLES = "samples";       // FLOAT1, 每个像素的采样数
+
+        struct ChannelInfo
+        {
+            string name;
+            ChannelType type;
+        };
+    private:
+        struct Channel
+        {
+            ChannelType type;
+            vector<float> data;
+        };
+        map<string, Channel> channels;
+        unsigned int width;
+        unsigned int height;
+        mutable mutex mtx;
+    public:
+        FrameBuffer();
+        FrameBuffer(unsigned int width, unsigned int height);
+        FrameBuffer(const FrameBuffer& fb);
+        FrameBuffer& operator=(const FrameBuffer& fb);
+        ~FrameBuffer() = default;
+
+        // 改变尺寸会丢掉所有通道
+        void resize(unsigned int width, unsigned int height);
+        unsigned int getWidth() const;
+        unsigned int getHeight() const;
+
+        // 返回名为 name 的通道, 不存在时按 type 分配并清零
+        // 已存在但类型不同时返回 nullptr
+        float* channel(const string& name, ChannelType type);
+        // 只查找不分配, 不存在时返回 nullptr
+        const float* find(const string& name) const;
+        bool has(const string& name) const;
+        ChannelType typeOf(const string& name) const;
+        vector<ChannelInfo> list() const;
+        // 通道是否保存线性 HDR 颜色
+        static bool isColor(const string& name);
+
+        float* float1(const string& name) {
+            return channel(name, ChannelType::FLOAT1);
+        }
+        Vec3* float3(const string& name) {
+            return reinterpret_cast<Vec3*>(channel(name, ChannelType::FLOAT3));
+        }
+        Vec4* float4(const string& name) {
+            return reinterpret_cast<Vec4*>(channel(name, ChannelType::FLOAT4));
+        }
+
+        // 把任意通道转换成可以直接显示的 8 位 RGBA, out 需要 width * height 个像素
+        //  - FLOAT1 按通道内的最大值归一化为灰度
+        //  - FLOAT3/FLOAT4 含负值时 (如法线) 按 0.5 + 0.5x 映射, 否则原样输出
+        // 颜色通道的色调映射由 Screen 负责, 这里只用于调试通道
+        bool visualize(const string& name, RGBAi* out) const;
+    };
+} // namespace NRenderer
+
+#endif
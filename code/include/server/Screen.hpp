@@ -4,26 +4,47 @@
 
 #include "geometry/vec.hpp"
 #include "common/macros.hpp"
+#include "FrameBuffer.hpp"
+#include "ToneMapper.hpp"
 #include <mutex>
 
 namespace NRenderer
 {
+    // pixels 是显示用的 8 位图像; 线性 HDR 颜色与其他通道另外保存在 frameBuffer 中,
+    // 显示哪个通道、色调映射的参数都可以随时切换, 只重新生成 pixels, 不需要重新渲染
     class DLL_EXPORT Screen
     {
     private:
-        RGBA* pixels;
+        RGBAi* pixels;
         unsigned int width;
         unsigned int height;
         mutable bool updated;
         mutable mutex mtx;
+        FrameBuffer frameBuffer;
+        string shownChannel;
+        ToneMapper toneMapper;
+        ToneMapOptions toneMapOptions;
+        // 按 shownChannel 重新生成 pixels, 调用时需持有 mtx
+        void updateDisplay();
     public:
         Screen();
         Screen(const Screen&) = delete;
         ~Screen();
+        // 只提交已经可以直接显示的图像 (值在 [0, 1] 内, 已做 gamma), 之前提交的通道会被清空
         void set(RGBA* pixels, int width, int height);
+        // 提交线性 HDR 图像, 保存为 FrameBuffer::COLOR 通道, alpha 被忽略
+        void setLinear(RGBA* pixels, int width, int height);
+        // 提交多通道帧缓冲, 默认显示 FrameBuffer::COLOR 通道
+        void set(const FrameBuffer& frameBuffer);
+        vector<FrameBuffer::ChannelInfo> getChannels() const;
+        string getShownChannel() const;
+        void showChannel(const string& name);
+        ToneMapOptions getToneMapOptions() const;
+        // 只影响颜色通道的显示
+        void setToneMapOptions(const ToneMapOptions& options);
         unsigned int getWidth() const;
         unsigned int getHeight() const;
-        const RGBA* getPixels() const;
+        const RGBAi* getPixels() const;
         void release();
         bool isUpdated() const;
     };  
@@ -4,6 +4,7 @@
 
 #include "Screen.hpp"
 #include "Logger.hpp"
+#include "Denoiser.hpp"
 #include "component/ComponentFactory.hpp"
 
 namespace NRenderer
@@ -13,6 +14,7 @@ namespace NRenderer
         Logger logger = {};
         Screen screen = {};
         ComponentFactory componentFactory = {};
+        Denoiser denoiser = {};
         Server() = default;
     };
 } // namespace NRenderer
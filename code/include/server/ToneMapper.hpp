@@ -0,0 +1,46 @@
+#pragma once
+#ifndef __NR_TONE_MAPPER_HPP__
+#define __NR_TONE_MAPPER_HPP__
+
+#include "geometry/vec.hpp"
+#include "common/macros.hpp"
+
+namespace NRenderer
+{
+    struct ToneMapOptions
+    {
+        enum class Curve
+        {
+            // 超过 1 的部分直接截断
+            CLAMP,
+            // 逐通道的扩展 Reinhard, whitePoint 处映射为 1
+            REINHARD,
+            // ACES 电影曲线的拟合 (Narkowicz 2015)
+            ACES
+        };
+        enum class Transfer
+        {
+            // sRGB 标准的 OETF
+            SRGB,
+            // gamma 2.0 (开平方), 与各组件以前自己做的 gamma 一致
+            GAMMA
+        };
+        // 曝光, 以 EV 为单位, 颜色先乘以 2^exposure
+        float exposure = 0.f;
+        Curve curve = Curve::CLAMP;
+        Transfer transfer = Transfer::SRGB;
+        float whitePoint = 4.f;
+    };
+
+    // 线性 HDR 颜色到 8 位显示图像的转换: 曝光 -> 色调曲线 -> OETF -> 量化
+    //  - 按块处理, 块内先把颜色拆成三个通道, 各步骤都是对连续数组的无分支循环, 可以被编译器向量化
+    //  - 转换与渲染无关, 调整参数后只需重新执行这一步
+    class DLL_EXPORT ToneMapper
+    {
+    public:
+        // 把 n 个线性颜色写入 out, alpha 为 255; 非有限值按 0 处理
+        void apply(const RGB* hdr, size_t n, RGBAi* out, const ToneMapOptions& options) const;
+    };
+} // namespace NRenderer
+
+#endif
@@ -0,0 +1,170 @@
+#include "server/Denoiser.hpp"
+
+#include <vector>
+#include <thread>
+#include <cmath>
+
+namespace NRenderer
+{
+    namespace
+    {
+        // 按行交错分给固定数量的线程
+        template<typename F>
+        void parallelRows(int height, F&& f) {
+            const int taskNums = 8;
+            std::thread t[taskNums];
+            for (int i=0; i<taskNums; i++) {
+                t[i] = std::thread([&f, height, i]() {
+                    for (int y=i; y<height; y+=taskNums) f(y);
+                });
+            }
+            for (int i=0; i<taskNums; i++) {
+                t[i].join();
+            }
+        }
+
+        inline float luminance(float r, float g, float b) {
+            return 0.2126f*r + 0.7152f*g + 0.0722f*b;
+        }
+    }
+
+    void Denoiser::denoise(const DenoiseInput& in, RGB* out, const DenoiseOptions& opt) const {
+        const int w = int(in.width);
+        const int h = int(in.height);
+        const size_t n = size_t(w)*h;
+        if (n == 0 || in.color == nullptr || in.normal == nullptr || in.depth == nullptr) return;
+
+        std::vector<float> r(n), g(n), b(n), lum(n), var(n);
+        std::vector<float> nx(n), ny(n), nz(n), z(n), grad(n);
+        for (size_t i=0; i<n; i++) {
+            RGB a = in.albedo ? glm::max(in.albedo[i], RGB{0.001f}) : RGB{1};
+            r[i] = in.color[i].r / a.r;
+            g[i] = in.color[i].g / a.g;
+            b[i] = in.color[i].b / a.b;
+            lum[i] = luminance(r[i], g[i], b[i]);
+            nx[i] = in.normal[i].x;
+            ny[i] = in.normal[i].y;
+            nz[i] = in.normal[i].z;
+            z[i] = in.depth[i];
+            if (in.variance) {
+                // 除以反照率后方差按亮度的平方缩放
+                float al = luminance(a.r, a.g, a.b);
+                var[i] = in.variance[i] / (al*al);
+            }
+        }
+
+        // 深度沿屏幕方向的变化率, 深度权重按它归一化, 斜面上相邻像素的深度差不被当成边缘
+        parallelRows(h, [&](int y) {
+            for (int x=0; x<w; x++) {
+                size_t i = size_t(y)*w + x;
+                float dx = 0.5f * (z[size_t(y)*w + glm::min(x + 1, w - 1)] - z[size_t(y)*w + glm::max(x - 1, 0)]);
+                float dy = 0.5f * (z[size_t(glm::min(y + 1, h - 1))*w + x] - z[size_t(glm::max(y - 1, 0))*w + x]);
+                grad[i] = glm::max(fabs(dx), fabs(dy));
+            }
+        });
+
+        if (!in.variance) {
+            parallelRows(h, [&](int y) {
+                for (int x=0; x<w; x++) {
+                    float s = 0, s2 = 0;
+                    int c = 0;
+                    for (int yy=glm::max(y - 1, 0); yy<=glm::min(y + 1, h - 1); yy++) {
+                        for (int xx=glm::max(x - 1, 0); xx<=glm::min(x + 1, w - 1); xx++) {
+                            float l = lum[size_t(yy)*w + xx];
+                            s += l;
+                            s2 += l*l;
+                            c++;
+                        }
+                    }
+                    var[size_t(y)*w + x] = glm::max(0.f, s2/c - (s/c)*(s/c));
+                }
+            });
+        }
+
+        const float kernel[3] = {3.f/8.f, 1.f/4.f, 1.f/16.f};
+        std::vector<float> r2(n), g2(n), b2(n), lum2(n), var2(n), sdev(n);
+        for (int level=0; level<opt.levels; level++) {
+            const int step = 1 << level;
+            // 亮度权重用的标准差取 3x3 高斯滤波后的方差, 单个像素的方差估计太不稳定
+            parallelRows(h, [&](int y) {
+                for (int x=0; x<w; x++) {
+                    float s = 0, ws = 0;
+                    for (int dy=-1; dy<=1; dy++) {
+                        int yy = y + dy;
+                        if (yy < 0 || yy >= h) continue;
+                        for (int dx=-1; dx<=1; dx++) {
+                            int xx = x + dx;
+                            if (xx < 0 || xx >= w) continue;
+                            float k = (dx == 0 ? 0.5f : 0.25f) * (dy == 0 ? 0.5f : 0.25f);
+                            s += k * var[size_t(yy)*w + xx];
+                            ws += k;
+                        }
+                    }
+                    sdev[size_t(y)*w + x] = sqrt(glm::max(s/ws, 0.f));
+                }
+            });
+
+            parallelRows(h, [&](int y) {
+                const size_t row = size_t(y)*w;
+                // 每行的累加量, 先按 tap 再沿行遍历, 内层循环只有连续访问
+                std::vector<float> sr(w), sg(w), sb(w), sw(w), sv(w);
+                for (int x=0; x<w; x++) {
+                    size_t p = row + x;
+                    float k = kernel[0]*kernel[0];
+                    sr[x] = k*r[p];
+                    sg[x] = k*g[p];
+                    sb[x] = k*b[p];
+                    sw[x] = k;
+                    sv[x] = k*k*var[p];
+                }
+                for (int ty=-2; ty<=2; ty++) {
+                    int yy = y + ty*step;
+                    if (yy < 0 || yy >= h) continue;
+                    const size_t qrow = size_t(yy)*w;
+                    for (int tx=-2; tx<=2; tx++) {
+                        if (tx == 0 && ty == 0) continue;
+                        const int off = tx*step;
+                        const int x0 = glm::max(0, -off);
+                        const int x1 = glm::min(w, w - off);
+                        const float k = kernel[abs(tx)] * kernel[abs(ty)];
+                        const float dist = float(step * glm::max(abs(tx), abs(ty)));
+                        for (int x=x0; x<x1; x++) {
+                            size_t p = row + x;
+                            size_t q = qrow + x + off;
+                            float dn = nx[p]*nx[q] + ny[p]*ny[q] + nz[p]*nz[q];
+                            float wn = dn > 0 ? pow(dn, opt.sigmaNormal) : 0.f;
+                            float wz = fabs(z[p] - z[q]) / (opt.sigmaDepth * grad[p] * dist + 1e-4f);
+                            // 标准差取两端的较大者, 权重近似对称: 萤火虫的能量被摊到邻域里, 而不是只被邻居拒绝
+                            float wl = fabs(lum[p] - lum[q]) / (opt.sigmaLuminance * glm::max(sdev[p], sdev[q]) + 1e-4f);
+                            float wt = k * wn * exp(-wz - wl);
+                            sr[x] += wt*r[q];
+                            sg[x] += wt*g[q];
+                            sb[x] += wt*b[q];
+                            sw[x] += wt;
+                            sv[x] += wt*wt*var[q];
+                        }
+                    }
+                }
+                for (int x=0; x<w; x++) {
+                    size_t p = row + x;
+                    float inv = 1.f / sw[x];
+                    r2[p] = sr[x]*inv;
+                    g2[p] = sg[x]*inv;
+                    b2[p] = sb[x]*inv;
+                    lum2[p] = luminance(r2[p], g2[p], b2[p]);
+                    var2[p] = sv[x]*inv*inv;
+                }
+            });
+            r.swap(r2);
+            g.swap(g2);
+            b.swap(b2);
+            lum.swap(lum2);
+            var.swap(var2);
+        }
+
+        for (size_t i=0; i<n; i++) {
+            RGB a = in.albedo ? glm::max(in.albedo[i], RGB{0.001f}) : RGB{1};
+            out[i] = RGB{r[i], g[i], b[i]} * a;
+        }
+    }
+} // namespace NRenderer
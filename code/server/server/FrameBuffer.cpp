@@ -0,0 +1,133 @@
+#include "server/FrameBuffer.hpp"
+
+#include <cmath>
+
+namespace NRenderer
+{
+    FrameBuffer::FrameBuffer()
+        : channels          ()
+        , width             (0)
+        , height            (0)
+        , mtx               ()
+    {}
+
+    FrameBuffer::FrameBuffer(unsigned int width, unsigned int height)
+        : channels          ()
+        , width             (width)
+        , height            (height)
+        , mtx               ()
+    {}
+
+    FrameBuffer::FrameBuffer(const FrameBuffer& fb)
+        : mtx               ()
+    {
+        lock_guard<mutex> lk(fb.mtx);
+        channels = fb.channels;
+        width = fb.width;
+        height = fb.height;
+    }
+
+    FrameBuffer& FrameBuffer::operator=(const FrameBuffer& fb) {
+        if (this == &fb) return *this;
+        scoped_lock lk(mtx, fb.mtx);
+        channels = fb.channels;
+        width = fb.width;
+        height = fb.height;
+        return *this;
+    }
+
+    void FrameBuffer::resize(unsigned int width, unsigned int height) {
+        lock_guard<mutex> lk(mtx);
+        channels.clear();
+        this->width = width;
+        this->height = height;
+    }
+
+    unsigned int FrameBuffer::getWidth() const {
+        lock_guard<mutex> lk(mtx);
+        return width;
+    }
+
+    unsigned int FrameBuffer::getHeight() const {
+        lock_guard<mutex> lk(mtx);
+        return height;
+    }
+
+    float* FrameBuffer::channel(const string& name, ChannelType type) {
+        lock_guard<mutex> lk(mtx);
+        auto it = channels.find(name);
+        if (it == channels.end()) {
+            // map 的节点不会移动, 之后分配别的通道也不影响已经交出去的指针
+            it = channels.emplace(name, Channel{type, vector<float>(size_t(width)*height*int(type), 0.f)}).first;
+        }
+        else if (it->second.type != type) {
+            return nullptr;
+        }
+        return it->second.data.data();
+    }
+
+    const float* FrameBuffer::find(const string& name) const {
+        lock_guard<mutex> lk(mtx);
+        auto it = channels.find(name);
+        return it == channels.end() ? nullptr : it->second.data.data();
+    }
+
+    bool FrameBuffer::has(const string& name) const {
+        lock_guard<mutex> lk(mtx);
+        return channels.find(name) != channels.end();
+    }
+
+    FrameBuffer::ChannelType FrameBuffer::typeOf(const string& name) const {
+        lock_guard<mutex> lk(mtx);
+        auto it = channels.find(name);
+        return it == channels.end() ? ChannelType::FLOAT1 : it->second.type;
+    }
+
+    vector<FrameBuffer::ChannelInfo> FrameBuffer::list() const {
+        lock_guard<mutex> lk(mtx);
+        vector<ChannelInfo> res;
+        res.reserve(channels.size());
+        for (auto& [name, c] : channels) {
+            res.push_back({name, c.type});
+        }
+        return res;
+    }
+
+    bool FrameBuffer::isColor(const string& name) {
+        return name == COLOR || name.rfind(string(COLOR) + ".", 0) == 0;
+    }
+
+    bool FrameBuffer::visualize(const string& name, RGBAi* out) const {
+        lock_guard<mutex> lk(mtx);
+        auto it = channels.find(name);
+        if (it == channels.end()) return false;
+        const size_t n = size_t(width)*height;
+        const int comps = int(it->second.type);
+        const float* data = it->second.data.data();
+        if (it->second.type == ChannelType::FLOAT1) {
+            float maxValue = 0;
+            for (size_t i=0; i<n; i++) {
+                if (isfinite(data[i])) maxValue = glm::max(maxValue, fabs(data[i]));
+            }
+            float scale = maxValue > 0 ? 1.f / maxValue : 0.f;
+            for (size_t i=0; i<n; i++) {
+                float v = isfinite(data[i]) ? fabs(data[i]) * scale : 0.f;
+                out[i] = RGBA2RGBAi({v, v, v, 1});
+            }
+            return true;
+        }
+        bool signedData = false;
+        for (size_t i=0; i<n*comps && !signedData; i++) {
+            signedData = data[i] < 0;
+        }
+        for (size_t i=0; i<n; i++) {
+            const float* p = data + i*comps;
+            RGBA c = {p[0], p[1], p[2], comps == 4 ? p[3] : 1.f};
+            if (signedData) {
+                c = {0.5f + 0.5f*c.r, 0.5f + 0.5f*c.g, 0.5f + 0.5f*c.b, c.a};
+            }
+            out[i] = RGBA2RGBAi(c);
+        }
+        return true;
+    }
+} // namespace NRenderer
@@ -9,11 +9,15 @@ namespace NRenderer
         , height            (500)
         , updated           (false)
         , mtx               ()
+        , frameBuffer       ()
+        , shownChannel      (FrameBuffer::COLOR)
+        , toneMapper        ()
+        , toneMapOptions    ()
     {
-        pixels = new RGBA[height * width];
+        pixels = new RGBAi[height * width];
         for (int i=0; i<height; i++) {
             for (int j=0; j<width;j++) {
-                pixels[i*width+j] = {0, 0, 0, 1};
+                pixels[i*width+j] = {0, 0, 0, 255};
             }
         }
     }
@@ -45,7 +49,7 @@ namespace NRenderer
         mtx.unlock();
         return h;
     }
-    const RGBA* Screen::getPixels() const {
+    const RGBAi* Screen::getPixels() const {
         mtx.lock();
         updated = false;
         mtx.unlock();
@@ -58,10 +62,79 @@ namespace NRenderer
         this->height = height;
         if (this->pixels!=nullptr)
             delete[] this->pixels;
-        this->pixels = new RGBA[width*height];
+        this->pixels = new RGBAi[width*height];
         for (int i=0; i<width*height; i++) {
-            this->pixels[i] = clamp(pixels[i]);
+            this->pixels[i] = RGBA2RGBAi(pixels[i]);
         }
+        frameBuffer.resize(width, height);
+        shownChannel = FrameBuffer::COLOR;
         mtx.unlock();
     }
+    void Screen::setLinear(RGBA* pixels, int width, int height) {
+        FrameBuffer fb{unsigned(width), unsigned(height)};
+        RGB* color = fb.float3(FrameBuffer::COLOR);
+        for (int i=0; i<width*height; i++) {
+            color[i] = RGB(pixels[i]);
+        }
+        set(fb);
+    }
+    void Screen::set(const FrameBuffer& frameBuffer) {
+        mtx.lock();
+        updated = true;
+        this->frameBuffer = frameBuffer;
+        this->width = frameBuffer.getWidth();
+        this->height = frameBuffer.getHeight();
+        if (this->pixels!=nullptr)
+            delete[] this->pixels;
+        this->pixels = new RGBAi[width*height];
+        // 新的帧缓冲里仍有之前显示的通道时保持不变, 方便对比多次渲染的同一个通道
+        if (!this->frameBuffer.has(shownChannel)) shownChannel = FrameBuffer::COLOR;
+        updateDisplay();
+        mtx.unlock();
+    }
+    vector<FrameBuffer::ChannelInfo> Screen::getChannels() const {
+        return frameBuffer.list();
+    }
+    string Screen::getShownChannel() const {
+        mtx.lock();
+        auto s = shownChannel;
+        mtx.unlock();
+        return s;
+    }
+    void Screen::showChannel(const string& name) {
+        mtx.lock();
+        if (pixels != nullptr && frameBuffer.has(name) && name != shownChannel) {
+            shownChannel = name;
+            updateDisplay();
+            updated = true;
+        }
+        mtx.unlock();
+    }
+    ToneMapOptions Screen::getToneMapOptions() const {
+        mtx.lock();
+        auto o = toneMapOptions;
+        mtx.unlock();
+        return o;
+    }
+    void Screen::setToneMapOptions(const ToneMapOptions& options) {
+        mtx.lock();
+        toneMapOptions = options;
+        if (pixels != nullptr && FrameBuffer::isColor(shownChannel) && frameBuffer.has(shownChannel)) {
+            updateDisplay();
+            updated = true;
+        }
+        mtx.unlock();
+    }
+    void Screen::updateDisplay() {
+        const size_t n = size_t(width)*height;
+        auto color = frameBuffer.find(shownChannel);
+        if (FrameBuffer::isColor(shownChannel) && color != nullptr
+            && frameBuffer.typeOf(shownChannel) == FrameBuffer::ChannelType::FLOAT3) {
+            // 线性颜色只在显示时做色调映射, 帧缓冲中保留原始的 HDR 值
+            toneMapper.apply(reinterpret_cast<const RGB*>(color), n, pixels, toneMapOptions);
+        }
+        else if (!frameBuffer.visualize(shownChannel, pixels)) {
+            for (size_t i=0; i<n; i++) pixels[i] = {0, 0, 0, 255};
+        }
+    }
 } // namespace NRenderer
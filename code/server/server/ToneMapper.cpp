@@ -0,0 +1,83 @@
+#include "server/ToneMapper.hpp"
+
+#include <vector>
+#include <cstdint>
+#include <cmath>
+
+namespace NRenderer
+{
+    namespace
+    {
+        constexpr size_t blockSize = 256;
+
+        void toneCurve(float* v, size_t m, const ToneMapOptions& options) {
+            using Curve = ToneMapOptions::Curve;
+            if (options.curve == Curve::REINHARD) {
+                const float invWhite2 = 1.f / (options.whitePoint * options.whitePoint);
+                for (size_t i=0; i<m; i++) {
+                    v[i] = v[i] * (1.f + v[i]*invWhite2) / (1.f + v[i]);
+                }
+            }
+            else if (options.curve == Curve::ACES) {
+                for (size_t i=0; i<m; i++) {
+                    // 按原文对输入先乘 0.6, 与 ACES 参考实现的整体曝光对齐
+                    float x = 0.6f * v[i];
+                    v[i] = (x*(2.51f*x + 0.03f)) / (x*(2.43f*x + 0.59f) + 0.14f);
+                }
+            }
+            for (size_t i=0; i<m; i++) {
+                v[i] = glm::min(v[i], 1.f);
+            }
+        }
+
+        // OETF 与量化合在一张表里, 以 [0, 1] 上均匀的 65536 个点为下标;
+        // 表足够密, gamma 2.0 在 0 附近斜率很大时相邻项也只差 1 级
+        constexpr int lutSize = 1 << 16;
+
+        vector<uint8_t> buildLut(ToneMapOptions::Transfer transfer) {
+            vector<uint8_t> lut(lutSize);
+            for (int i=0; i<lutSize; i++) {
+                double x = double(i) / double(lutSize - 1);
+                double y = transfer == ToneMapOptions::Transfer::GAMMA ? sqrt(x)
+                    : x <= 0.0031308 ? 12.92 * x : 1.055 * pow(x, 1.0/2.4) - 0.055;
+                lut[i] = uint8_t(y * 255.0 + 0.5);
+            }
+            return lut;
+        }
+
+        const uint8_t* oetfLut(ToneMapOptions::Transfer transfer) {
+            static const vector<uint8_t> srgb = buildLut(ToneMapOptions::Transfer::SRGB);
+            static const vector<uint8_t> gamma = buildLut(ToneMapOptions::Transfer::GAMMA);
+            return transfer == ToneMapOptions::Transfer::GAMMA ? gamma.data() : srgb.data();
+        }
+    }
+
+    void ToneMapper::apply(const RGB* hdr, size_t n, RGBAi* out, const ToneMapOptions& options) const {
+        if (n == 0) return;
+        const float scale = exp2(options.exposure);
+        const uint8_t* lut = oetfLut(options.transfer);
+        // 每个像素只有几次乘加和三次查表, 单线程处理一帧已经远小于渲染时间,
+        // 每次调用再起线程的开销反而更大
+        for (size_t begin=0; begin<n; begin+=blockSize) {
+            const size_t m = glm::min(blockSize, n - begin);
+            float c[3][blockSize];
+            for (size_t i=0; i<m; i++) {
+                for (int k=0; k<3; k++) {
+                    float x = hdr[begin + i][k] * scale;
+                    // NaN 与负值都按 0 处理; 上限防止无穷大在曲线中变成 NaN
+                    c[k][i] = x > 0 ? glm::min(x, 65504.f) : 0.f;
+                }
+            }
+            int32_t idx[3][blockSize];
+            for (int k=0; k<3; k++) {
+                toneCurve(c[k], m, options);
+                for (size_t i=0; i<m; i++) {
+                    idx[k][i] = int32_t(c[k][i]*float(lutSize - 1) + 0.5f);
+                }
+            }
+            for (size_t i=0; i<m; i++) {
+                out[begin + i] = RGBAi{lut[idx[0][i]], lut[idx[1][i]], lut[idx[2][i]], 255};
+            }
+        }
+    }
+} // namespace NRenderer
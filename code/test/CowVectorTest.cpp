@@ -0,0 +1,45 @@
+#include "gtest/gtest.h"
+#include "common/CowVector.hpp"
+
+using namespace NRenderer;
+
+TEST(CowVectorTest, CopySharesData) {
+    CowVector<int> a{1, 2, 3};
+    CowVector<int> b = a;
+    EXPECT_TRUE(a.sameData(b));
+    EXPECT_TRUE(a.shared());
+    EXPECT_EQ(a.data(), b.data());
+}
+
+TEST(CowVectorTest, WriteDetachesSharedData) {
+    CowVector<int> a{1, 2, 3};
+    CowVector<int> b = a;
+    b.push_back(4);
+    EXPECT_FALSE(a.sameData(b));
+    EXPECT_FALSE(a.shared());
+    EXPECT_EQ(a.size(), 3);
+    EXPECT_EQ(b.size(), 4);
+    EXPECT_EQ(b[3], 4);
+
+    CowVector<int> c = a;
+    c.mutableData()[0] = 7;
+    EXPECT_EQ(a[0], 1);
+    EXPECT_EQ(c[0], 7);
+}
+
+TEST(CowVectorTest, UniqueWriteKeepsData) {
+    CowVector<int> a{1, 2, 3};
+    const int* before = a.data();
+    a.edit()[1] = 5;
+    a.resize(3);
+    EXPECT_EQ(a.data(), before);
+    EXPECT_EQ(a[1], 5);
+}
+
+TEST(CowVectorTest, ClearDoesNotTouchOtherCopies) {
+    CowVector<int> a{1, 2, 3};
+    CowVector<int> b = a;
+    b.clear();
+    EXPECT_TRUE(b.empty());
+    EXPECT_EQ(a.size(), 3);
+}
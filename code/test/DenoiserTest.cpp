@@ -0,0 +1,123 @@
+#include "gtest/gtest.h"
+#include "server/Denoiser.hpp"
+
+#include <vector>
+#include <random>
+
+using namespace NRenderer;
+
+class DenoiserTest : public ::testing::Test
+{
+public:
+    static constexpr unsigned int w = 32;
+    static constexpr unsigned int h = 32;
+    std::vector<RGB> color;
+    std::vector<RGB> albedo;
+    std::vector<Vec3> normal;
+    std::vector<float> depth;
+
+    void SetUp() override {
+        color.assign(w*h, RGB{0.5f});
+        albedo.assign(w*h, RGB{1});
+        normal.assign(w*h, Vec3{0, 0, 1});
+        depth.assign(w*h, 1.f);
+    }
+
+    DenoiseInput input() const {
+        DenoiseInput in;
+        in.color = color.data();
+        in.albedo = albedo.data();
+        in.normal = normal.data();
+        in.depth = depth.data();
+        in.width = w;
+        in.height = h;
+        return in;
+    }
+
+    static float meanOf(const std::vector<RGB>& v) {
+        float s = 0;
+        for (auto& c : v) s += c.r;
+        return s / float(v.size());
+    }
+
+    static float varianceOf(const std::vector<RGB>& v) {
+        float m = meanOf(v), s = 0;
+        for (auto& c : v) s += (c.r - m)*(c.r - m);
+        return s / float(v.size());
+    }
+};
+
+TEST_F(DenoiserTest, ConstantImageUnchanged) {
+    std::vector<RGB> out(w*h);
+    Denoiser{}.denoise(input(), out.data(), DenoiseOptions{});
+    for (auto& c : out) {
+        EXPECT_NEAR(c.r, 0.5f, 1e-5f);
+        EXPECT_NEAR(c.g, 0.5f, 1e-5f);
+        EXPECT_NEAR(c.b, 0.5f, 1e-5f);
+    }
+}
+
+TEST_F(DenoiserTest, ReducesNoiseOnFlatSurface) {
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> u(0.f, 1.f);
+    for (auto& c : color) c = RGB{u(rng)};
+    std::vector<RGB> out(w*h);
+    Denoiser{}.denoise(input(), out.data(), DenoiseOptions{});
+    EXPECT_LT(varianceOf(out), varianceOf(color) * 0.1f);
+    EXPECT_NEAR(meanOf(out), meanOf(color), 0.05f);
+}
+
+TEST_F(DenoiserTest, KeepsNormalEdges) {
+    // 左右两半法线垂直, 颜色不同; 滤波不应跨过这条边
+    for (unsigned int y=0; y<h; y++) {
+        for (unsigned int x=w/2; x<w; x++) {
+            normal[y*w + x] = Vec3{1, 0, 0};
+            color[y*w + x] = RGB{2.f};
+        }
+    }
+    std::vector<RGB> out(w*h);
+    Denoiser{}.denoise(input(), out.data(), DenoiseOptions{});
+    for (unsigned int y=0; y<h; y++) {
+        EXPECT_NEAR(out[y*w + w/2 - 1].r, 0.5f, 1e-3f);
+        EXPECT_NEAR(out[y*w + w/2].r, 2.f, 1e-3f);
+    }
+}
+
+TEST_F(DenoiserTest, KeepsAlbedoDetail) {
+    // 光照均匀, 只有反照率是棋盘格: 除以反照率后光照是常数, 输出应与输入一致
+    for (unsigned int y=0; y<h; y++) {
+        for (unsigned int x=0; x<w; x++) {
+            RGB a = ((x + y) & 1) ? RGB{0.9f} : RGB{0.1f};
+            albedo[y*w + x] = a;
+            color[y*w + x] = a * 0.5f;
+        }
+    }
+    std::vector<RGB> out(w*h);
+    Denoiser{}.denoise(input(), out.data(), DenoiseOptions{});
+    for (size_t i=0; i<out.size(); i++) {
+        EXPECT_NEAR(out[i].r, color[i].r, 1e-5f);
+    }
+}
+
+TEST_F(DenoiserTest, InPlaceMatchesSeparateOutput) {
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<float> u(0.f, 1.f);
+    for (auto& c : color) c = RGB{u(rng), u(rng), u(rng)};
+    std::vector<RGB> out(w*h);
+    Denoiser{}.denoise(input(), out.data(), DenoiseOptions{});
+    auto in = input();
+    Denoiser{}.denoise(in, color.data(), DenoiseOptions{});
+    for (size_t i=0; i<out.size(); i++) {
+        EXPECT_EQ(out[i], color[i]);
+    }
+}
+
+TEST_F(DenoiserTest, MissingGuideBuffersLeaveOutputUntouched) {
+    std::vector<RGB> out(w*h, RGB{-1.f});
+    auto in = input();
+    in.normal = nullptr;
+    Denoiser{}.denoise(in, out.data(), DenoiseOptions{});
+    for (auto& c : out) {
+        EXPECT_EQ(c, RGB{-1.f});
+    }
+}
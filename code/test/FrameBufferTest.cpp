@@ -0,0 +1,92 @@
+#include "gtest/gtest.h"
+#include "server/FrameBuffer.hpp"
+
+#include <vector>
+
+using namespace NRenderer;
+
+using ChannelType = FrameBuffer::ChannelType;
+
+TEST(FrameBufferTest, ChannelsAllocatedOnFirstUse) {
+    FrameBuffer fb{4, 3};
+    EXPECT_FALSE(fb.has(FrameBuffer::DEPTH));
+    EXPECT_EQ(fb.find(FrameBuffer::DEPTH), nullptr);
+    EXPECT_TRUE(fb.list().empty());
+
+    float* depth = fb.float1(FrameBuffer::DEPTH);
+    ASSERT_NE(depth, nullptr);
+    EXPECT_TRUE(fb.has(FrameBuffer::DEPTH));
+    EXPECT_EQ(fb.typeOf(FrameBuffer::DEPTH), ChannelType::FLOAT1);
+    for (int i=0; i<12; i++) EXPECT_EQ(depth[i], 0.f);
+    // 再次请求返回同一块内存
+    EXPECT_EQ(fb.float1(FrameBuffer::DEPTH), depth);
+    EXPECT_EQ(fb.find(FrameBuffer::DEPTH), depth);
+}
+
+TEST(FrameBufferTest, ChannelTypeMismatchReturnsNull) {
+    FrameBuffer fb{2, 2};
+    ASSERT_NE(fb.float3(FrameBuffer::NORMAL), nullptr);
+    EXPECT_EQ(fb.float1(FrameBuffer::NORMAL), nullptr);
+    EXPECT_EQ(fb.float4(FrameBuffer::NORMAL), nullptr);
+    EXPECT_EQ(fb.typeOf(FrameBuffer::NORMAL), ChannelType::FLOAT3);
+}
+
+TEST(FrameBufferTest, PointersStableAcrossAllocations) {
+    FrameBuffer fb{8, 8};
+    Vec3* color = fb.float3(FrameBuffer::COLOR);
+    color[63] = Vec3{1, 2, 3};
+    fb.float3(FrameBuffer::ALBEDO);
+    fb.float1(FrameBuffer::SAMPLES);
+    fb.float4("debug.rgba");
+    EXPECT_EQ(fb.float3(FrameBuffer::COLOR), color);
+    EXPECT_EQ(color[63], (Vec3{1, 2, 3}));
+    EXPECT_EQ(fb.list().size(), 4);
+}
+
+TEST(FrameBufferTest, ResizeDropsChannels) {
+    FrameBuffer fb{2, 2};
+    fb.float1(FrameBuffer::DEPTH);
+    fb.resize(3, 5);
+    EXPECT_EQ(fb.getWidth(), 3);
+    EXPECT_EQ(fb.getHeight(), 5);
+    EXPECT_FALSE(fb.has(FrameBuffer::DEPTH));
+}
+
+TEST(FrameBufferTest, CopyOwnsItsChannels) {
+    FrameBuffer fb{2, 1};
+    fb.float1(FrameBuffer::DEPTH)[0] = 3.f;
+    FrameBuffer copy = fb;
+    copy.float1(FrameBuffer::DEPTH)[0] = 5.f;
+    EXPECT_EQ(fb.find(FrameBuffer::DEPTH)[0], 3.f);
+    EXPECT_EQ(copy.find(FrameBuffer::DEPTH)[0], 5.f);
+}
+
+TEST(FrameBufferTest, ColorChannelNames) {
+    EXPECT_TRUE(FrameBuffer::isColor(FrameBuffer::COLOR));
+    EXPECT_TRUE(FrameBuffer::isColor("color.noisy"));
+    EXPECT_FALSE(FrameBuffer::isColor("colorful"));
+    EXPECT_FALSE(FrameBuffer::isColor(FrameBuffer::ALBEDO));
+}
+
+TEST(FrameBufferTest, VisualizeNormalizesFloat1) {
+    FrameBuffer fb{2, 1};
+    float* d = fb.float1(FrameBuffer::DEPTH);
+    d[0] = 2.f;
+    d[1] = 4.f;
+    std::vector<RGBAi> out(2);
+    ASSERT_TRUE(fb.visualize(FrameBuffer::DEPTH, out.data()));
+    EXPECT_EQ(out[1].r, 255);
+    EXPECT_NEAR(out[0].r, 127, 1);
+    EXPECT_EQ(out[0].r, out[0].g);
+    EXPECT_FALSE(fb.visualize("missing", out.data()));
+}
+
+TEST(FrameBufferTest, VisualizeMapsSignedVectors) {
+    FrameBuffer fb{1, 1};
+    fb.float3(FrameBuffer::NORMAL)[0] = Vec3{-1, 0, 1};
+    std::vector<RGBAi> out(1);
+    ASSERT_TRUE(fb.visualize(FrameBuffer::NORMAL, out.data()));
+    EXPECT_EQ(out[0].r, 0);
+    EXPECT_NEAR(out[0].g, 127, 1);
+    EXPECT_EQ(out[0].b, 255);
+}
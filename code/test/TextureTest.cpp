@@ -0,0 +1,45 @@
+#include "gtest/gtest.h"
+#include "scene/Texture.hpp"
+
+using namespace NRenderer;
+
+TEST(TextureTest, CopySharesPixels) {
+    Texture a;
+    RGBA* p = a.allocate(2, 2);
+    p[0] = RGBA{1, 0, 0, 1};
+    Texture b = a;
+    EXPECT_EQ(a.rgba, b.rgba);
+    EXPECT_EQ(b.width, 2);
+    EXPECT_EQ(b.height, 2);
+}
+
+TEST(TextureTest, MutableDataCopiesSharedPixels) {
+    Texture a;
+    a.allocate(2, 1)[0] = RGBA{1, 0, 0, 1};
+    Texture b = a;
+    RGBA* p = b.mutableData();
+    EXPECT_NE(p, a.rgba);
+    EXPECT_EQ(b.rgba, p);
+    EXPECT_EQ(p[0], (RGBA{1, 0, 0, 1}));
+    p[0] = RGBA{0, 1, 0, 1};
+    EXPECT_EQ(a.rgba[0], (RGBA{1, 0, 0, 1}));
+}
+
+TEST(TextureTest, MutableDataKeepsUniquePixels) {
+    Texture a;
+    RGBA* p = a.allocate(2, 1);
+    EXPECT_EQ(a.mutableData(), p);
+}
+
+TEST(TextureTest, ViewIsCopiedBeforeWrite) {
+    auto pixels = make_shared<vector<RGBA>>(4, RGBA{0.5f, 0.5f, 0.5f, 1});
+    Texture a;
+    a.view(pixels, pixels->data(), 2, 2);
+    EXPECT_EQ(a.rgba, pixels->data());
+    RGBA* p = a.mutableData();
+    EXPECT_NE(p, pixels->data());
+    p[0] = RGBA{1, 1, 1, 1};
+    EXPECT_EQ((*pixels)[0], (RGBA{0.5f, 0.5f, 0.5f, 1}));
+    // 复制后不再是只读视图
+    EXPECT_EQ(a.mutableData(), p);
+}
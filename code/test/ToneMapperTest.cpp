@@ -0,0 +1,123 @@
+#include "gtest/gtest.h"
+#include "server/ToneMapper.hpp"
+
+#include <vector>
+#include <cmath>
+#include <limits>
+
+using namespace NRenderer;
+
+using Curve = ToneMapOptions::Curve;
+using Transfer = ToneMapOptions::Transfer;
+
+namespace
+{
+    RGBAi map1(float v, const ToneMapOptions& options) {
+        RGB c{v};
+        RGBAi out;
+        ToneMapper{}.apply(&c, 1, &out, options);
+        return out;
+    }
+
+    int srgb8(double x) {
+        double y = x <= 0.0031308 ? 12.92 * x : 1.055 * pow(x, 1.0/2.4) - 0.055;
+        return int(y * 255.0 + 0.5);
+    }
+}
+
+TEST(ToneMapperTest, GammaMatchesSquareRoot) {
+    ToneMapOptions options;
+    options.transfer = Transfer::GAMMA;
+    for (int i=0; i<=100; i++) {
+        float v = float(i) / 100.f;
+        EXPECT_NEAR(map1(v, options).r, int(sqrt(v) * 255.f + 0.5f), 1) << "v = " << v;
+    }
+}
+
+TEST(ToneMapperTest, SrgbTransfer) {
+    ToneMapOptions options;
+    EXPECT_EQ(map1(0.f, options).r, 0);
+    EXPECT_EQ(map1(1.f, options).r, 255);
+    for (float v : {0.001f, 0.002f, 0.01f, 0.18f, 0.5f, 0.9f}) {
+        EXPECT_NEAR(map1(v, options).r, srgb8(v), 1) << "v = " << v;
+    }
+}
+
+TEST(ToneMapperTest, ClampSaturatesAboveOne) {
+    ToneMapOptions options;
+    EXPECT_EQ(map1(1.5f, options).r, 255);
+    EXPECT_EQ(map1(100.f, options).r, 255);
+}
+
+TEST(ToneMapperTest, ReinhardWhitePoint) {
+    ToneMapOptions options;
+    options.curve = Curve::REINHARD;
+    options.whitePoint = 4.f;
+    EXPECT_EQ(map1(4.f, options).r, 255);
+    // x (1 + x/W^2) / (1 + x)
+    EXPECT_NEAR(map1(1.f, options).r, srgb8(1.0 * (1.0 + 1.0/16.0) / 2.0), 1);
+    EXPECT_LT(map1(2.f, options).r, 255);
+}
+
+TEST(ToneMapperTest, CurvesAreMonotonic) {
+    for (Curve curve : {Curve::CLAMP, Curve::REINHARD, Curve::ACES}) {
+        ToneMapOptions options;
+        options.curve = curve;
+        int last = 0;
+        for (int i=0; i<=200; i++) {
+            int v = map1(float(i) * 0.05f, options).r;
+            EXPECT_GE(v, last) << "curve " << int(curve) << ", x = " << float(i) * 0.05f;
+            last = v;
+        }
+    }
+}
+
+TEST(ToneMapperTest, AcesRange) {
+    ToneMapOptions options;
+    options.curve = Curve::ACES;
+    EXPECT_EQ(map1(0.f, options).r, 0);
+    EXPECT_EQ(map1(1000.f, options).r, 255);
+    EXPECT_LT(map1(1.f, options).r, 255);
+}
+
+TEST(ToneMapperTest, ExposureScalesInput) {
+    ToneMapOptions options;
+    options.exposure = 1.f;
+    ToneMapOptions plain;
+    EXPECT_EQ(map1(0.25f, options).r, map1(0.5f, plain).r);
+    options.exposure = -2.f;
+    EXPECT_EQ(map1(0.8f, options).r, map1(0.2f, plain).r);
+}
+
+TEST(ToneMapperTest, NonFiniteAndNegativeValues) {
+    ToneMapOptions options;
+    options.curve = Curve::REINHARD;
+    const float inf = std::numeric_limits<float>::infinity();
+    const float nan = std::numeric_limits<float>::quiet_NaN();
+    RGB c[2] = {RGB{nan, -1.f, inf}, RGB{0.5f}};
+    RGBAi out[2];
+    ToneMapper{}.apply(c, 2, out, options);
+    EXPECT_EQ(out[0].r, 0);
+    EXPECT_EQ(out[0].g, 0);
+    EXPECT_EQ(out[0].b, 255);
+    EXPECT_EQ(out[0].a, 255);
+    EXPECT_EQ(out[1].a, 255);
+}
+
+TEST(ToneMapperTest, PartialBlocksMatchSinglePixels) {
+    // 像素数不是块大小的整数倍, 最后一块也要逐像素一致
+    const size_t n = 1000;
+    std::vector<RGB> hdr(n);
+    for (size_t i=0; i<n; i++) {
+        hdr[i] = RGB{float(i) / 500.f, float(n - i) / 700.f, float(i % 7) / 3.f};
+    }
+    ToneMapOptions options;
+    options.curve = Curve::ACES;
+    std::vector<RGBAi> out(n);
+    ToneMapper{}.apply(hdr.data(), n, out.data(), options);
+    for (size_t i=0; i<n; i++) {
+        RGBAi one;
+        ToneMapper{}.apply(&hdr[i], 1, &one, options);
+        EXPECT_EQ(out[i], one) << "pixel " << i;
+    }
+}